@@ -72,6 +72,40 @@ else()
     target_link_libraries(${PROJECT_NAME} PRIVATE fmt::fmt)
 endif()
 
+cpmfindpackage(
+    NAME
+    ZLIB
+    GITHUB_REPOSITORY
+    "madler/zlib"
+    GIT_TAG
+    "v1.3.1"
+    OPTIONS
+    "ZLIB_BUILD_EXAMPLES OFF"
+)
+
+if(ZLIB_ADDED)
+    set_target_properties(
+        zlibstatic PROPERTIES POSITION_INDEPENDENT_CODE ON
+    )
+    target_include_directories(
+        zlibstatic PUBLIC $<BUILD_INTERFACE:${ZLIB_SOURCE_DIR}>
+                          $<BUILD_INTERFACE:${ZLIB_BINARY_DIR}>
+    )
+    add_library(${PROJECT_NAME}::zlib ALIAS zlibstatic)
+    target_link_libraries(${PROJECT_NAME} PRIVATE zlibstatic)
+    install(
+        TARGETS zlibstatic
+        EXPORT ${PROJECT_NAME}Targets
+        LIBRARY DESTINATION ${CMAKE_INSTALL_LIBDIR}
+        RUNTIME DESTINATION ${CMAKE_INSTALL_BINDIR}
+        ARCHIVE DESTINATION ${CMAKE_INSTALL_LIBDIR}
+    )
+else()
+    set_target_properties(ZLIB::ZLIB PROPERTIES IMPORTED_GLOBAL TRUE)
+    add_library(${PROJECT_NAME}::zlib ALIAS ZLIB::ZLIB)
+    target_link_libraries(${PROJECT_NAME} PRIVATE ZLIB::ZLIB)
+endif()
+
 set(THREADS_PREFER_PTHREAD_FLAG ON)
 find_package(Threads REQUIRED)
 target_link_libraries(${PROJECT_NAME} PRIVATE Threads::Threads)
@@ -1,13 +1,34 @@
-set(sources src/HttpClient.cpp src/SslClient.cpp src/Uri.cpp src/Util.cpp
-            src/WebSocketClient.cpp
+set(sources
+    src/Errors.cpp
+    src/FrameParser.cpp
+    src/Handshake.cpp
+    src/HttpClient.cpp
+    src/LoadBalancer.cpp
+    src/PerMessageDeflate.cpp
+    src/Random.cpp
+    src/ShardedClient.cpp
+    src/SslClient.cpp
+    src/TimerWheel.cpp
+    src/TokenBucket.cpp
+    src/Transport.cpp
+    src/Uri.cpp
+    src/Utf8Validator.cpp
+    src/Util.cpp
+    src/Waker.cpp
+    src/WebSocketClient.cpp
+    src/WebSocketPool.cpp
 )
 
 set(headers
     include/ekisocket/Errors.hpp
     include/ekisocket/HttpClient.hpp
+    include/ekisocket/LoadBalancer.hpp
+    include/ekisocket/ShardedClient.hpp
     include/ekisocket/Socket.hpp
     include/ekisocket/SslClient.hpp
+    include/ekisocket/Transport.hpp
     include/ekisocket/Uri.hpp
     include/ekisocket/Util.hpp
     include/ekisocket/WebSocketClient.hpp
+    include/ekisocket/WebSocketPool.hpp
 )
@@ -3,7 +3,9 @@
 
 int main()
 {
-    ekisocket::ws::Client client("wss://gateway.discord.gg/?v=10&encoding=json");
+    ekisocket::ws::Client client("wss://gateway.discord.gg/?v=10&encoding=json&compress=zlib-stream");
+    // The gateway compresses the whole connection as one zlib stream, which the client decompresses message by message.
+    client.set_transport_compression(ekisocket::ws::TransportCompression::ZLIB_STREAM);
     client.set_on_message(
         [](const ekisocket::ws::Message& msg) { std::cout << "Received message: " << msg.data << '\n'; });
     // Blocks until disconnected. (Automatic reconnect is on by default).
@@ -0,0 +1,61 @@
+#include <chrono>
+#include <cstddef>
+#include <ekisocket/Util.hpp>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+/**
+ * @brief The byte at a time loop the WebSocket client used to mask payloads with.
+ */
+void mask_bytewise(std::string& payload, uint32_t masking_key)
+{
+    for (size_t i {}; i < payload.size(); ++i) {
+        auto j = i % 4;
+        *(reinterpret_cast<std::byte*>(&payload[i]))
+            ^= std::byte { static_cast<uint8_t>((masking_key >> (24 - (j * 8))) & 0xFF) };
+    }
+}
+
+/**
+ * @brief Runs the function over and over for about 200ms, returning the throughput in GB/s.
+ */
+template <typename Function> double measure(size_t bytes, Function&& fn)
+{
+    using namespace std::chrono;
+    const auto start = steady_clock::now();
+    size_t iterations {};
+
+    while (steady_clock::now() - start < milliseconds { 200 }) {
+        for (int i {}; i < 16; ++i, ++iterations) {
+            fn();
+        }
+    }
+
+    const auto seconds = duration<double>(steady_clock::now() - start).count();
+    return static_cast<double>(bytes * iterations) / seconds / 1e9;
+}
+} // namespace
+
+int main()
+{
+    // Masks payloads of typical sizes with the old loop and with the SIMD kernel, in place and while copying.
+    constexpr uint32_t MASKING_KEY { 0x37FA213D };
+
+    std::cout << std::setw(10) << "bytes" << std::setw(14) << "bytewise" << std::setw(14) << "in place"
+              << std::setw(14) << "copying" << "  (GB/s)\n";
+
+    for (const size_t size : { 125UL, 1024UL, 16384UL, 65536UL, 1048576UL }) {
+        std::string payload(size, 'x');
+        std::string frame(size, '\0');
+
+        const auto bytewise = measure(size, [&] { mask_bytewise(payload, MASKING_KEY); });
+        const auto in_place
+            = measure(size, [&] { ekisocket::util::mask(payload, payload.data(), MASKING_KEY); });
+        const auto copying = measure(size, [&] { ekisocket::util::mask(payload, frame.data(), MASKING_KEY); });
+
+        std::cout << std::setw(10) << size << std::fixed << std::setprecision(2) << std::setw(14) << bytewise
+                  << std::setw(14) << in_place << std::setw(14) << copying << '\n';
+    }
+}
@@ -0,0 +1,116 @@
+#include <chrono>
+#include <cstddef>
+#include <ekisocket/Util.hpp>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+/**
+ * @brief A straightforward byte at a time validator, decoding every character.
+ */
+bool validate_bytewise(std::string_view data)
+{
+    for (size_t i {}; i < data.size();) {
+        const auto c = static_cast<uint8_t>(data[i]);
+        size_t length {};
+        uint32_t code_point {};
+
+        if (c < 0x80) {
+            ++i;
+            continue;
+        }
+        if ((c & 0xE0) == 0xC0) {
+            length = 2;
+            code_point = c & 0x1FU;
+        } else if ((c & 0xF0) == 0xE0) {
+            length = 3;
+            code_point = c & 0x0FU;
+        } else if ((c & 0xF8) == 0xF0) {
+            length = 4;
+            code_point = c & 0x07U;
+        } else {
+            return false;
+        }
+        if (i + length > data.size()) {
+            return false;
+        }
+        for (size_t j { 1 }; j < length; ++j) {
+            const auto next = static_cast<uint8_t>(data[i + j]);
+            if ((next & 0xC0) != 0x80) {
+                return false;
+            }
+            code_point = (code_point << 6U) | (next & 0x3FU);
+        }
+
+        // Overlong encodings, code points above U+10FFFF and surrogates.
+        constexpr uint32_t MIN_CODE_POINT[] { 0, 0, 0x80, 0x800, 0x10000 };
+        if (code_point < MIN_CODE_POINT[length] || code_point > 0x10FFFF
+            || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+            return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs the function over and over for about 200ms, returning the throughput in GB/s.
+ */
+template <typename Function> double measure(size_t bytes, Function&& fn)
+{
+    using namespace std::chrono;
+    const auto start = steady_clock::now();
+    size_t iterations {};
+
+    while (steady_clock::now() - start < milliseconds { 200 }) {
+        for (int i {}; i < 16; ++i, ++iterations) {
+            if (!fn()) {
+                std::cerr << "Invalid text\n";
+                return 0;
+            }
+        }
+    }
+
+    const auto seconds = duration<double>(steady_clock::now() - start).count();
+    return static_cast<double>(bytes * iterations) / seconds / 1e9;
+}
+
+/**
+ * @brief Repeats the sample until the text is size bytes long, without cutting a character in half.
+ */
+std::string make_text(std::string_view sample, size_t size)
+{
+    std::string ret {};
+
+    while (ret.size() + sample.size() <= size) {
+        ret += sample;
+    }
+    ret.append(size - ret.size(), ' ');
+    return ret;
+}
+} // namespace
+
+int main()
+{
+    // Validates ASCII text (JSON, most of the time) and text mixing characters of every length, like chat messages.
+    constexpr std::string_view ASCII { R"({"op":0,"t":"MESSAGE_CREATE","d":{"content":"hello world","id":"1234"}})" };
+    constexpr std::string_view MIXED { "Grüße, Καλημέρα, こんにちは, 안녕하세요 😀🎉 " };
+
+    std::cout << std::setw(10) << "bytes" << std::setw(14) << "ascii" << std::setw(14) << "ascii simd"
+              << std::setw(14) << "mixed" << std::setw(14) << "mixed simd" << "  (GB/s)\n";
+
+    for (const size_t size : { 125UL, 1024UL, 16384UL, 65536UL, 1048576UL }) {
+        const auto ascii = make_text(ASCII, size);
+        const auto mixed = make_text(MIXED, size);
+
+        const auto ascii_bytewise = measure(size, [&] { return validate_bytewise(ascii); });
+        const auto ascii_simd = measure(size, [&] { return ekisocket::util::is_valid_utf8(ascii); });
+        const auto mixed_bytewise = measure(size, [&] { return validate_bytewise(mixed); });
+        const auto mixed_simd = measure(size, [&] { return ekisocket::util::is_valid_utf8(mixed); });
+
+        std::cout << std::setw(10) << size << std::fixed << std::setprecision(2) << std::setw(14) << ascii_bytewise
+                  << std::setw(14) << ascii_simd << std::setw(14) << mixed_bytewise << std::setw(14) << mixed_simd
+                  << '\n';
+    }
+}
@@ -1,5 +1,7 @@
 #pragma once
+#include <ekisocket_export.h>
 #include <stdexcept>
+#include <system_error>
 
 namespace ekisocket::errors {
 struct HttpClientError : std::runtime_error {
@@ -12,4 +14,45 @@ struct SslClientError : std::runtime_error {
 struct WebSocketClientError : std::runtime_error {
     using runtime_error::runtime_error;
 };
-}
+
+/**
+ * @brief Error conditions reported by the non-throwing (std::error_code) overloads. Errors coming from the operating
+ * system are reported with std::system_category(), and errors coming from OpenSSL with ssl_category().
+ */
+enum class Error {
+    NOT_CONNECTED = 1,
+    MESSAGE_TOO_LONG,
+    LOOKUP_FAILED,
+    CONNECT_FAILED,
+    SSL_FAILED,
+    CERTIFICATE_INVALID,
+    CONNECTION_CLOSED,
+    INVALID_SCHEME,
+    INVALID_METHOD,
+    INVALID_RESPONSE,
+    URL_NOT_SET,
+    HANDSHAKE_FAILED,
+    NOT_OPEN,
+    BUFFER_FULL,
+    MESSAGE_IN_PROGRESS,
+};
+
+/**
+ * @brief The category of the errors found in Error.
+ *
+ * @return const std::error_category& The ekisocket error category.
+ */
+[[nodiscard]] EKISOCKET_EXPORT const std::error_category& category() noexcept;
+
+/**
+ * @brief The category of OpenSSL errors, whose values are the packed codes returned by ERR_get_error(). The error
+ * string is only looked up when message() is called.
+ *
+ * @return const std::error_category& The OpenSSL error category.
+ */
+[[nodiscard]] EKISOCKET_EXPORT const std::error_category& ssl_category() noexcept;
+
+[[nodiscard]] inline std::error_code make_error_code(Error e) noexcept { return { static_cast<int>(e), category() }; }
+} // namespace ekisocket::errors
+
+template <> struct std::is_error_code_enum<ekisocket::errors::Error> : std::true_type { };
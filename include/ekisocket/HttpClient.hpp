@@ -1,7 +1,9 @@
 #pragma once
 #include <ekisocket/SslClient.hpp>
+#include <ekisocket/Transport.hpp>
 #include <ekisocket/Uri.hpp>
 #include <functional>
+#include <optional>
 
 namespace ekisocket {
 namespace ssl {
@@ -36,12 +38,28 @@ namespace http {
     class Client {
     public:
         EKISOCKET_EXPORT explicit Client();
+
+        /**
+         * @brief Creates a client whose connections are made through the given factory, e.g. to run over a Unix
+         * socket or a MemoryTransport. Addresses pinned with set_address() are ignored by custom factories.
+         *
+         * @param factory Creates the transport of every new connection.
+         */
+        EKISOCKET_EXPORT explicit Client(TransportFactory factory);
         Client(const Client&) = delete;
         Client& operator=(const Client&) = delete;
         EKISOCKET_EXPORT Client(Client&&) noexcept;
         EKISOCKET_EXPORT Client& operator=(Client&&) noexcept;
         EKISOCKET_EXPORT virtual ~Client();
 
+        /**
+         * @brief Pins the connections made by this client to an already resolved address, instead of resolving the
+         * host of each requested URL. The host is still sent in the Host header and used for SNI.
+         *
+         * @param address The numeric address to connect to, or empty to resolve the host again.
+         */
+        EKISOCKET_EXPORT void set_address(std::string_view address) const;
+
         [[nodiscard]] EKISOCKET_EXPORT Response get(std::string_view, const Headers& headers = {},
             std::string_view body = {}, bool stream = false, const BodyCallback& cb = {});
         [[nodiscard]] EKISOCKET_EXPORT Response post(std::string_view, const Headers& headers = {},
@@ -79,10 +97,65 @@ namespace http {
             const Headers& headers, std::string_view body, bool keep_alive = false, bool stream = false,
             const BodyCallback& cb = {}) const;
 
+        /**
+         * @brief Same as the overload above, but reports failures through ec instead of throwing. The error is only
+         * formatted into a string if ec.message() is called, which makes this overload cheap when failures are
+         * expected, e.g. when a pooled connection was reset by the server.
+         *
+         * @return Response The response from the server, or an empty response if ec is set.
+         */
+        [[nodiscard]] EKISOCKET_EXPORT Response request(const Method& method, std::string_view url,
+            const Headers& headers, std::string_view body, std::error_code& ec, bool keep_alive = false,
+            bool stream = false, const BodyCallback& cb = {}) const;
+
+        /**
+         * @brief Sends an HTTP Request and relays the body of the response to another descriptor, such as a socket or
+         * a pipe, instead of returning it. On Linux, bodies with a Content-Length received over plain TCP (or kernel
+         * TLS) are moved with splice() through a pipe, so they never enter user space. Other connections are relayed
+         * through a single buffer per thread, and chunked bodies are decoded before being relayed.
+         *
+         * @param method The HTTP Method to use.
+         * @param url The URL to send the request to.
+         * @param headers The headers to send with the request.
+         * @param body The body of the request.
+         * @param out The descriptor to write the body of the response to.
+         * @param mirror A descriptor that also receives the body, duplicated with tee() if it is a pipe.
+         * @param keep_alive Whether or not to keep the connection alive.
+         * @return Response The status and headers of the response, with an empty body.
+         */
+        [[nodiscard]] EKISOCKET_EXPORT Response relay(const Method& method, std::string_view url,
+            const Headers& headers, std::string_view body, socket_t out, std::optional<socket_t> mirror = std::nullopt,
+            bool keep_alive = false) const;
+
+        /**
+         * @brief Same as the overload above, but reports failures through ec instead of throwing.
+         */
+        [[nodiscard]] EKISOCKET_EXPORT Response relay(const Method& method, std::string_view url,
+            const Headers& headers, std::string_view body, socket_t out, std::error_code& ec,
+            std::optional<socket_t> mirror = std::nullopt, bool keep_alive = false) const;
+
     private:
         friend ws::Client;
 
-        [[nodiscard]] ssl::Client& ssl() const;
+        /**
+         * @brief The transport of the current connection, only valid after a successful request.
+         */
+        [[nodiscard]] Transport& transport() const;
+
+        /**
+         * @brief Connects to the origin of the URL without sending anything, for protocols that take the connection
+         * over, such as WebSockets.
+         *
+         * @param url The URL to connect to.
+         * @param ec Set if the connection could not be established.
+         * @return Transport* The connected transport, or nullptr on failure.
+         */
+        [[nodiscard]] Transport* connect(std::string_view url, std::error_code& ec) const;
+
+        /**
+         * @brief Same as the overload above, but with a URI that has already been parsed.
+         */
+        [[nodiscard]] Transport* connect(Uri uri, std::error_code& ec) const;
 
         struct Impl;
         std::unique_ptr<Impl> m_impl {};
@@ -121,5 +194,11 @@ namespace http {
      */
     [[nodiscard]] EKISOCKET_EXPORT Response request(const Method& method, std::string_view url,
         const Headers& headers = {}, std::string_view body = {}, bool stream = false, const BodyCallback& cb = {});
+
+    /**
+     * @brief Same as the overload above, but reports failures through ec instead of throwing.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT Response request(const Method& method, std::string_view url, const Headers& headers,
+        std::string_view body, std::error_code& ec, bool stream = false, const BodyCallback& cb = {});
 } // namespace http
 } // namespace ekisocket
@@ -0,0 +1,125 @@
+#pragma once
+#include <chrono>
+#include <ekisocket/HttpClient.hpp>
+#include <vector>
+
+namespace ekisocket::http {
+/**
+ * @brief The strategies a LoadBalancer can use to pick the endpoint of a request.
+ */
+enum class Policy : uint8_t {
+    /// Cycles through the endpoints in order.
+    ROUND_ROBIN,
+    /// Samples two endpoints at random, and picks the one with the fewest outstanding requests.
+    POWER_OF_TWO_CHOICES,
+    /// Samples two endpoints at random, and picks the one with the lowest smoothed latency, weighted by its
+    /// outstanding requests.
+    LATENCY_EWMA,
+    /// Maps the request key onto a hash ring, so the same key keeps going to the same endpoint (cache affinity).
+    /// Requests without a key fall back to round-robin.
+    CONSISTENT_HASH,
+};
+
+/**
+ * @brief A single replica behind a LoadBalancer.
+ */
+struct Endpoint {
+    /// The base URL of the endpoint, e.g. "https://replica-1.example.com:8443".
+    std::string url {};
+    /// The numeric address to connect to instead of resolving the host of the URL, if not empty.
+    std::string address {};
+};
+
+/**
+ * @brief A snapshot of the state of an endpoint.
+ */
+struct EndpointStats {
+    Endpoint endpoint {};
+    /// Number of requests currently in flight.
+    uint32_t outstanding {};
+    /// Exponentially weighted moving average of the request latency.
+    std::chrono::microseconds latency {};
+    /// Number of failed requests since the last successful one.
+    uint32_t consecutive_failures {};
+    /// Whether or not the endpoint is currently ejected from the rotation.
+    bool ejected {};
+};
+
+/**
+ * @brief Spreads HTTP(S) requests across several equivalent endpoints. Each endpoint keeps its own pool of keep-alive
+ * connections, endpoints that keep failing are temporarily ejected from the rotation, and requests that fail before
+ * reaching the server are retried on another endpoint when the method is idempotent.
+ *
+ * The load balancer is thread-safe, concurrent requests use separate pooled connections.
+ */
+class LoadBalancer {
+public:
+    EKISOCKET_EXPORT explicit LoadBalancer(std::vector<Endpoint> endpoints, Policy policy = Policy::ROUND_ROBIN);
+    LoadBalancer(const LoadBalancer&) = delete;
+    LoadBalancer& operator=(const LoadBalancer&) = delete;
+    EKISOCKET_EXPORT LoadBalancer(LoadBalancer&&) noexcept;
+    EKISOCKET_EXPORT LoadBalancer& operator=(LoadBalancer&&) noexcept;
+    EKISOCKET_EXPORT ~LoadBalancer();
+
+    /**
+     * @brief Creates a load balancer with one endpoint for every address the host of the URL resolves to.
+     *
+     * @param url The base URL of the service.
+     * @param policy The policy used to pick endpoints.
+     * @return LoadBalancer The load balancer.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT static LoadBalancer from_dns(
+        std::string_view url, Policy policy = Policy::ROUND_ROBIN);
+
+    /**
+     * @brief Sets when endpoints get ejected from the rotation. An endpoint is ejected after max_failures consecutive
+     * failures and is given another chance once the duration has passed. If every endpoint is ejected, they are all
+     * used anyway. Defaults to 5 failures and 10 seconds.
+     *
+     * @param max_failures The number of consecutive failures before ejecting an endpoint, 0 disables ejection.
+     * @param duration How long an endpoint stays ejected.
+     */
+    EKISOCKET_EXPORT void set_ejection(uint32_t max_failures, std::chrono::milliseconds duration) const;
+
+    /**
+     * @brief Sets the maximum number of idle connections kept per endpoint. Defaults to 8.
+     *
+     * @param max_idle The maximum number of idle connections.
+     */
+    EKISOCKET_EXPORT void set_max_idle_connections(size_t max_idle) const;
+
+    /**
+     * @brief Sends an HTTP Request to one of the endpoints.
+     *
+     * @param method The HTTP Method to use.
+     * @param path The path (and query) of the request, appended to the URL of the endpoint.
+     * @param headers The headers to send with the request.
+     * @param body The body of the request.
+     * @param key The key used by Policy::CONSISTENT_HASH, ignored by the other policies.
+     * @param stream Whether or not to stream the response.
+     * @param cb The callback to call for each chunk of data received.
+     * @return Response The response from the server.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT Response request(const Method& method, std::string_view path,
+        const Headers& headers = {}, std::string_view body = {}, std::string_view key = {}, bool stream = false,
+        const BodyCallback& cb = {}) const;
+
+    /**
+     * @brief Same as the overload above, but reports failures through ec instead of throwing.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT Response request(const Method& method, std::string_view path,
+        const Headers& headers, std::string_view body, std::string_view key, std::error_code& ec, bool stream = false,
+        const BodyCallback& cb = {}) const;
+
+    /**
+     * @brief Returns a snapshot of the state of every endpoint.
+     *
+     * @return std::vector<EndpointStats> The state of the endpoints, in the order they were given.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT std::vector<EndpointStats> stats() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl {};
+};
+} // namespace ekisocket::http
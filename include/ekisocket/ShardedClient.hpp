@@ -0,0 +1,76 @@
+#pragma once
+#include <chrono>
+#include <ekisocket/HttpClient.hpp>
+
+namespace ekisocket::http {
+/**
+ * @brief A shared-nothing HTTP(S) client. It runs one worker thread per shard (optionally pinned to a core), and every
+ * shard owns its own keep-alive connections, DNS cache and buffers. Requests are routed to the shard of the calling
+ * thread, so the request path takes no locks and touches no shared atomics.
+ *
+ * Threads that are not workers of this client get a private shard of their own, kept for the lifetime of the thread.
+ */
+class ShardedClient {
+public:
+    /**
+     * @brief Creates the client, without starting any workers.
+     *
+     * @param shards The number of shards (and workers), defaults to the number of cores.
+     * @param pin_threads Whether or not to pin every worker to its own core.
+     */
+    EKISOCKET_EXPORT explicit ShardedClient(size_t shards = 0, bool pin_threads = false);
+    ShardedClient(const ShardedClient&) = delete;
+    ShardedClient& operator=(const ShardedClient&) = delete;
+    EKISOCKET_EXPORT ShardedClient(ShardedClient&&) noexcept;
+    EKISOCKET_EXPORT ShardedClient& operator=(ShardedClient&&) noexcept;
+    EKISOCKET_EXPORT ~ShardedClient();
+
+    /**
+     * @brief Sets how long resolved addresses are cached by each shard. Must be called before run(). Defaults to 60
+     * seconds, 0 disables the cache.
+     *
+     * @param ttl How long to cache resolved addresses.
+     */
+    EKISOCKET_EXPORT void set_dns_ttl(std::chrono::seconds ttl) const;
+
+    /**
+     * @brief Starts one worker per shard, each calling the given function with the index of its shard. Requests made
+     * from within the function go through that shard.
+     *
+     * @param worker The function run by every worker.
+     */
+    EKISOCKET_EXPORT void run(const std::function<void(size_t shard)>& worker) const;
+
+    /**
+     * @brief Waits for every worker started by run() to return.
+     */
+    EKISOCKET_EXPORT void join() const;
+
+    [[nodiscard]] EKISOCKET_EXPORT size_t shard_count() const;
+
+    /**
+     * @brief Sends an HTTP Request through the shard of the calling thread, reusing its connection to the server.
+     *
+     * @param method The HTTP Method to use.
+     * @param url The URL to send the request to.
+     * @param headers The headers to send with the request.
+     * @param body The body of the request.
+     * @param stream Whether or not to stream the response.
+     * @param cb The callback to call for each chunk of data received.
+     * @return Response The response from the server.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT Response request(const Method& method, std::string_view url,
+        const Headers& headers = {}, std::string_view body = {}, bool stream = false,
+        const BodyCallback& cb = {}) const;
+
+    /**
+     * @brief Same as the overload above, but reports failures through ec instead of throwing.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT Response request(const Method& method, std::string_view url, const Headers& headers,
+        std::string_view body, std::error_code& ec, bool stream = false, const BodyCallback& cb = {}) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl {};
+};
+} // namespace ekisocket::http
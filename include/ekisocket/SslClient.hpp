@@ -2,7 +2,9 @@
 #include <ekisocket/Errors.hpp>
 #include <ekisocket_export.h>
 #include <memory>
+#include <span>
 #include <string>
+#include <system_error>
 
 #ifdef _WIN32
 #ifdef _WIN64
@@ -17,6 +19,10 @@ using socket_t = int;
 namespace ekisocket::ssl {
 /**
  * @brief Represents a wrapper for TCP/UDP socket client with optional SSL encryption.
+ *
+ * Every operation that can fail has two overloads: one that throws errors::SslClientError, and one that reports the
+ * failure through a std::error_code instead. The latter never formats an error string unless ec.message() is called,
+ * which makes it suitable for hot paths where failures (e.g. a peer reset) are expected.
  */
 class Client {
 public:
@@ -38,6 +44,14 @@ public:
      */
     EKISOCKET_EXPORT void set_blocking(bool blocking) const;
     EKISOCKET_EXPORT void set_hostname(std::string hostname) const;
+
+    /**
+     * @brief Pins the connection to an already resolved address, skipping the lookup of the hostname. The hostname is
+     * still used for SNI and certificate verification. An empty address restores the lookup.
+     *
+     * @param address The numeric address to connect to.
+     */
+    EKISOCKET_EXPORT void set_address(std::string address) const;
     EKISOCKET_EXPORT void set_port(uint16_t port) const;
     EKISOCKET_EXPORT void set_timeout(int milliseconds) const;
     EKISOCKET_EXPORT void set_use_ssl(bool use_ssl) const;
@@ -58,6 +72,7 @@ public:
      * @return bool Whether or not the connection was successful.
      */
     EKISOCKET_EXPORT bool connect() const;
+    EKISOCKET_EXPORT bool connect(std::error_code& ec) const;
 
     /**
      * @brief Sends data over to the server.
@@ -66,6 +81,17 @@ public:
      * @return size_t The number of bytes sent.
      */
     EKISOCKET_EXPORT size_t send(std::string_view message) const;
+    EKISOCKET_EXPORT size_t send(std::string_view message, std::error_code& ec) const;
+
+    /**
+     * @brief Sends several buffers as if they were one. Without SSL they are handed to the socket together, with SSL
+     * they are gathered and encrypted into as few records as possible.
+     *
+     * @param bufs The buffers to send, in order.
+     * @return size_t The total number of bytes sent.
+     */
+    EKISOCKET_EXPORT size_t sendv(std::span<const std::string_view> bufs) const;
+    EKISOCKET_EXPORT size_t sendv(std::span<const std::string_view> bufs, std::error_code& ec) const;
 
     /**
      * @brief Receives data from the server.
@@ -73,6 +99,25 @@ public:
      * @return std::string The received data.
      */
     [[nodiscard]] EKISOCKET_EXPORT std::string receive(size_t buf_size = 4096) const;
+    [[nodiscard]] EKISOCKET_EXPORT std::string receive(size_t buf_size, std::error_code& ec) const;
+
+    /**
+     * @brief Receives data from the server into a caller provided buffer, avoiding an allocation per call.
+     *
+     * @param buf The buffer to receive into, at most buf.size() bytes are received.
+     * @return size_t The number of bytes received.
+     */
+    EKISOCKET_EXPORT size_t receive_into(std::span<char> buf) const;
+    EKISOCKET_EXPORT size_t receive_into(std::span<char> buf, std::error_code& ec) const;
+
+    /**
+     * @brief Whether or not the bytes read straight from socket() are the plaintext of the stream, i.e. the connection
+     * does not use SSL, or uses kernel TLS for receiving and OpenSSL has no decrypted data buffered. Only then can the
+     * socket be used with zero-copy facilities such as splice().
+     *
+     * @return bool Whether or not the socket can be read from directly.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT bool zero_copy_receive() const;
 
     /**
      * @brief Calls poll() on the underlying socket to query for the availability of read/write states.
@@ -89,6 +134,14 @@ public:
      */
     EKISOCKET_EXPORT void close() const;
 
+protected:
+    /**
+     * @brief Throws an errors::SslClientError describing ec, including the context of the last failed operation.
+     *
+     * @param ec The error reported by one of the std::error_code overloads.
+     */
+    [[noreturn]] EKISOCKET_EXPORT void throw_error(const std::error_code& ec) const;
+
 private:
     struct Impl;
     std::unique_ptr<Impl> m_impl {};
@@ -0,0 +1,247 @@
+#pragma once
+#include <ekisocket/SslClient.hpp>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace ekisocket {
+/**
+ * @brief A bidirectional byte stream that the HTTP and WebSocket clients run on. Implementations are provided for
+ * TCP/TLS (SocketTransport), Unix domain sockets (UnixTransport) and in-process pipes (MemoryTransport), and custom
+ * ones can be injected through a TransportFactory.
+ *
+ * Sends and receives wait for readiness for at most timeout() milliseconds (-1 meaning forever), and return 0 without
+ * setting ec when nothing could be transferred in time. A receive that returns 0 and leaves connected() false means the
+ * peer closed the stream.
+ */
+class Transport {
+public:
+    Transport() = default;
+    Transport(const Transport&) = delete;
+    Transport& operator=(const Transport&) = delete;
+    Transport(Transport&&) = delete;
+    Transport& operator=(Transport&&) = delete;
+    virtual ~Transport() = default;
+
+    [[nodiscard]] virtual bool connected() const = 0;
+
+    /**
+     * @brief Establishes the stream.
+     *
+     * @param ec Set if the stream could not be established.
+     * @return bool Whether or not the transport is now connected.
+     */
+    virtual bool connect(std::error_code& ec) = 0;
+
+    /**
+     * @brief Sends as much of the data as the transport accepts.
+     *
+     * @param data The data to send.
+     * @param ec Set if the stream failed.
+     * @return size_t The number of bytes sent.
+     */
+    virtual size_t send(std::string_view data, std::error_code& ec) = 0;
+
+    /**
+     * @brief Sends several buffers as if they were one. The default implementation sends them one at a time, and stops
+     * at the first one that is not sent completely.
+     *
+     * @param bufs The buffers to send, in order.
+     * @param ec Set if the stream failed.
+     * @return size_t The total number of bytes sent.
+     */
+    virtual size_t sendv(std::span<const std::string_view> bufs, std::error_code& ec)
+    {
+        size_t total {};
+
+        for (const auto buf : bufs) {
+            const auto sent = send(buf, ec);
+
+            total += sent;
+            if (ec || sent < buf.size()) {
+                break;
+            }
+        }
+        return total;
+    }
+
+    /**
+     * @brief Receives at most buf.size() bytes into buf.
+     *
+     * @param buf The buffer to receive into.
+     * @param ec Set if the stream failed.
+     * @return size_t The number of bytes received.
+     */
+    virtual size_t receive_into(std::span<char> buf, std::error_code& ec) = 0;
+
+    /**
+     * @brief Waits, for at most timeout() milliseconds, until the transport is ready for reading and/or writing.
+     *
+     * @param want_read Whether or not to wait for data to read.
+     * @param want_write Whether or not to wait for room to write.
+     * @return bool Whether or not the transport became ready.
+     */
+    [[nodiscard]] virtual bool wait(bool want_read, bool want_write) const = 0;
+
+    /**
+     * @brief Sets how long sends, receives and waits block for, -1 meaning forever and 0 not at all.
+     *
+     * @param milliseconds The timeout.
+     */
+    virtual void set_timeout(int milliseconds) = 0;
+    [[nodiscard]] virtual int timeout() const = 0;
+
+    /**
+     * @brief Closes the stream, the peer will see the end of the stream.
+     */
+    virtual void close() = 0;
+
+    /**
+     * @brief The descriptor behind the transport, if any.
+     *
+     * @return socket_t The descriptor, or an invalid socket if the transport does not have one.
+     */
+    [[nodiscard]] virtual socket_t native_handle() const { return ~socket_t {}; }
+
+    /**
+     * @brief Whether or not native_handle() yields the plaintext of the stream, so it can be used with zero-copy
+     * facilities such as splice().
+     */
+    [[nodiscard]] virtual bool zero_copy_receive() const { return false; }
+
+    /**
+     * @brief Throws the error reported by one of the operations above, with whatever context the transport has.
+     *
+     * @param ec The error to throw.
+     */
+    [[noreturn]] virtual void throw_error(const std::error_code& ec) const
+    {
+        throw errors::SslClientError(ec.message());
+    }
+
+    /**
+     * @brief Receives at most buf_size bytes into a new string.
+     */
+    [[nodiscard]] std::string receive(size_t buf_size, std::error_code& ec)
+    {
+        std::string ret(buf_size, '\0');
+
+        ret.resize(receive_into(ret, ec));
+        return ret;
+    }
+
+    void set_blocking(bool blocking) { set_timeout(blocking ? -1 : 0); }
+};
+
+/**
+ * @brief Creates the transport used to reach a server.
+ *
+ * @param host The host of the server.
+ * @param port The port of the server.
+ * @param use_tls Whether or not the connection should be encrypted.
+ */
+using TransportFactory = std::function<std::unique_ptr<Transport>(std::string_view host, uint16_t port, bool use_tls)>;
+
+/**
+ * @brief A TCP connection, optionally encrypted with TLS, backed by an ssl::Client.
+ */
+class SocketTransport : public Transport {
+public:
+    EKISOCKET_EXPORT SocketTransport(std::string_view hostname, uint16_t port, bool use_tls = false);
+    SocketTransport(const SocketTransport&) = delete;
+    SocketTransport& operator=(const SocketTransport&) = delete;
+    SocketTransport(SocketTransport&&) = delete;
+    SocketTransport& operator=(SocketTransport&&) = delete;
+    EKISOCKET_EXPORT ~SocketTransport() override;
+
+    /**
+     * @brief The underlying client, e.g. for pinning an address or verifying certificates before connecting.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT ssl::Client& client() const;
+
+    [[nodiscard]] EKISOCKET_EXPORT bool connected() const override;
+    EKISOCKET_EXPORT bool connect(std::error_code& ec) override;
+    EKISOCKET_EXPORT size_t send(std::string_view data, std::error_code& ec) override;
+    EKISOCKET_EXPORT size_t sendv(std::span<const std::string_view> bufs, std::error_code& ec) override;
+    EKISOCKET_EXPORT size_t receive_into(std::span<char> buf, std::error_code& ec) override;
+    [[nodiscard]] EKISOCKET_EXPORT bool wait(bool want_read, bool want_write) const override;
+    EKISOCKET_EXPORT void set_timeout(int milliseconds) override;
+    [[nodiscard]] EKISOCKET_EXPORT int timeout() const override;
+    EKISOCKET_EXPORT void close() override;
+    [[nodiscard]] EKISOCKET_EXPORT socket_t native_handle() const override;
+    [[nodiscard]] EKISOCKET_EXPORT bool zero_copy_receive() const override;
+    [[noreturn]] EKISOCKET_EXPORT void throw_error(const std::error_code& ec) const override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl {};
+};
+
+/**
+ * @brief A connection to a Unix domain (stream) socket. Not supported on Windows, where connect() always fails.
+ */
+class UnixTransport : public Transport {
+public:
+    EKISOCKET_EXPORT explicit UnixTransport(std::string path);
+    UnixTransport(const UnixTransport&) = delete;
+    UnixTransport& operator=(const UnixTransport&) = delete;
+    UnixTransport(UnixTransport&&) = delete;
+    UnixTransport& operator=(UnixTransport&&) = delete;
+    EKISOCKET_EXPORT ~UnixTransport() override;
+
+    [[nodiscard]] EKISOCKET_EXPORT bool connected() const override;
+    EKISOCKET_EXPORT bool connect(std::error_code& ec) override;
+    EKISOCKET_EXPORT size_t send(std::string_view data, std::error_code& ec) override;
+    EKISOCKET_EXPORT size_t sendv(std::span<const std::string_view> bufs, std::error_code& ec) override;
+    EKISOCKET_EXPORT size_t receive_into(std::span<char> buf, std::error_code& ec) override;
+    [[nodiscard]] EKISOCKET_EXPORT bool wait(bool want_read, bool want_write) const override;
+    EKISOCKET_EXPORT void set_timeout(int milliseconds) override;
+    [[nodiscard]] EKISOCKET_EXPORT int timeout() const override;
+    EKISOCKET_EXPORT void close() override;
+    [[nodiscard]] EKISOCKET_EXPORT socket_t native_handle() const override;
+    [[nodiscard]] EKISOCKET_EXPORT bool zero_copy_receive() const override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl {};
+};
+
+/**
+ * @brief One end of an in-process, unbounded pipe. Whatever one end sends, the other end receives, without any system
+ * calls involved, which makes it useful for testing and benchmarking the protocols at memory speed.
+ */
+class MemoryTransport : public Transport {
+public:
+    /**
+     * @brief Creates both ends of a pipe. Each end has to be connected before use.
+     *
+     * @return std::pair The two ends, e.g. a client and a server.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT static std::pair<std::unique_ptr<MemoryTransport>, std::unique_ptr<MemoryTransport>>
+    pair();
+
+    MemoryTransport(const MemoryTransport&) = delete;
+    MemoryTransport& operator=(const MemoryTransport&) = delete;
+    MemoryTransport(MemoryTransport&&) = delete;
+    MemoryTransport& operator=(MemoryTransport&&) = delete;
+    EKISOCKET_EXPORT ~MemoryTransport() override;
+
+    [[nodiscard]] EKISOCKET_EXPORT bool connected() const override;
+    EKISOCKET_EXPORT bool connect(std::error_code& ec) override;
+    EKISOCKET_EXPORT size_t send(std::string_view data, std::error_code& ec) override;
+    EKISOCKET_EXPORT size_t sendv(std::span<const std::string_view> bufs, std::error_code& ec) override;
+    EKISOCKET_EXPORT size_t receive_into(std::span<char> buf, std::error_code& ec) override;
+    [[nodiscard]] EKISOCKET_EXPORT bool wait(bool want_read, bool want_write) const override;
+    EKISOCKET_EXPORT void set_timeout(int milliseconds) override;
+    [[nodiscard]] EKISOCKET_EXPORT int timeout() const override;
+    EKISOCKET_EXPORT void close() override;
+
+private:
+    struct Impl;
+
+    explicit MemoryTransport(std::unique_ptr<Impl> impl);
+
+    std::unique_ptr<Impl> m_impl {};
+};
+} // namespace ekisocket
@@ -29,6 +29,14 @@ std::string get_random_base64_from(uint32_t source_len);
  * @return uint32_t A random number between in that range.
  */
 uint32_t get_random_number(uint32_t min = 0, uint32_t max = (std::numeric_limits<uint32_t>::max)());
+/**
+ * @brief Fills a buffer with cryptographically secure random bytes, from a generator local to the calling thread that
+ * only goes to the operating system to reseed.
+ *
+ * @param out The buffer to fill.
+ * @param len The number of bytes to write.
+ */
+EKISOCKET_EXPORT void fill_random(char* out, size_t len);
 /**
  * @brief Encodes an input string of a certain length into a base64 encoded string.
  *
@@ -45,7 +53,47 @@ uint32_t get_random_number(uint32_t min = 0, uint32_t max = (std::numeric_limits
  * @param key The "Sec-WebSocket-Key" sent to the server.
  * @return std::string The computed "Sec-WebSocket-Accept" header.
  */
-std::string compute_accept(const std::string& key);
+[[nodiscard]] EKISOCKET_EXPORT std::string compute_accept(const std::string& key);
+
+/**
+ * @brief Applies a WebSocket masking key to data, writing the result to out. Masking and unmasking are the same
+ * operation, and masking while copying a payload into a frame saves a separate pass over it. Uses the widest SIMD
+ * instructions the CPU supports (SSE2, AVX2 or AVX-512 on x86, NEON on ARM), selected at runtime.
+ *
+ * @param data The data to mask.
+ * @param out Where to write the masked data, at least data.size() bytes. May be data.data() itself, but must not
+ * overlap it otherwise.
+ * @param masking_key The masking key, its most significant byte applying to the first byte of the payload.
+ * @param offset The position of data within the payload, for masking a payload in pieces.
+ */
+EKISOCKET_EXPORT void mask(std::string_view data, char* out, uint32_t masking_key, size_t offset = 0);
+
+/**
+ * @brief Checks that data is valid UTF-8, as the payload of a TEXT message has to be: no overlong encodings,
+ * surrogates, code points above U+10FFFF or truncated characters. Checks 16 or 32 bytes at a time with SIMD lookup
+ * tables where the CPU supports it (SSE4.1 or AVX2 on x86, NEON on ARM), selected at runtime.
+ *
+ * @param data The data to check.
+ * @return bool Whether or not data is valid UTF-8.
+ */
+[[nodiscard]] EKISOCKET_EXPORT bool is_valid_utf8(std::string_view data);
+
+/**
+ * @brief Resolves every IPv4 address of a host.
+ *
+ * @param host The host to resolve.
+ * @param port The port that will be connected to.
+ * @return std::vector<std::string> The numeric addresses, without duplicates, empty if the lookup failed.
+ */
+std::vector<std::string> resolve_addresses(const std::string& host, uint16_t port);
+
+/**
+ * @brief Pins the calling thread to a CPU core, where supported (Linux and Windows).
+ *
+ * @param core The index of the core, wrapped around the number of available cores.
+ * @return bool Whether or not the thread was pinned.
+ */
+EKISOCKET_EXPORT bool pin_thread_to_core(size_t core);
 
 /* ------------------ String Helper Function (not all used) ----------------- */
 
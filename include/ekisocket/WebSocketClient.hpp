@@ -1,5 +1,12 @@
 #pragma once
+#include <chrono>
 #include <ekisocket/HttpClient.hpp>
+#include <memory>
+#include <vector>
+
+namespace ekisocket {
+class BufferPool;
+} // namespace ekisocket
 
 namespace ekisocket::ws {
 /**
@@ -36,11 +43,294 @@ struct Message {
 using MessageCallback = std::function<void(const Message& message)>;
 
 /**
- * @brief Represents a simple WebSocket client, can perform WebSocket connections with no support for extensions.
+ * @brief A message that does not own its data, which points into the buffers of the connection.
+ */
+struct MessageView {
+    /// The type of message received.
+    Opcode type {};
+    /// The message data, will be the close reason if the type is CLOSE. Only valid during the callback.
+    std::string_view data {};
+    /// The close code, if the message is a close message.
+    uint16_t code {};
+};
+
+using MessageViewCallback = std::function<void(const MessageView& message)>;
+
+/**
+ * @brief Owns a copy of message data, in storage that goes back to the pool of the client it came from once the
+ * buffer is destroyed. Obtained from Client::retain(), and may outlive the client.
+ */
+class MessageBuffer {
+public:
+    MessageBuffer() = default;
+    MessageBuffer(const MessageBuffer&) = delete;
+    MessageBuffer& operator=(const MessageBuffer&) = delete;
+    EKISOCKET_EXPORT MessageBuffer(MessageBuffer&& other) noexcept;
+    EKISOCKET_EXPORT MessageBuffer& operator=(MessageBuffer&& other) noexcept;
+    EKISOCKET_EXPORT ~MessageBuffer();
+
+    [[nodiscard]] std::string_view data() const { return m_buffer; }
+
+    [[nodiscard]] size_t size() const { return m_buffer.size(); }
+
+    [[nodiscard]] bool empty() const { return m_buffer.empty(); }
+
+private:
+    friend class Client;
+
+    MessageBuffer(std::shared_ptr<BufferPool> pool, std::string&& buffer);
+
+    std::shared_ptr<BufferPool> m_pool {};
+    std::string m_buffer {};
+};
+
+/**
+ * @brief A frame of a data message, as delivered to a FragmentCallback as soon as it has been received.
+ */
+struct Fragment {
+    /// The type of the message the frame belongs to, Opcode::TEXT or Opcode::BINARY.
+    Opcode type {};
+    /// The payload of the frame, decompressed if need be. Only valid during the callback.
+    std::string_view data {};
+    /// Whether or not this is the first frame of the message, and whether or not it is the last one.
+    bool first {};
+    bool last {};
+};
+
+using FragmentCallback = std::function<void(const Fragment& fragment)>;
+
+/**
+ * @brief What a client driven by an external event loop is waiting for on its descriptor.
+ */
+enum class Interest : uint8_t { NONE = 0, READ = 1, WRITE = 2, READ_WRITE = 3 };
+
+/**
+ * @brief The permessage-deflate (RFC 7692) parameters to offer in the handshake.
+ */
+struct DeflateOptions {
+    /// Asks the server to compress every message on its own, so that it keeps no window between messages.
+    bool server_no_context_takeover {};
+    /// Compresses every message sent on its own, trading compression ratio for the memory of the window.
+    bool client_no_context_takeover {};
+    /// The largest window the server may compress with, from 8 to 15 bits.
+    std::optional<uint8_t> server_max_window_bits {};
+    /// The largest window to compress with, from 9 to 15 bits.
+    std::optional<uint8_t> client_max_window_bits {};
+    /// Messages shorter than this are sent uncompressed, since deflating them costs more than it saves.
+    size_t min_message_size { 128 };
+};
+
+/**
+ * @brief How the server compresses a connection as a whole, independently of any WebSocket extension.
+ */
+enum class TransportCompression : uint8_t {
+    NONE,
+    /// One zlib stream across all messages, flushed at the end of each, e.g. Discord's "compress=zlib-stream".
+    ZLIB_STREAM,
+};
+
+/**
+ * @brief How much compression saves, and what it costs, over the lifetime of a client.
+ */
+struct CompressionStats {
+    /// The number of messages sent compressed.
+    uint64_t messages_deflated {};
+    /// The size of those messages before and after compression.
+    uint64_t deflate_bytes_in {};
+    uint64_t deflate_bytes_out {};
+    /// The time spent compressing them.
+    std::chrono::nanoseconds deflate_time {};
+    /// The number of compressed messages received, through permessage-deflate or a compressed transport.
+    uint64_t messages_inflated {};
+    /// The size of those messages before and after decompression.
+    uint64_t inflate_bytes_in {};
+    uint64_t inflate_bytes_out {};
+    /// The time spent decompressing them.
+    std::chrono::nanoseconds inflate_time {};
+};
+
+/**
+ * @brief How the client checks that the connection is alive.
+ */
+struct HeartbeatOptions {
+    /// How often to ping the server, 0 to never.
+    std::chrono::milliseconds interval { 30000 };
+    /// How many pings may go unanswered before the connection is dropped, 0 for no limit.
+    uint8_t max_missed { 3 };
+    /// What pings start with, so that their pongs can be told apart from others. The time the ping was sent follows
+    /// it, so the prefix can be at most 117 bytes long for the payload to fit in a control frame.
+    std::string payload_prefix { "--heartbeat--" };
+};
+
+/**
+ * @brief The round-trip time of the connection, measured with heartbeats and smoothed the way TCP does it (RFC 6298).
+ */
+struct RttStats {
+    /// The latest sample.
+    std::chrono::microseconds latest {};
+    /// The smoothed round-trip time.
+    std::chrono::microseconds smoothed {};
+    /// How much samples deviate from the smoothed round-trip time, on average.
+    std::chrono::microseconds jitter {};
+    /// The lowest sample.
+    std::chrono::microseconds min {};
+    /// The number of samples, since the connection was established.
+    uint64_t samples {};
+    /// The number of pings sent that have not been answered yet.
+    uint8_t missed_heartbeats {};
+};
+
+/**
+ * @brief Called with the updated statistics every time a heartbeat is answered.
+ */
+using RttCallback = std::function<void(const RttStats& stats)>;
+
+/**
+ * @brief How a client spaces out its attempts to reconnect after losing its connection. Every attempt waits a random
+ * time between 0 and initial_delay * multiplier^n, n being the number of attempts that failed before it, capped at
+ * max_delay ("full jitter"), so that clients disconnected at the same time do not all reconnect at the same time.
+ */
+struct ReconnectPolicy {
+    /// The longest wait before the first attempt.
+    std::chrono::milliseconds initial_delay { 1000 };
+    /// The longest wait, however many attempts failed.
+    std::chrono::milliseconds max_delay { 60000 };
+    /// How much the longest wait grows with every failed attempt.
+    double multiplier { 2.0 };
+    /// How many attempts in a row may fail before the client gives up, 0 for no limit.
+    uint32_t max_attempts {};
+};
+
+/**
+ * @brief Called once a lost connection has been re-established, before the OPEN message is dispatched, e.g. to resume
+ * the session that was going on.
+ *
+ * @param attempts How many attempts it took.
+ */
+using ReconnectCallback = std::function<void(uint32_t attempts)>;
+
+/**
+ * @brief Limits how fast the clients of the whole process, pooled or not, reconnect: a burst of them at once, then
+ * rate per second. Defaults to bursts of 100 and 100 per second.
+ *
+ * @param rate How many clients may reconnect per second, 0 for no limit.
+ * @param burst How many clients may reconnect at once.
+ */
+EKISOCKET_EXPORT void set_reconnect_rate(double rate, size_t burst);
+
+/**
+ * @brief What send() does when a message does not fit in the send buffer.
+ */
+enum class OverflowPolicy : uint8_t {
+    /// The message is refused with errors::Error::BUFFER_FULL.
+    FAIL,
+    /// send() waits for the buffer to drain, and fails with std::errc::timed_out if it does not in time. Must not be
+    /// used from the thread driving the connection, which is the one that drains the buffer.
+    BLOCK,
+    /// The oldest messages that are not being written yet are dropped to make room, and their completion callbacks
+    /// are called with errors::Error::BUFFER_FULL. Compressed messages are never dropped, since the messages after them
+    /// may refer back to them.
+    DROP_OLDEST,
+};
+
+/**
+ * @brief Bounds how much data may be queued for sending, so that a slow server cannot make memory grow without limit.
+ */
+struct SendBufferOptions {
+    /// The number of buffered bytes, frame headers included, past which messages overflow. A message larger than this
+    /// is still accepted when nothing else is buffered.
+    size_t high_watermark { size_t { 16 } * 1024 * 1024 };
+    /// Once the buffer overflowed, the number of buffered bytes it has to drain down to before the on_drain callback is
+    /// called and blocked senders retry.
+    size_t low_watermark { size_t { 4 } * 1024 * 1024 };
+    /// What happens to a message that overflows the buffer.
+    OverflowPolicy policy { OverflowPolicy::FAIL };
+    /// How long send() waits for room with OverflowPolicy::BLOCK.
+    std::chrono::milliseconds block_timeout { 5000 };
+};
+
+/**
+ * @brief Called once a message has been written to the transport, or with the reason it never will be.
+ */
+using SendCallback = std::function<void(const std::error_code& ec)>;
+
+/**
+ * @brief Represents a simple WebSocket client, can perform WebSocket connections with optional permessage-deflate
+ * compression.
  */
 class Client {
+    struct Impl;
+
 public:
+    /**
+     * @brief Streams a message as a sequence of frames, so that it never has to be held in memory whole. Other data
+     * messages cannot be sent until it is finished, but control frames such as heartbeats still go out between its
+     * frames. Obtained from Client::begin_message(), and must not outlive the client. Finishes the message when
+     * destroyed if finish() was not called.
+     */
+    class MessageWriter {
+    public:
+        MessageWriter() = default;
+        MessageWriter(const MessageWriter&) = delete;
+        MessageWriter& operator=(const MessageWriter&) = delete;
+        EKISOCKET_EXPORT MessageWriter(MessageWriter&& other) noexcept;
+        EKISOCKET_EXPORT MessageWriter& operator=(MessageWriter&& other) noexcept;
+        EKISOCKET_EXPORT ~MessageWriter();
+
+        /**
+         * @brief Sends the next fragment of the message. Empty chunks are skipped.
+         *
+         * @param chunk The data to append to the message.
+         * @param ec Set if the fragment could not be queued, e.g. errors::Error::BUFFER_FULL, in which case it can be
+         * written again.
+         * @return bool Whether or not the fragment was queued.
+         */
+        EKISOCKET_EXPORT bool write(std::string_view chunk, std::error_code& ec);
+
+        /**
+         * @brief Sends the last fragment of the message, after which other messages can be sent again.
+         *
+         * @param chunk The data that ends the message, which may be empty.
+         * @param ec Set if the fragment could not be queued.
+         * @return bool Whether or not the message is now complete.
+         */
+        EKISOCKET_EXPORT bool finish(std::string_view chunk, std::error_code& ec);
+
+        /**
+         * @brief Same as the overload above, with no more data.
+         */
+        EKISOCKET_EXPORT bool finish(std::error_code& ec);
+
+    private:
+        friend class Client;
+
+        MessageWriter(Impl* impl, Opcode type, uint64_t connection);
+
+        /**
+         * @brief Sends a fragment, with the opcode of the message if it is the first one.
+         */
+        bool send_fragment(std::string_view chunk, bool fin, std::error_code& ec);
+
+        Impl* m_impl {};
+        /// The type of the message, sent with its first frame only.
+        Opcode m_type {};
+        /// The connection the message is sent on, which it cannot outlive.
+        uint64_t m_connection {};
+        /// Whether or not the first frame has been sent, and whether or not the last one has.
+        bool m_started {};
+        bool m_finished {};
+    };
+
     EKISOCKET_EXPORT explicit Client(std::string_view url = "");
+
+    /**
+     * @brief Creates a client whose connections are made through the given factory, e.g. to run over a Unix socket or
+     * a MemoryTransport.
+     *
+     * @param url The url to connect to.
+     * @param factory Creates the transport of every new connection.
+     */
+    EKISOCKET_EXPORT Client(std::string_view url, TransportFactory factory);
     Client(const Client&) = delete;
     Client& operator=(const Client&) = delete;
     EKISOCKET_EXPORT Client(Client&&) noexcept;
@@ -56,6 +346,11 @@ public:
      */
     [[nodiscard]] EKISOCKET_EXPORT const std::string& get_url() const;
 
+    /**
+     * @brief Get the status of the connection.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT Status status() const;
+
     /**
      * @brief Sets whether or not automatic reconnection should be enabled or not. If on, when disconnecting, the client
      * will attempt to reconnect.
@@ -64,6 +359,29 @@ public:
      */
     EKISOCKET_EXPORT void set_automatic_reconnect(bool reconnect) const;
 
+    /**
+     * @brief Sets how long the client waits before every attempt to reconnect.
+     *
+     * @param policy The reconnection policy.
+     */
+    EKISOCKET_EXPORT void set_reconnect_policy(const ReconnectPolicy& policy) const;
+
+    /**
+     * @brief Set a callback function to be called, from the thread driving the connection, every time a lost
+     * connection has been re-established.
+     *
+     * @param cb The callback function.
+     */
+    EKISOCKET_EXPORT void set_on_reconnect(ReconnectCallback cb) const;
+
+    /**
+     * @brief Counts an attempt to reconnect, and draws how long to wait before making it. The client only reconnects
+     * if automatic reconnection is on, a connection was established before and the attempts are not used up.
+     *
+     * @return std::optional How long to wait, or std::nullopt if the client should not reconnect.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT std::optional<std::chrono::milliseconds> next_reconnect_delay() const;
+
     /**
      * @brief Set a callback function to be called when a message is received.
      *
@@ -71,6 +389,40 @@ public:
      */
     EKISOCKET_EXPORT void set_on_message(const MessageCallback& cb) const;
 
+    /**
+     * @brief Set a callback function to be called with every frame of the data messages received, instead of calling
+     * the message callback once they are complete. Messages are then never buffered whole, except when the server
+     * compresses the connection as a whole, in which case every message is delivered as a single fragment.
+     *
+     * @param cb The callback function, or an empty function to go back to receiving whole messages.
+     */
+    EKISOCKET_EXPORT void set_on_fragment(const FragmentCallback& cb) const;
+
+    /**
+     * @brief Set a callback function to be called when a message is received, instead of the message callback. The
+     * message is not copied out of the buffers of the connection, and is only valid during the callback, so data that
+     * has to be kept around is copied with retain().
+     *
+     * @param cb The callback function, or an empty function to go back to the message callback.
+     */
+    EKISOCKET_EXPORT void set_on_message_view(const MessageViewCallback& cb) const;
+
+    /**
+     * @brief Copies data, typically that of a MessageView, into a buffer recycled from earlier messages.
+     *
+     * @param data The data to copy.
+     * @return MessageBuffer The copy, whose storage is recycled once it is destroyed.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT MessageBuffer retain(std::string_view data) const;
+
+    /**
+     * @brief Sets the largest data message accepted, after decompression. A larger message closes the connection with
+     * code 1009, and is reported as an Opcode::BAD message. There is no limit by default.
+     *
+     * @param size The largest message size, in bytes.
+     */
+    EKISOCKET_EXPORT void set_max_message_size(size_t size) const;
+
     /**
      * @brief Set the url to connect to. If there are any query parameters, they will be parsed and added as well.
      *
@@ -78,6 +430,128 @@ public:
      */
     EKISOCKET_EXPORT void set_url(std::string_view url) const;
 
+    /**
+     * @brief Set a callback function to be called, from any thread, whenever a message or a close frame is queued. An
+     * external event loop can use it to wake up and re-check interest().
+     *
+     * @param cb The callback function.
+     */
+    EKISOCKET_EXPORT void set_wakeup(std::function<void()> cb) const;
+
+    /**
+     * @brief Offers permessage-deflate in the handshake of the next connections, or stops offering it. Messages are
+     * only compressed when the server accepts the offer.
+     *
+     * @param options The parameters to offer, or std::nullopt to disable compression.
+     */
+    EKISOCKET_EXPORT void set_compression(std::optional<DeflateOptions> options) const;
+
+    /**
+     * @brief Sets headers to send with the handshake of the next connections, e.g. Authorization or Cookie, so that
+     * the session is authenticated by the time it opens. The headers the handshake sets itself cannot be overridden.
+     *
+     * @param headers The additional headers.
+     */
+    EKISOCKET_EXPORT void set_handshake_headers(const http::Headers& headers) const;
+
+    /**
+     * @brief Offers subprotocols in the handshake of the next connections. The server selects one of them, or none,
+     * and the handshake fails if it selects one that was not offered.
+     *
+     * @param protocols The subprotocols, by order of preference, or none to stop offering them.
+     */
+    EKISOCKET_EXPORT void set_subprotocols(std::vector<std::string> protocols) const;
+
+    /**
+     * @brief The subprotocol the server selected for the current connection.
+     *
+     * @return std::string The subprotocol, or an empty string if the server selected none.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT std::string subprotocol() const;
+
+    /**
+     * @brief The headers of the response to the handshake of the current connection.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT http::Headers handshake_headers() const;
+
+    /**
+     * @brief Sets how the server compresses the next connections as a whole. The server has to be asked for it
+     * separately, e.g. with "compress=zlib-stream" in the URL. Decompressed messages keep the opcode of their frames.
+     *
+     * @param compression The compression of the whole connection.
+     */
+    EKISOCKET_EXPORT void set_transport_compression(TransportCompression compression) const;
+
+    /**
+     * @brief Whether or not the current connection negotiated permessage-deflate.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT bool compression_enabled() const;
+
+    /**
+     * @brief The compression ratio and CPU time of all the messages compressed and decompressed so far.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT CompressionStats compression_stats() const;
+
+    /**
+     * @brief Sets how much data may be queued for sending, and what happens to messages that do not fit. Control frames
+     * such as heartbeats and the CLOSE frame are always queued, but count towards the buffer.
+     *
+     * @param options The limits of the send buffer.
+     */
+    EKISOCKET_EXPORT void set_send_buffer(const SendBufferOptions& options) const;
+
+    /**
+     * @brief Sets how often the client pings the server, and how many unanswered pings it tolerates. Takes effect from
+     * the next heartbeat.
+     *
+     * @param options The heartbeat options.
+     */
+    EKISOCKET_EXPORT void set_heartbeat(const HeartbeatOptions& options) const;
+
+    /**
+     * @brief Sets how long the server has to complete the opening handshake, and to answer a CLOSE frame. Both default
+     * to 2 minutes.
+     *
+     * @param handshake The handshake timeout.
+     * @param close The close timeout.
+     */
+    EKISOCKET_EXPORT void set_timeouts(std::chrono::milliseconds handshake, std::chrono::milliseconds close) const;
+
+    /**
+     * @brief The round-trip time of the current connection, and its health in terms of unanswered heartbeats.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT RttStats rtt_stats() const;
+
+    /**
+     * @brief Set a callback function to be called, from the thread driving the connection, with every new round-trip
+     * time sample.
+     *
+     * @param cb The callback function.
+     */
+    EKISOCKET_EXPORT void set_on_rtt(RttCallback cb) const;
+
+    /**
+     * @brief Sets how long the connection may go without receiving anything, pongs included, before the client closes
+     * it. Like heartbeats, the timeout is a deadline of the connection (see next_deadline()), not a thread. Disabled
+     * by default.
+     *
+     * @param timeout The idle timeout, 0 to disable it.
+     */
+    EKISOCKET_EXPORT void set_idle_timeout(std::chrono::milliseconds timeout) const;
+
+    /**
+     * @brief Set a callback function to be called, from the thread driving the connection, when the send buffer has
+     * drained down to its low watermark after a message overflowed it.
+     *
+     * @param cb The callback function.
+     */
+    EKISOCKET_EXPORT void set_on_drain(std::function<void()> cb) const;
+
+    /**
+     * @brief The number of bytes queued that have not been written to the transport yet, frame headers included.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT size_t buffered_amount() const;
+
     /**
      * @brief Sends payload data of type Text to the server.
      *
@@ -87,10 +561,97 @@ public:
     EKISOCKET_EXPORT bool send(std::string_view message) const;
 
     /**
-     * @brief Starts the WebSocket and connects to the server, polling for messages. This will be blocking.
+     * @brief Same as the overload above, but sets ec to errors::Error::NOT_OPEN if the message could not be queued.
+     */
+    EKISOCKET_EXPORT bool send(std::string_view message, std::error_code& ec) const;
+
+    /**
+     * @brief Same as the overload above, but calls on_sent once the message has been written to the transport, or could
+     * not be. It is called from the thread driving the connection, or from the thread of the send() that dropped the
+     * message, and not at all if the message is not queued in the first place.
+     *
+     * @param message The payload data to send.
+     * @param on_sent Called with an empty error code once the message has been written.
+     * @param ec Set if the message could not be queued.
+     * @return bool Whether or not the message was queued.
+     */
+    EKISOCKET_EXPORT bool send(std::string_view message, SendCallback on_sent, std::error_code& ec) const;
+
+    /**
+     * @brief Sends payload data of type Binary to the server.
+     *
+     * @param message The payload data to send.
+     * @return bool Whether or not the message was sent successfully.
+     */
+    EKISOCKET_EXPORT bool send_binary(std::string_view message) const;
+
+    /**
+     * @brief Same as the overload above, but sets ec if the message could not be queued.
+     */
+    EKISOCKET_EXPORT bool send_binary(std::string_view message, std::error_code& ec) const;
+
+    /**
+     * @brief Same as the overload above, but calls on_sent once the message has been written, as send() does.
+     */
+    EKISOCKET_EXPORT bool send_binary(std::string_view message, SendCallback on_sent, std::error_code& ec) const;
+
+    /**
+     * @brief Starts streaming a message whose size is not known up front, or that is too large to hold in memory. With
+     * permessage-deflate, streamed messages are always compressed. Sending blocks or fails on a full send buffer, as
+     * send() does.
+     *
+     * @param type Opcode::TEXT or Opcode::BINARY.
+     * @param ec Set if the message cannot be started, e.g. errors::Error::MESSAGE_IN_PROGRESS if another message is
+     * being streamed.
+     * @return MessageWriter The writer of the message, which does nothing if ec is set.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT MessageWriter begin_message(Opcode type, std::error_code& ec) const;
+
+    /**
+     * @brief Connects to the server and performs the handshake, without driving the connection afterwards. Used
+     * together with fd(), interest(), next_deadline() and the on_* functions to run the client on an external event
+     * loop, with no threads of its own.
+     *
+     * @return bool Whether or not the connection is now open.
+     */
+    EKISOCKET_EXPORT bool open() const;
+
+    /**
+     * @brief Same as the overload above, but sets ec instead of throwing.
+     */
+    EKISOCKET_EXPORT bool open(std::error_code& ec) const;
+
+    /**
+     * @brief Connects to the server and queues the handshake, without waiting for it. The handshake then completes
+     * through on_writable() and on_readable(), like the rest of the connection. Only establishing the connection itself
+     * (name lookup, TCP and TLS) blocks.
+     *
+     * @param ec Set if the connection could not be established.
+     * @return bool Whether or not the handshake is now underway.
+     */
+    EKISOCKET_EXPORT bool begin_open(std::error_code& ec) const;
+
+    /**
+     * @brief Why the last attempt to open the connection failed, e.g. errors::Error::HANDSHAKE_FAILED when the server
+     * rejected the handshake that begin_open() started.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT std::error_code open_error() const;
+
+    /**
+     * @brief Starts the WebSocket and connects to the server, polling for messages. This will be blocking. Lost
+     * connections are re-established as set_reconnect_policy() describes, until automatic reconnection is turned off
+     * or the attempts are used up.
      */
     EKISOCKET_EXPORT void start() const;
 
+    /**
+     * @brief Same as the overload above, but instead of throwing, returns with ec set when a connection attempt fails
+     * (including rejected handshakes, reported as errors::Error::HANDSHAKE_FAILED).
+     *
+     * @param ec Set if the client could not connect to the server.
+     */
+    EKISOCKET_EXPORT void start(std::error_code& ec) const;
+
     /**
      * @brief Starts the WebSocket connection, but on a seperate thread. Good for long-running connections.
      */
@@ -104,8 +665,46 @@ public:
      */
     EKISOCKET_EXPORT void close(uint16_t code = 1000, std::string_view reason = "") const;
 
+    /**
+     * @brief The descriptor to watch once open() succeeded.
+     *
+     * @return socket_t The descriptor, or an invalid socket if there is no open connection or the transport has none.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT socket_t fd() const;
+
+    /**
+     * @brief What the client is waiting for on fd(), which changes whenever frames are queued or written.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT Interest interest() const;
+
+    /**
+     * @brief When on_timer() has to be called next, for heartbeats and the close timeout.
+     *
+     * @return std::optional The deadline, if there is one.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT std::optional<std::chrono::steady_clock::time_point> next_deadline() const;
+
+    /**
+     * @brief Reads and dispatches whatever has arrived. Call when fd() is readable. Never blocks.
+     */
+    EKISOCKET_EXPORT void on_readable() const;
+
+    /**
+     * @brief Writes as much of the queued frames as possible. Call when fd() is writable. Never blocks.
+     */
+    EKISOCKET_EXPORT void on_writable() const;
+
+    /**
+     * @brief Sends heartbeats and enforces timeouts. Call once next_deadline() has passed. Never blocks.
+     */
+    EKISOCKET_EXPORT void on_timer() const;
+
 private:
-    struct Impl;
+    /**
+     * @brief Throws the error returned by a failed connection attempt, the way start() always has.
+     */
+    static void throw_start_error(const std::error_code& ec);
+
     std::unique_ptr<Impl> m_impl {};
 };
 } // namespace ekisocket::ws
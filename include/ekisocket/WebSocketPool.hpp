@@ -0,0 +1,59 @@
+#pragma once
+#include <ekisocket/WebSocketClient.hpp>
+
+namespace ekisocket::ws {
+/**
+ * @brief Runs many WebSocket connections on a fixed number of reactor threads. Each reactor waits for the readiness
+ * of all of its connections at once (epoll on Linux, poll elsewhere) and drives their handshakes, frames, heartbeats
+ * and close handshakes without blocking, so an idle connection costs no thread at all.
+ *
+ * Establishing a connection (name lookup, TCP and TLS) still blocks, so it is done by separate connector threads
+ * before the connection is handed over to the least loaded reactor. Message callbacks run on the reactor of their
+ * connection, and should not block either.
+ */
+class Pool {
+public:
+    /**
+     * @brief Creates the pool and starts its threads.
+     *
+     * @param threads The number of reactor threads, 0 meaning one per core.
+     */
+    EKISOCKET_EXPORT explicit Pool(size_t threads = 0);
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+    EKISOCKET_EXPORT Pool(Pool&&) noexcept;
+    EKISOCKET_EXPORT Pool& operator=(Pool&&) noexcept;
+    EKISOCKET_EXPORT ~Pool();
+
+    /**
+     * @brief Takes over a client and connects it. Connections that are lost are reconnected if the client has
+     * automatic reconnection enabled. The wakeup callback of the client is used by the pool, and must not be replaced.
+     *
+     * @param client The client, with its URL and callbacks already set.
+     * @return Client& The client, valid until it is removed or the pool is destroyed.
+     */
+    EKISOCKET_EXPORT Client& add(Client client) const;
+
+    /**
+     * @brief Removes a client from the pool, dropping its connection without a close handshake (call close() first
+     * for a graceful one). Blocks until no thread of the pool uses the client anymore.
+     *
+     * @param client The client, as returned by add().
+     */
+    EKISOCKET_EXPORT void remove(const Client& client) const;
+
+    /**
+     * @brief The number of clients in the pool, connected or not.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT size_t size() const;
+
+    /**
+     * @brief The number of reactor threads.
+     */
+    [[nodiscard]] EKISOCKET_EXPORT size_t thread_count() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl {};
+};
+} // namespace ekisocket::ws
@@ -0,0 +1,62 @@
+#pragma once
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ekisocket {
+/**
+ * @brief Keeps the buffers of finished messages around, so that new messages can reuse their memory instead of
+ * allocating. Safe to use from any thread.
+ */
+class BufferPool {
+public:
+    /**
+     * @param max_buffers The most buffers kept at once.
+     * @param max_capacity Larger buffers are freed instead of being kept.
+     */
+    BufferPool(size_t max_buffers, size_t max_capacity)
+        : m_max_buffers { max_buffers }
+        , m_max_capacity { max_capacity }
+    {
+    }
+
+    /**
+     * @brief Takes a buffer from the pool. Its contents are left over from its last use, so that resizing it to a
+     * size it already had does not write to it.
+     *
+     * @return std::string A buffer, empty if the pool is.
+     */
+    [[nodiscard]] std::string acquire()
+    {
+        std::scoped_lock lk { m_mtx };
+        if (m_buffers.empty()) {
+            return {};
+        }
+
+        auto ret = std::move(m_buffers.back());
+        m_buffers.pop_back();
+        return ret;
+    }
+
+    /**
+     * @brief Gives a buffer back to the pool, once nothing refers to it anymore.
+     */
+    void release(std::string&& buffer)
+    {
+        if (buffer.capacity() == 0 || buffer.capacity() > m_max_capacity) {
+            return;
+        }
+
+        std::scoped_lock lk { m_mtx };
+        if (m_buffers.size() < m_max_buffers) {
+            m_buffers.push_back(std::move(buffer));
+        }
+    }
+
+private:
+    std::mutex m_mtx {};
+    std::vector<std::string> m_buffers {};
+    size_t m_max_buffers {};
+    size_t m_max_capacity {};
+};
+} // namespace ekisocket
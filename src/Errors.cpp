@@ -0,0 +1,75 @@
+#include <array>
+#include <ekisocket/Errors.hpp>
+#include <openssl/err.h>
+#include <string>
+
+namespace {
+struct ErrorCategory : std::error_category {
+    [[nodiscard]] const char* name() const noexcept override { return "ekisocket"; }
+
+    [[nodiscard]] std::string message(int ev) const override
+    {
+        using enum ekisocket::errors::Error;
+
+        switch (static_cast<ekisocket::errors::Error>(ev)) {
+        case NOT_CONNECTED:
+            return "Not connected";
+        case MESSAGE_TOO_LONG:
+            return "Message too long";
+        case LOOKUP_FAILED:
+            return "Unable to lookup address";
+        case CONNECT_FAILED:
+            return "Unable to connect to host";
+        case SSL_FAILED:
+            return "Unable to establish SSL session";
+        case CERTIFICATE_INVALID:
+            return "Certificate verification failed";
+        case CONNECTION_CLOSED:
+            return "Connection closed by peer";
+        case INVALID_SCHEME:
+            return "Invalid scheme";
+        case INVALID_METHOD:
+            return "Invalid method";
+        case INVALID_RESPONSE:
+            return "Invalid response";
+        case URL_NOT_SET:
+            return "URL not set";
+        case HANDSHAKE_FAILED:
+            return "WebSocket handshake failed";
+        case NOT_OPEN:
+            return "WebSocket connection is not open";
+        case BUFFER_FULL:
+            return "WebSocket send buffer is full";
+        case MESSAGE_IN_PROGRESS:
+            return "Another WebSocket message is being streamed";
+        }
+        return "Unknown error";
+    }
+};
+
+struct SslCategory : std::error_category {
+    [[nodiscard]] const char* name() const noexcept override { return "openssl"; }
+
+    [[nodiscard]] std::string message(int ev) const override
+    {
+        // Only formatted when asked for, as the lookup is comparatively expensive.
+        std::array<char, 256> buf {};
+        ERR_error_string_n(static_cast<unsigned long>(ev), buf.data(), buf.size());
+        return buf.data();
+    }
+};
+} // namespace
+
+namespace ekisocket::errors {
+const std::error_category& category() noexcept
+{
+    static const ErrorCategory instance {};
+    return instance;
+}
+
+const std::error_category& ssl_category() noexcept
+{
+    static const SslCategory instance {};
+    return instance;
+}
+} // namespace ekisocket::errors
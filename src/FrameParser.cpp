@@ -0,0 +1,136 @@
+#include <FrameParser.hpp>
+#include <algorithm>
+#include <cstring>
+#include <ekisocket/Util.hpp>
+
+namespace ekisocket::ws {
+std::span<char> FrameParser::prepare(size_t min_size)
+{
+    if (m_buffer.size() - m_write < min_size) {
+        // Move what is left to the front, which is at most the beginning of a frame, and grow if that is not enough.
+        const auto size = m_write - m_read;
+
+        if (m_read > 0) {
+            std::memmove(m_buffer.data(), m_buffer.data() + m_read, size);
+            m_read = 0;
+            m_write = size;
+        }
+        if (m_buffer.size() - m_write < min_size) {
+            m_buffer.resize((std::max)(m_buffer.size() * 2, m_write + min_size));
+        }
+    }
+    return std::span { m_buffer }.subspan(m_write);
+}
+
+void FrameParser::consume(size_t size)
+{
+    m_read += size;
+    // Once everything has been consumed, the next read can start from the front again for free.
+    if (m_read == m_write) {
+        m_read = 0;
+        m_write = 0;
+    }
+}
+
+std::optional<FrameView> FrameParser::next()
+{
+    if (m_skip > 0) {
+        const auto size = (std::min)(m_skip, uint64_t { m_write - m_read });
+
+        m_skip -= size;
+        consume(size);
+        if (m_skip > 0) {
+            return std::nullopt;
+        }
+    }
+
+    if (!m_header) {
+        m_header = parse_header();
+        if (!m_header) {
+            return std::nullopt;
+        }
+    }
+
+    const auto frame_length = m_header->header_length + m_header->payload_length;
+
+    // The rest of the payload has not arrived yet.
+    if (m_write - m_read < frame_length) {
+        return std::nullopt;
+    }
+
+    auto* payload = m_buffer.data() + m_read + m_header->header_length;
+    const size_t payload_length = m_header->payload_length;
+
+    // Servers should not mask their frames, but if they do, the payload is unmasked in place.
+    if (m_header->masking_key) {
+        util::mask({ payload, payload_length }, payload, *m_header->masking_key);
+    }
+
+    const FrameView frame { m_header->fin, m_header->rsv1, m_header->opcode, { payload, payload_length } };
+
+    m_header.reset();
+    m_read += frame_length;
+    // Unlike consume(), the cursors are not reset, since the frame still points into the buffer.
+    return frame;
+}
+
+void FrameParser::skip_pending()
+{
+    if (m_header) {
+        m_skip = m_header->header_length + m_header->payload_length;
+        m_header.reset();
+    }
+}
+
+void FrameParser::clear()
+{
+    m_read = 0;
+    m_write = 0;
+    m_header.reset();
+    m_skip = 0;
+}
+
+std::optional<FrameParser::Header> FrameParser::parse_header() const
+{
+    const auto available = m_write - m_read;
+    const auto* data = reinterpret_cast<const uint8_t*>(m_buffer.data() + m_read);
+
+    // Not even the first two bytes of the header are here yet.
+    if (available < 2) {
+        return std::nullopt;
+    }
+
+    Header ret {};
+    ret.fin = (data[0] & 0x80U) != 0;
+    ret.rsv1 = (data[0] & 0x40U) != 0;
+    ret.opcode = static_cast<uint8_t>(data[0] & 0x0FU);
+
+    const auto masked = (data[1] & 0x80U) != 0;
+    const auto length = static_cast<uint8_t>(data[1] & 0x7FU);
+
+    // A length of 126 means the length is in the next 2 bytes, and 127 means it is in the next 8 bytes.
+    const size_t length_size = length == 126 ? 2 : length == 127 ? 8 : 0;
+
+    ret.header_length = 2 + length_size + (masked ? 4 : 0);
+
+    if (available < ret.header_length) {
+        return std::nullopt;
+    }
+
+    ret.payload_length = length;
+    if (length_size > 0) {
+        ret.payload_length = 0;
+        for (size_t i {}; i < length_size; ++i) {
+            ret.payload_length = (ret.payload_length << 8U) | data[2 + i];
+        }
+    }
+    if (masked) {
+        uint32_t key {};
+        for (size_t i {}; i < 4; ++i) {
+            key = (key << 8U) | data[2 + length_size + i];
+        }
+        ret.masking_key = key;
+    }
+    return ret;
+}
+} // namespace ekisocket::ws
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ekisocket::ws {
+/**
+ * @brief A complete frame, as parsed by a FrameParser.
+ */
+struct FrameView {
+    bool fin {};
+    /// The RSV1 bit, which extensions such as permessage-deflate use to flag a message.
+    bool rsv1 {};
+    uint8_t opcode {};
+    /// The unmasked payload, pointing into the buffer of the parser.
+    std::string_view payload {};
+};
+
+/**
+ * @brief Splits the stream received from a WebSocket server into frames, incrementally and without blocking. Data is
+ * received straight into the buffer of the parser, and frames are handed out as views into it, so payloads are never
+ * copied by the parser.
+ *
+ * The buffer is used like a ring: consuming data only advances the read cursor, and unconsumed data is moved back to
+ * the front only when there is no room left behind it. That only ever moves the beginning of a single frame, which
+ * keeps every frame contiguous.
+ */
+class FrameParser {
+public:
+    /**
+     * @brief Makes room for at least min_size more bytes.
+     *
+     * @return std::span The room, to receive into and then commit().
+     */
+    [[nodiscard]] std::span<char> prepare(size_t min_size);
+
+    /**
+     * @brief Adds the first size bytes of the room returned by prepare() to the data.
+     */
+    void commit(size_t size) { m_write += size; }
+
+    /**
+     * @brief The data that has been received, but not consumed yet.
+     */
+    [[nodiscard]] std::string_view data() const { return { m_buffer.data() + m_read, m_write - m_read }; }
+
+    /**
+     * @brief Discards the first size bytes of data().
+     */
+    void consume(size_t size);
+
+    /**
+     * @brief Parses and consumes the next frame, if it has been received completely. The header of a frame is only
+     * parsed once, however many reads its payload takes to arrive.
+     *
+     * @return std::optional The frame, valid until the next call to prepare() or clear().
+     */
+    [[nodiscard]] std::optional<FrameView> next();
+
+    /**
+     * @brief The payload length of the frame next() is waiting for, once its header has been parsed.
+     */
+    [[nodiscard]] std::optional<uint64_t> pending_payload_length() const
+    {
+        return m_header ? std::optional { m_header->payload_length } : std::nullopt;
+    }
+
+    /**
+     * @brief Discards the frame next() is waiting for, including the part of it that has not been received yet, so
+     * that a frame too large to be processed never has to be buffered.
+     */
+    void skip_pending();
+
+    /**
+     * @brief Discards all data and any partially parsed frame.
+     */
+    void clear();
+
+private:
+    /**
+     * @brief The header of the frame being received.
+     */
+    struct Header {
+        bool fin {};
+        bool rsv1 {};
+        uint8_t opcode {};
+        std::optional<uint32_t> masking_key {};
+        size_t header_length {};
+        uint64_t payload_length {};
+    };
+
+    /**
+     * @brief Parses the header at the read cursor, if it has been received completely.
+     */
+    [[nodiscard]] std::optional<Header> parse_header() const;
+
+    std::vector<char> m_buffer {};
+    /// Where data() begins.
+    size_t m_read {};
+    /// Where data() ends, and the room returned by prepare() begins.
+    size_t m_write {};
+    /// The header of the frame at the read cursor, once it has been parsed.
+    std::optional<Header> m_header {};
+    /// How much of a skipped frame has yet to be received and discarded.
+    uint64_t m_skip {};
+};
+} // namespace ekisocket::ws
@@ -0,0 +1,214 @@
+#include <Handshake.hpp>
+#include <Random.hpp>
+#include <algorithm>
+#include <charconv>
+#include <openssl/sha.h>
+#include <utility>
+
+namespace {
+/// What the key is suffixed with before being hashed into the accept value (RFC 6455 section 1.3).
+constexpr std::string_view ACCEPT_GUID { "258EAFA5-E914-47DA-95CA-C5AB0DC85B11" };
+/// The headers the handshake sets itself, which additional headers cannot override.
+constexpr std::string_view RESERVED_HEADERS[] { "Host", "Connection", "Upgrade", "Sec-WebSocket-Version",
+    "Sec-WebSocket-Extensions", "Sec-WebSocket-Key", "Sec-WebSocket-Protocol" };
+constexpr std::string_view BASE64_ALPHABET { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" };
+
+/**
+ * @brief Encodes len bytes in base64, with padding, into out, which must have room for 4 characters per 3 bytes.
+ */
+void base64_into(const uint8_t* in, size_t len, char* out)
+{
+    for (; len >= 3; in += 3, len -= 3, out += 4) {
+        const auto triple = (uint32_t { in[0] } << 16U) | (uint32_t { in[1] } << 8U) | in[2];
+
+        out[0] = BASE64_ALPHABET[(triple >> 18U) & 0x3FU];
+        out[1] = BASE64_ALPHABET[(triple >> 12U) & 0x3FU];
+        out[2] = BASE64_ALPHABET[(triple >> 6U) & 0x3FU];
+        out[3] = BASE64_ALPHABET[triple & 0x3FU];
+    }
+    if (len > 0) {
+        const auto triple = (uint32_t { in[0] } << 16U) | (len == 2 ? uint32_t { in[1] } << 8U : 0U);
+
+        out[0] = BASE64_ALPHABET[(triple >> 18U) & 0x3FU];
+        out[1] = BASE64_ALPHABET[(triple >> 12U) & 0x3FU];
+        out[2] = len == 2 ? BASE64_ALPHABET[(triple >> 6U) & 0x3FU] : '=';
+        out[3] = '=';
+    }
+}
+
+[[nodiscard]] std::string_view trim(std::string_view value)
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+[[nodiscard]] bool iequals(std::string_view a, std::string_view b)
+{
+    return std::ranges::equal(a, b, [](char x, char y) {
+        return (x >= 'A' && x <= 'Z' ? x + 32 : x) == (y >= 'A' && y <= 'Z' ? y + 32 : y);
+    });
+}
+
+/**
+ * @brief Whether or not a comma-separated list of tokens, such as the Connection header, has the given one.
+ */
+[[nodiscard]] bool has_token(std::string_view list, std::string_view token)
+{
+    while (!list.empty()) {
+        const auto comma = list.find(',');
+
+        if (iequals(trim(list.substr(0, comma)), token)) {
+            return true;
+        }
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+    }
+    return false;
+}
+} // namespace
+
+namespace ekisocket::ws {
+void Handshake::prepare(const http::Uri& uri, std::string_view extensions, const util::CaseInsensitiveMap& headers,
+    const std::vector<std::string>& protocols)
+{
+    m_template = "GET ";
+    m_template += uri.path.empty() ? "/" : uri.path;
+
+    char separator { '?' };
+    for (const auto& [key, value] : uri.query) {
+        m_template += std::exchange(separator, '&');
+        m_template += key;
+        m_template += '=';
+        m_template += value;
+    }
+
+    m_template += " HTTP/1.1\r\nHost: ";
+    m_template += uri.host;
+    if (uri.port.has_value()) {
+        std::array<char, 8> port {};
+        const auto [end, ec] = std::to_chars(port.data(), port.data() + port.size(), *uri.port);
+
+        m_template += ':';
+        m_template.append(port.data(), end);
+    }
+    m_template += "\r\nConnection: Upgrade\r\nUpgrade: websocket\r\nSec-WebSocket-Version: 13\r\n";
+    if (!extensions.empty()) {
+        m_template += "Sec-WebSocket-Extensions: ";
+        m_template += extensions;
+        m_template += "\r\n";
+    }
+
+    m_protocols = protocols;
+    if (!m_protocols.empty()) {
+        m_template += "Sec-WebSocket-Protocol: ";
+        for (size_t i {}; i < m_protocols.size(); ++i) {
+            m_template += i == 0 ? "" : ", ";
+            m_template += m_protocols[i];
+        }
+        m_template += "\r\n";
+    }
+    for (const auto& [name, value] : headers) {
+        if (std::ranges::none_of(RESERVED_HEADERS, [&name](auto reserved) { return iequals(name, reserved); })) {
+            m_template += name;
+            m_template += ": ";
+            m_template += value;
+            m_template += "\r\n";
+        }
+    }
+    m_template += "Sec-WebSocket-Key: ";
+    m_key_offset = m_template.size();
+    m_template += "\r\n\r\n";
+}
+
+std::string Handshake::request()
+{
+    std::array<uint8_t, 16> nonce {};
+
+    ChaChaRng::local().fill(nonce.data(), nonce.size());
+    base64_into(nonce.data(), nonce.size(), m_key.data());
+    m_accept = accept_for(key());
+
+    std::string ret {};
+    ret.reserve(m_template.size() + KEY_LENGTH);
+    ret.append(m_template, 0, m_key_offset);
+    ret += key();
+    ret.append(m_template, m_key_offset);
+    return ret;
+}
+
+std::optional<HandshakeResponse> Handshake::validate(std::string_view head) const
+{
+    // The status line looks like "HTTP/1.1 101 Switching Protocols".
+    const auto end_of_status_line = (std::min)(head.find("\r\n"), head.size());
+    const auto status_line = head.substr(0, end_of_status_line);
+    const auto space = status_line.find(' ');
+
+    if (space == std::string_view::npos || status_line.substr(space + 1, 3) != "101"
+        || (status_line.size() > space + 4 && status_line[space + 4] != ' ')) {
+        return std::nullopt;
+    }
+
+    HandshakeResponse ret {};
+    bool upgrade {};
+    bool connection {};
+    bool accepted {};
+
+    for (auto start = end_of_status_line + 2; start < head.size();) {
+        const auto end = (std::min)(head.find("\r\n", start), head.size());
+        const auto line = head.substr(start, end - start);
+        const auto colon = line.find(':');
+
+        start = end + 2;
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+
+        const auto name = line.substr(0, colon);
+        const auto value = trim(line.substr(colon + 1));
+
+        if (iequals(name, "Upgrade")) {
+            upgrade = iequals(value, "websocket");
+        } else if (iequals(name, "Connection")) {
+            connection = has_token(value, "Upgrade");
+        } else if (iequals(name, "Sec-WebSocket-Accept")) {
+            accepted = value == std::string_view { m_accept.data(), m_accept.size() };
+        } else if (iequals(name, "Sec-WebSocket-Extensions")) {
+            ret.extensions = value;
+        } else if (iequals(name, "Sec-WebSocket-Protocol")) {
+            ret.protocol = value;
+        }
+    }
+
+    if (!upgrade || !connection || !accepted) {
+        return std::nullopt;
+    }
+    // The server may only select one of the subprotocols that were offered, if any (RFC 6455 section 4.1).
+    if (ret.protocol && std::ranges::find(m_protocols, *ret.protocol) == m_protocols.end()) {
+        return std::nullopt;
+    }
+    return ret;
+}
+
+std::array<char, Handshake::ACCEPT_LENGTH> Handshake::accept_for(std::string_view key)
+{
+    std::array<uint8_t, SHA_DIGEST_LENGTH> hash {};
+
+    // Keys are 24 characters long, but nothing stops a server from being handed a longer one.
+    if (std::array<char, 128> input {}; key.size() + ACCEPT_GUID.size() <= input.size()) {
+        std::ranges::copy(key, input.begin());
+        std::ranges::copy(ACCEPT_GUID, input.begin() + static_cast<std::ptrdiff_t>(key.size()));
+        SHA1(reinterpret_cast<const uint8_t*>(input.data()), key.size() + ACCEPT_GUID.size(), hash.data());
+    } else {
+        const auto input_string = std::string { key } + std::string { ACCEPT_GUID };
+        SHA1(reinterpret_cast<const uint8_t*>(input_string.data()), input_string.size(), hash.data());
+    }
+
+    std::array<char, ACCEPT_LENGTH> ret {};
+    base64_into(hash.data(), hash.size(), ret.data());
+    return ret;
+}
+} // namespace ekisocket::ws
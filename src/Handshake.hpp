@@ -0,0 +1,87 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <ekisocket/Uri.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ekisocket::ws {
+/**
+ * @brief What a valid handshake response says, pointing into the response.
+ */
+struct HandshakeResponse {
+    /// The extensions the server accepted, if any.
+    std::optional<std::string_view> extensions {};
+    /// The subprotocol the server selected, if any.
+    std::optional<std::string_view> protocol {};
+};
+
+/**
+ * @brief Writes the opening handshake requests of a client, and validates the responses of the server.
+ *
+ * The request is serialised once per URL and set of options, and every connection only fills in a fresh key. The
+ * response is checked in a single pass over its lines, without collecting its headers, against the accept value
+ * computed when the request was written.
+ */
+class Handshake {
+public:
+    /// The length of a key, 16 random bytes in base64.
+    static constexpr size_t KEY_LENGTH { 24 };
+    /// The length of an accept value, a SHA-1 digest in base64.
+    static constexpr size_t ACCEPT_LENGTH { 28 };
+
+    /**
+     * @brief Serialises everything but the key of the requests to come.
+     *
+     * @param uri The URI to connect to.
+     * @param extensions The extensions to offer, if any.
+     * @param headers Additional headers. The ones the handshake sets itself are left out.
+     * @param protocols The subprotocols to offer, by order of preference.
+     */
+    void prepare(const http::Uri& uri, std::string_view extensions, const util::CaseInsensitiveMap& headers = {},
+        const std::vector<std::string>& protocols = {});
+
+    /**
+     * @brief Forgets the serialised request, after the URL or the options changed.
+     */
+    void reset() { m_template.clear(); }
+
+    [[nodiscard]] bool prepared() const { return !m_template.empty(); }
+
+    /**
+     * @brief Writes a request with a new key, and remembers what the server has to answer to it.
+     */
+    [[nodiscard]] std::string request();
+
+    /**
+     * @brief The key of the last request.
+     */
+    [[nodiscard]] std::string_view key() const { return { m_key.data(), m_key.size() }; }
+
+    /**
+     * @brief Validates the response to the last request.
+     *
+     * @param head The status line and the headers, each line ending with a CRLF, without the empty line after them.
+     * @return std::optional What the server accepted, or std::nullopt if it rejected the handshake or selected a
+     * subprotocol that was not offered.
+     */
+    [[nodiscard]] std::optional<HandshakeResponse> validate(std::string_view head) const;
+
+    /**
+     * @brief The Sec-WebSocket-Accept value that answers a key.
+     */
+    [[nodiscard]] static std::array<char, ACCEPT_LENGTH> accept_for(std::string_view key);
+
+private:
+    /// The request, with the key left out.
+    std::string m_template {};
+    /// Where the key goes in the request.
+    size_t m_key_offset {};
+    /// The subprotocols offered, which the server has to select from.
+    std::vector<std::string> m_protocols {};
+    std::array<char, KEY_LENGTH> m_key {};
+    std::array<char, ACCEPT_LENGTH> m_accept {};
+};
+} // namespace ekisocket::ws
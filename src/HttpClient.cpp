@@ -1,12 +1,24 @@
 #include <algorithm>
+#include <array>
 #include <ekisocket/HttpClient.hpp>
+#include <ekisocket/Socket.hpp>
 #include <fmt/format.h>
 #include <numeric>
 #include <unordered_map>
+#include <vector>
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif !defined(_WIN32)
+#include <unistd.h>
+#endif
 
 namespace {
 constexpr uint16_t HTTP_PORT { 80 };
 constexpr uint16_t HTTPS_PORT { 443 };
+/// The size of the buffer (or pipe) relayed bodies go through.
+constexpr size_t RELAY_BUFFER_SIZE { 65536 };
 
 const std::unordered_map<ekisocket::http::Method, std::string> METHODS {
     { ekisocket::http::Method::GET, "GET" },
@@ -19,52 +31,237 @@ const std::unordered_map<ekisocket::http::Method, std::string> METHODS {
     { ekisocket::http::Method::TRACE, "TRACE" },
     { ekisocket::http::Method::PATCH, "PATCH" },
 };
-} // namespace
 
-namespace ekisocket::http {
-struct Client::Impl : ssl::Client {
-    explicit Impl()
-        : ssl::Client({}, {})
+bool would_block()
+{
+#ifdef _WIN32
+    return socketerrno == WSAEWOULDBLOCK;
+#elif EAGAIN == EWOULDBLOCK
+    return socketerrno == EAGAIN;
+#else
+    return socketerrno == EAGAIN || socketerrno == EWOULDBLOCK;
+#endif
+}
+
+/**
+ * @brief Blocks until the descriptor is ready for the given events.
+ */
+void wait_for(socket_t fd, short events)
+{
+    pollfd pfd { fd, events, 0 };
+    (void)poll(&pfd, 1, -1);
+}
+
+/**
+ * @brief Writes all of the data to the descriptor, waiting whenever it would block.
+ *
+ * @param fd The socket or pipe to write to.
+ * @param data The data to write.
+ * @param ec Set if the data could not be written.
+ * @return bool Whether or not all of the data was written.
+ */
+bool write_all(socket_t fd, std::string_view data, std::error_code& ec)
+{
+    while (!data.empty()) {
+#ifdef _WIN32
+        const auto len = ::send(fd, data.data(), static_cast<int>((std::min)(data.size(), RELAY_BUFFER_SIZE)), 0);
+#else
+        const auto len = ::write(fd, data.data(), data.size());
+#endif
+        if (len < 0) {
+            if (socketerrno == EINTR) {
+                continue;
+            }
+            if (would_block()) {
+                wait_for(fd, POLLOUT);
+                continue;
+            }
+            ec.assign(socketerrno, std::system_category());
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(len));
+    }
+    return true;
+}
+
+#ifdef __linux__
+/**
+ * @brief A non-blocking pipe that relayed bodies are spliced through. Every thread keeps one around, so relaying does
+ * not create a pipe per request.
+ */
+struct Pipe {
+    Pipe() { open(); }
+    Pipe(const Pipe&) = delete;
+    Pipe& operator=(const Pipe&) = delete;
+    Pipe(Pipe&&) = delete;
+    Pipe& operator=(Pipe&&) = delete;
+    ~Pipe() { close(); }
+
+    [[nodiscard]] bool valid() const { return fds[0] != -1; }
+
+    /**
+     * @brief Recreates the pipe, dropping whatever data was left in it by a failed relay.
+     */
+    void reset()
     {
+        close();
+        open();
     }
 
-    [[nodiscard]] Response request(const Method& method, std::string_view url, const Headers& headers,
-        std::string_view body, bool keep_alive = false, bool stream = false, const BodyCallback& cb = {})
+    /// The read and write ends of the pipe.
+    std::array<int, 2> fds { -1, -1 };
+
+private:
+    void open()
     {
-        auto uri = Uri::parse(url);
+        if (pipe2(fds.data(), O_NONBLOCK | O_CLOEXEC) != 0) {
+            fds = { -1, -1 };
+            return;
+        }
+        // A larger pipe means fewer splice() calls, the default size is used if we are not allowed to grow it.
+        (void)fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(RELAY_BUFFER_SIZE));
+    }
 
-        if (uri.scheme.empty()) {
-            uri.scheme = "http";
+    void close()
+    {
+        for (auto& fd : fds) {
+            if (fd != -1) {
+                (void)::close(fd);
+                fd = -1;
+            }
         }
-        if (!util::iequals(uri.scheme, "http") && !util::iequals(uri.scheme, "https")) {
-            throw errors::HttpClientError(fmt::format("Invalid scheme: {}", uri.scheme));
+    }
+};
+
+bool is_pipe(int fd)
+{
+    struct stat st { };
+    return fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+/**
+ * @brief Moves exactly len bytes out of the pipe into the descriptor.
+ */
+bool splice_out(int pipe, int fd, size_t len, std::error_code& ec)
+{
+    while (len > 0) {
+        const auto moved = splice(pipe, nullptr, fd, nullptr, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+        if (moved < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                wait_for(fd, POLLOUT);
+                continue;
+            }
+            ec.assign(errno, std::system_category());
+            return false;
         }
-        if (!uri.port.has_value()) {
-            uri.port = util::iequals(uri.scheme, "http") ? HTTP_PORT : HTTPS_PORT;
+        len -= static_cast<size_t>(moved);
+    }
+    return true;
+}
+
+/**
+ * @brief Moves len bytes from the socket to out through the pipe of the thread, optionally duplicating them into the
+ * mirror pipe with tee(). The data never enters user space.
+ *
+ * @return bool Whether or not all of the data was relayed.
+ */
+bool splice_relay(int in, int out, std::optional<int> mirror, size_t len, std::error_code& ec)
+{
+    thread_local Pipe pipe {};
+
+    if (!pipe.valid()) {
+        pipe.reset();
+    }
+    if (!pipe.valid()) {
+        ec.assign(errno, std::system_category());
+        return false;
+    }
+
+    const auto fail = [&](int error) {
+        if (error != 0) {
+            ec.assign(error, std::system_category());
         }
-        if (ssl::Client::connected()) {
-            // We need to select our ssl_client, if available, to trigger our disconnect discovery.
-            // Should already be non-blocking so as to not block forever.
-            ssl::Client::set_blocking(false);
-            // Perform a quick read.
-            (void)ssl::Client::receive(0);
-            // Go back to blocking.
-            ssl::Client::set_blocking(true);
-            // We should have detected whether we were disconnected or not.
+        // Whatever is left in the pipe belongs to this relay, so it must not leak into the next one.
+        pipe.reset();
+        return false;
+    };
+
+    while (len > 0) {
+        const auto received = splice(
+            in, nullptr, pipe.fds[1], nullptr, (std::min)(len, RELAY_BUFFER_SIZE), SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+        if (received == 0) {
+            ec = ekisocket::errors::Error::CONNECTION_CLOSED;
+            return fail(0);
         }
-        if (auto requested_server = fmt::format("{}:{}", uri.host, uri.port.value());
-            m_connected_to.empty() || m_connected_to != requested_server || !ssl::Client::connected()) {
-            ssl::Client::set_hostname(uri.host);
-            ssl::Client::set_port(uri.port.value());
-            ssl::Client::set_use_ssl(uri.port == HTTPS_PORT);
-            ssl::Client::close();
-            if (!ssl::Client::connect()) {
-                throw errors::HttpClientError(fmt::format("Failed to connect to {}:{}", uri.host, uri.port.value()));
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
             }
-            m_connected_to = std::move(requested_server);
+            if (errno == EAGAIN) {
+                wait_for(in, POLLIN);
+                continue;
+            }
+            return fail(errno);
+        }
+
+        auto in_pipe = static_cast<size_t>(received);
+
+        while (in_pipe > 0) {
+            auto chunk = in_pipe;
+
+            // tee() does not consume the pipe, so only move out what was duplicated before duplicating again.
+            if (mirror) {
+                const auto copied = tee(pipe.fds[0], *mirror, in_pipe, SPLICE_F_NONBLOCK);
+
+                if (copied <= 0) {
+                    if (copied == 0 || errno == EAGAIN) {
+                        wait_for(*mirror, POLLOUT);
+                        continue;
+                    }
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return fail(errno);
+                }
+                chunk = static_cast<size_t>(copied);
+            }
+            if (!splice_out(pipe.fds[0], out, chunk, ec)) {
+                return fail(0);
+            }
+            in_pipe -= chunk;
+        }
+
+        len -= static_cast<size_t>(received);
+    }
+    return true;
+}
+#endif
+} // namespace
+
+namespace ekisocket::http {
+struct Client::Impl {
+    explicit Impl(TransportFactory factory = {})
+        : m_factory { std::move(factory) }
+    {
+    }
+
+    [[nodiscard]] Response request(const Method& method, std::string_view url, const Headers& headers,
+        std::string_view body, std::error_code& ec, bool keep_alive = false, bool stream = false,
+        const BodyCallback& cb = {})
+    {
+        auto uri = Uri::parse(url);
+
+        if (!connect(uri, ec)) {
+            return {};
         }
         if (!METHODS.contains(method)) {
-            throw errors::HttpClientError(fmt::format("Invalid method: {}", static_cast<uint8_t>(method)));
+            ec = errors::Error::INVALID_METHOD;
+            return {};
         }
         if (uri.path.empty()) {
             uri.path = "/";
@@ -104,18 +301,143 @@ struct Client::Impl : ssl::Client {
         m_streaming = stream;
         m_body_callback = cb;
 
-        auto sent = ssl::Client::send(line);
+        size_t sent {};
 
         while (sent < line.length()) {
-            sent += ssl::Client::send(std::string_view { line }.substr(sent));
+            sent += m_transport->send(std::string_view { line }.substr(sent), ec);
+
+            if (ec) {
+                m_transport_error = true;
+                return {};
+            }
         }
 
-        return receive();
+        return receive(ec);
     }
 
-    [[nodiscard]] ssl::Client& ssl() { return static_cast<ssl::Client&>(*this); }
+    /**
+     * @brief Makes sure there is a connection to the origin of the URI, reusing the current one if possible.
+     *
+     * @param uri The URI to connect to, its scheme and port are filled in if missing.
+     * @param ec Set if the connection could not be established.
+     * @return bool Whether or not there is a connection.
+     */
+    bool connect(Uri& uri, std::error_code& ec)
+    {
+        ec.clear();
+        m_transport_error = false;
+
+        if (uri.scheme.empty()) {
+            uri.scheme = "http";
+        }
+        if (!util::iequals(uri.scheme, "http") && !util::iequals(uri.scheme, "https")) {
+            ec = errors::Error::INVALID_SCHEME;
+            return false;
+        }
+        if (!uri.port.has_value()) {
+            uri.port = util::iequals(uri.scheme, "http") ? HTTP_PORT : HTTPS_PORT;
+        }
+        if (m_transport && m_transport->connected()) {
+            // We need to select our transport, if available, to trigger our disconnect discovery.
+            // Should already be non-blocking so as to not block forever.
+            m_transport->set_blocking(false);
+            // Perform a quick read, any error here just means we have to reconnect.
+            std::error_code discovery_ec {};
+            (void)m_transport->receive(0, discovery_ec);
+            // Go back to blocking.
+            m_transport->set_blocking(true);
+            // We should have detected whether we were disconnected or not.
+        }
+        if (auto requested_server = fmt::format("{}:{}", uri.host, uri.port.value());
+            m_connected_to.empty() || m_connected_to != requested_server || !m_transport
+            || !m_transport->connected()) {
+            if (m_transport) {
+                m_transport->close();
+            }
+            m_transport = create_transport(uri.host, uri.port.value(), uri.port == HTTPS_PORT);
+            if (!m_transport) {
+                ec = errors::Error::CONNECT_FAILED;
+                return false;
+            }
+            if (!m_transport->connect(ec)) {
+                m_transport_error = static_cast<bool>(ec);
+                if (!ec) {
+                    ec = errors::Error::CONNECT_FAILED;
+                }
+                return false;
+            }
+            m_connected_to = std::move(requested_server);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Throws the error reported by request(), as an errors::SslClientError if it came from the underlying
+     * connection, or as an errors::HttpClientError otherwise.
+     *
+     * @param ec The error reported by request().
+     * @param url The URL that was requested.
+     */
+    [[noreturn]] void throw_error(const std::error_code& ec, std::string_view url) const
+    {
+        if (m_transport_error && m_transport) {
+            m_transport->throw_error(ec);
+        }
+        throw errors::HttpClientError(fmt::format("{}: {}", ec.message(), url));
+    }
+
+    [[nodiscard]] Response relay(const Method& method, std::string_view url, const Headers& headers,
+        std::string_view body, socket_t out, std::error_code& ec, std::optional<socket_t> mirror, bool keep_alive)
+    {
+        m_relay = RelayTarget { out, mirror };
+        auto res = request(method, url, headers, body, ec, keep_alive);
+        m_relay.reset();
+        return res;
+    }
+
+    void set_address(std::string_view address)
+    {
+        m_address = address;
+        // Make sure the next request connects to the new address.
+        m_connected_to.clear();
+    }
+
+    [[nodiscard]] Transport& transport() { return *m_transport; }
+
+    [[nodiscard]] Transport* connect(std::string_view url, std::error_code& ec)
+    {
+        auto uri = Uri::parse(url);
+        return take_over(uri, ec);
+    }
+
+    /**
+     * @brief Connects to the origin of the URI, and hands the connection over.
+     */
+    [[nodiscard]] Transport* take_over(Uri& uri, std::error_code& ec)
+    {
+        if (!connect(uri, ec)) {
+            return nullptr;
+        }
+        // The connection is handed over, it cannot be reused for requests.
+        m_connected_to.clear();
+        return m_transport.get();
+    }
 
 private:
+    /**
+     * @brief Creates the transport for a new connection, through the factory if one was given.
+     */
+    std::unique_ptr<Transport> create_transport(std::string_view host, uint16_t port, bool use_tls) const
+    {
+        if (m_factory) {
+            return m_factory(host, port, use_tls);
+        }
+
+        auto transport = std::make_unique<SocketTransport>(host, port, use_tls);
+        transport->client().set_address(m_address);
+        return transport;
+    }
+
     static void parse_chunked(std::string& body)
     {
         std::string new_body {};
@@ -151,12 +473,80 @@ private:
         body = std::move(new_body);
     }
 
+    /**
+     * @brief Receives the next chunk of data from the server, treating a closed connection as an error since we still
+     * expect data.
+     *
+     * @param buf_size The maximum amount of data to receive.
+     * @param ec Set if the connection failed or was closed.
+     * @return std::string The received data.
+     */
+    std::string receive_some(size_t buf_size, std::error_code& ec)
+    {
+        auto ret = m_transport->receive(buf_size, ec);
+
+        if (!ec && ret.empty() && !m_transport->connected()) {
+            ec = errors::Error::CONNECTION_CLOSED;
+        }
+        m_transport_error = static_cast<bool>(ec);
+        return ret;
+    }
+
+    /**
+     * @brief Writes data to the relay target, and its mirror if any.
+     */
+    bool relay_out(std::string_view data, std::error_code& ec)
+    {
+        m_transport_error = false;
+        return write_all(m_relay->out, data, ec) && (!m_relay->mirror || write_all(*m_relay->mirror, data, ec));
+    }
+
+    /**
+     * @brief Relays the next len bytes of the body to the relay target. Plain TCP (or kernel TLS) connections are
+     * spliced on Linux, everything else goes through a single buffer per thread.
+     *
+     * @param len The number of bytes to relay.
+     * @param ec Set if the body could not be received or written.
+     * @return bool Whether or not the whole body was relayed.
+     */
+    bool relay_body(size_t len, std::error_code& ec)
+    {
+#ifdef __linux__
+        if (len > 0 && m_transport->zero_copy_receive() && (!m_relay->mirror || is_pipe(*m_relay->mirror))) {
+            const auto ok = splice_relay(m_transport->native_handle(), m_relay->out, m_relay->mirror, len, ec);
+
+            m_transport_error = ec == errors::Error::CONNECTION_CLOSED;
+            return ok;
+        }
+#endif
+        thread_local std::vector<char> buffer(RELAY_BUFFER_SIZE);
+
+        while (len > 0) {
+            const auto received
+                = m_transport->receive_into(std::span { buffer }.first((std::min)(len, buffer.size())), ec);
+
+            if (!ec && received == 0 && !m_transport->connected()) {
+                ec = errors::Error::CONNECTION_CLOSED;
+            }
+            if (ec) {
+                m_transport_error = true;
+                return false;
+            }
+            if (!relay_out({ buffer.data(), received }, ec)) {
+                return false;
+            }
+            len -= received;
+        }
+        return true;
+    }
+
     /**
      * @brief Receives data from the server.
      *
+     * @param ec Set if the response could not be received.
      * @return Response The response from the server.
      */
-    Response receive()
+    Response receive(std::error_code& ec)
     {
         Response res {};
         std::string response {};
@@ -164,7 +554,12 @@ private:
 
         do {
             const auto old_length = response.length();
-            response += ssl::Client::receive();
+            response += receive_some(4096, ec);
+
+            if (ec) {
+                return {};
+            }
+
             end_of_headers = response.find("\r\n\r\n", old_length);
         } while (end_of_headers == std::string::npos);
 
@@ -178,14 +573,16 @@ private:
         auto end_of_status_line = response.find("\r\n");
 
         if (end_of_status_line == std::string::npos) {
-            throw errors::HttpClientError(fmt::format("Invalid status line: {}", response));
+            ec = errors::Error::INVALID_RESPONSE;
+            return {};
         }
 
         // Split the status line into status code and status message.
         auto status_line = util::split(std::string_view { response }.substr(0, end_of_status_line), " ");
 
-        if (!util::is_number(status_line[1])) {
-            throw errors::HttpClientError(fmt::format("Invalid status code: {}", status_line[1]));
+        if (status_line.size() < 2 || !util::is_number(status_line[1])) {
+            ec = errors::Error::INVALID_RESPONSE;
+            return {};
         }
 
         res.status_code = static_cast<uint16_t>(std::stoul(status_line[1]));
@@ -227,6 +624,10 @@ private:
 
             // If we received a body.
             if (util::iequals(key, "Content-Length")) {
+                if (!util::is_number(value)) {
+                    ec = errors::Error::INVALID_RESPONSE;
+                    return {};
+                }
                 content_length = std::stoul(value);
             }
 
@@ -240,6 +641,17 @@ private:
             encoded = true;
         }
 
+        if (m_relay && !encoded) {
+            // Anything past the body is not ours to relay.
+            if (content_length > 0 && body.length() > content_length) {
+                body.resize(content_length);
+            }
+            if (!relay_out(body, ec) || !relay_body(content_length - (std::min)(body.length(), content_length), ec)) {
+                return {};
+            }
+            return res;
+        }
+
         auto bytes_received { body.length() };
 
         // If body is not empty, we need to stream the current body to the callback.
@@ -248,9 +660,11 @@ private:
         }
 
         while (bytes_received < content_length) {
-            const auto chunk
-                = ssl::Client::receive((std::max)(content_length - bytes_received, static_cast<size_t>(4096)));
+            const auto chunk = receive_some((std::max)(content_length - bytes_received, static_cast<size_t>(4096)), ec);
 
+            if (ec) {
+                return {};
+            }
             if (chunk.empty()) {
                 continue;
             }
@@ -272,24 +686,51 @@ private:
             while (end_of_chunk == std::string::npos) {
                 const auto old_length = body.length();
 
-                body += ssl::Client::receive();
+                body += receive_some(4096, ec);
+
+                if (ec) {
+                    return {};
+                }
+
                 // We can safely skip the old length, since we know there is no end of chunk marker there.
                 end_of_chunk = body.find("0\r\n\r\n", old_length);
             }
 
             parse_chunked(body);
         }
+        if (m_relay) {
+            if (!relay_out(body, ec)) {
+                return {};
+            }
+            return res;
+        }
 
         res.body = std::move(body);
         return res;
     }
 
+    /// Creates the transports of new connections, a SocketTransport is used if empty.
+    TransportFactory m_factory {};
+    /// The current connection.
+    std::unique_ptr<Transport> m_transport {};
+    /// The address that new connections are pinned to, if not empty.
+    std::string m_address {};
     /// Used for keeping track of the currently connected to server.
     std::string m_connected_to {};
     /// Used for determining whether or not to stream the response.
     bool m_streaming {};
     /// Used for keeping track of the callback to call for each chunk of data received.
     BodyCallback m_body_callback {};
+    /// Whether or not the last error came from the underlying connection.
+    bool m_transport_error {};
+
+    struct RelayTarget {
+        socket_t out {};
+        std::optional<socket_t> mirror {};
+    };
+
+    /// Where the body of the current response is relayed to, if anywhere.
+    std::optional<RelayTarget> m_relay {};
 };
 
 #define DEFINE_HTTP_FUNCTION(name, method)                                                                             \
@@ -321,15 +762,28 @@ Response request(const Method& method, std::string_view url, const Headers& head
     return Client().request(method, url, headers, body, false, stream, cb);
 }
 
+Response request(const Method& method, std::string_view url, const Headers& headers, std::string_view body,
+    std::error_code& ec, bool stream, const BodyCallback& cb)
+{
+    return Client().request(method, url, headers, body, ec, false, stream, cb);
+}
+
 Client::Client()
     : m_impl { std::make_unique<Client::Impl>() }
 {
 }
 
+Client::Client(TransportFactory factory)
+    : m_impl { std::make_unique<Client::Impl>(std::move(factory)) }
+{
+}
+
 Client::Client(Client&&) noexcept = default;
 Client& Client::operator=(Client&&) noexcept = default;
 Client::~Client() = default;
 
+void Client::set_address(std::string_view address) const { m_impl->set_address(address); }
+
 DEFINE_HTTP_FUNCTION(get, GET)
 DEFINE_HTTP_FUNCTION(post, POST)
 DEFINE_HTTP_FUNCTION(put, PUT)
@@ -343,8 +797,42 @@ DEFINE_HTTP_FUNCTION(patch, PATCH)
 Response Client::request(const Method& method, std::string_view url, const Headers& headers, std::string_view body,
     bool keep_alive, bool stream, const BodyCallback& cb) const
 {
-    return m_impl->request(method, url, headers, body, keep_alive, stream, cb);
+    std::error_code ec {};
+    auto res = m_impl->request(method, url, headers, body, ec, keep_alive, stream, cb);
+
+    if (ec) {
+        m_impl->throw_error(ec, url);
+    }
+    return res;
 }
 
-ssl::Client& Client::ssl() const { return m_impl->ssl(); }
+Response Client::request(const Method& method, std::string_view url, const Headers& headers, std::string_view body,
+    std::error_code& ec, bool keep_alive, bool stream, const BodyCallback& cb) const
+{
+    return m_impl->request(method, url, headers, body, ec, keep_alive, stream, cb);
+}
+
+Response Client::relay(const Method& method, std::string_view url, const Headers& headers, std::string_view body,
+    socket_t out, std::optional<socket_t> mirror, bool keep_alive) const
+{
+    std::error_code ec {};
+    auto res = m_impl->relay(method, url, headers, body, out, ec, mirror, keep_alive);
+
+    if (ec) {
+        m_impl->throw_error(ec, url);
+    }
+    return res;
+}
+
+Response Client::relay(const Method& method, std::string_view url, const Headers& headers, std::string_view body,
+    socket_t out, std::error_code& ec, std::optional<socket_t> mirror, bool keep_alive) const
+{
+    return m_impl->relay(method, url, headers, body, out, ec, mirror, keep_alive);
+}
+
+Transport& Client::transport() const { return m_impl->transport(); }
+
+Transport* Client::connect(std::string_view url, std::error_code& ec) const { return m_impl->connect(url, ec); }
+
+Transport* Client::connect(Uri uri, std::error_code& ec) const { return m_impl->take_over(uri, ec); }
 } // namespace ekisocket::http
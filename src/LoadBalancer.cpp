@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <atomic>
+#include <ekisocket/LoadBalancer.hpp>
+#include <fmt/format.h>
+#include <mutex>
+
+namespace {
+constexpr uint32_t DEFAULT_MAX_FAILURES { 5 };
+constexpr std::chrono::seconds DEFAULT_EJECTION_DURATION { 10 };
+constexpr size_t DEFAULT_MAX_IDLE_CONNECTIONS { 8 };
+/// Number of points every endpoint gets on the hash ring, more points give a more even spread.
+constexpr size_t VIRTUAL_NODES { 100 };
+/// Weight given to the newest latency sample.
+constexpr double EWMA_ALPHA { 0.2 };
+
+uint64_t fnv1a(std::string_view data, uint64_t hash = 0xcbf29ce484222325)
+{
+    for (const auto c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+int64_t now_ticks() { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+
+bool is_idempotent(ekisocket::http::Method method)
+{
+    using enum ekisocket::http::Method;
+    return method != POST && method != PATCH && method != CONNECT;
+}
+} // namespace
+
+namespace ekisocket::http {
+struct EndpointState {
+    explicit EndpointState(Endpoint ep)
+        : endpoint { std::move(ep) }
+    {
+        // The path of every request is appended to the URL.
+        while (endpoint.url.ends_with('/')) {
+            endpoint.url.pop_back();
+        }
+    }
+
+    /**
+     * @brief Takes an idle connection from the pool, or creates a new one.
+     *
+     * @return std::unique_ptr<Client> The connection to use.
+     */
+    std::unique_ptr<Client> checkout()
+    {
+        {
+            std::scoped_lock lk { mtx };
+            if (!idle.empty()) {
+                auto ret = std::move(idle.back());
+                idle.pop_back();
+                return ret;
+            }
+        }
+
+        auto ret = std::make_unique<Client>();
+
+        if (!endpoint.address.empty()) {
+            ret->set_address(endpoint.address);
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Returns a healthy connection to the pool.
+     *
+     * @param client The connection to return.
+     * @param max_idle The maximum number of idle connections to keep.
+     */
+    void checkin(std::unique_ptr<Client> client, size_t max_idle)
+    {
+        std::scoped_lock lk { mtx };
+        if (idle.size() < max_idle) {
+            idle.emplace_back(std::move(client));
+        }
+    }
+
+    [[nodiscard]] bool healthy(int64_t now) const { return ejected_until.load(std::memory_order_relaxed) <= now; }
+
+    Endpoint endpoint {};
+    /// Number of requests currently in flight.
+    std::atomic_uint32_t outstanding {};
+    /// Number of failed requests since the last successful one.
+    std::atomic_uint32_t failures {};
+    /// Smoothed latency in microseconds. Concurrent updates may drop a sample, which is fine for an average.
+    std::atomic<double> latency_us {};
+    /// Point in time (in steady_clock ticks) until which the endpoint is ejected.
+    std::atomic_int64_t ejected_until {};
+    /// Mutex guarding the idle connections.
+    std::mutex mtx {};
+    /// Idle keep-alive connections to the endpoint.
+    std::vector<std::unique_ptr<Client>> idle {};
+};
+
+struct LoadBalancer::Impl {
+    Impl(std::vector<Endpoint> endpoints, Policy policy)
+        : m_policy { policy }
+    {
+        if (endpoints.empty()) {
+            throw errors::HttpClientError("A load balancer needs at least one endpoint.");
+        }
+
+        m_endpoints.reserve(endpoints.size());
+
+        for (auto& endpoint : endpoints) {
+            m_endpoints.emplace_back(std::make_unique<EndpointState>(std::move(endpoint)));
+        }
+        if (m_policy == Policy::CONSISTENT_HASH) {
+            build_ring();
+        }
+    }
+
+    void set_ejection(uint32_t max_failures, std::chrono::milliseconds duration)
+    {
+        m_max_failures = max_failures;
+        m_ejection_duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration).count();
+    }
+
+    void set_max_idle_connections(size_t max_idle) { m_max_idle = max_idle; }
+
+    Response request(const Method& method, std::string_view path, const Headers& headers, std::string_view body,
+        std::string_view key, std::error_code& ec, bool stream, const BodyCallback& cb)
+    {
+        // Retrying is only safe if the request can be repeated, and nothing was streamed to the caller yet.
+        const auto attempts = is_idempotent(method) && !stream ? m_endpoints.size() : 1;
+        auto index = select(key);
+
+        for (size_t attempt {}; attempt < attempts; ++attempt) {
+            if (attempt != 0) {
+                index = next_healthy(index);
+            }
+
+            auto& ep = *m_endpoints[index];
+            auto client = ep.checkout();
+            const auto start = std::chrono::steady_clock::now();
+
+            ep.outstanding.fetch_add(1, std::memory_order_relaxed);
+            auto res = client->request(
+                method, fmt::format("{}{}", ep.endpoint.url, path), headers, body, ec, true, stream, cb);
+            ep.outstanding.fetch_sub(1, std::memory_order_relaxed);
+
+            if (!ec) {
+                record_latency(ep, std::chrono::steady_clock::now() - start);
+                // Server errors still count against the endpoint, but are not retried.
+                if (res.status_code >= 500) {
+                    record_failure(ep);
+                } else {
+                    ep.failures.store(0, std::memory_order_relaxed);
+                }
+                ep.checkin(std::move(client), m_max_idle);
+                return res;
+            }
+            // Errors caused by the request itself would fail on every endpoint.
+            if (ec == errors::Error::INVALID_SCHEME || ec == errors::Error::INVALID_METHOD) {
+                break;
+            }
+
+            record_failure(ep);
+        }
+
+        return {};
+    }
+
+    [[nodiscard]] std::vector<EndpointStats> stats() const
+    {
+        std::vector<EndpointStats> ret {};
+        ret.reserve(m_endpoints.size());
+
+        const auto now = now_ticks();
+
+        for (const auto& ep : m_endpoints) {
+            ret.emplace_back(EndpointStats {
+                .endpoint = ep->endpoint,
+                .outstanding = ep->outstanding.load(std::memory_order_relaxed),
+                .latency = std::chrono::microseconds { static_cast<int64_t>(ep->latency_us.load()) },
+                .consecutive_failures = ep->failures.load(std::memory_order_relaxed),
+                .ejected = !ep->healthy(now),
+            });
+        }
+        return ret;
+    }
+
+private:
+    void build_ring()
+    {
+        m_ring.reserve(m_endpoints.size() * VIRTUAL_NODES);
+
+        for (size_t i {}; i < m_endpoints.size(); ++i) {
+            const auto& ep = m_endpoints[i]->endpoint;
+            const auto base = fnv1a(ep.address, fnv1a(ep.url));
+
+            for (size_t v {}; v < VIRTUAL_NODES; ++v) {
+                m_ring.emplace_back(fnv1a(std::to_string(v), base), i);
+            }
+        }
+
+        std::sort(m_ring.begin(), m_ring.end());
+    }
+
+    /**
+     * @brief Picks the endpoint of the next request according to the policy, skipping ejected endpoints unless all
+     * of them are ejected.
+     *
+     * @param key The key of the request, used for consistent hashing.
+     * @return size_t The index of the endpoint.
+     */
+    size_t select(std::string_view key)
+    {
+        const auto now = now_ticks();
+        const auto n = m_endpoints.size();
+
+        if (n == 1) {
+            return 0;
+        }
+
+        switch (m_policy) {
+        case Policy::CONSISTENT_HASH: {
+            if (key.empty()) {
+                break;
+            }
+
+            auto it = std::lower_bound(
+                m_ring.begin(), m_ring.end(), std::pair<uint64_t, size_t> { fnv1a(key), 0 });
+
+            // Walk clockwise until we find a healthy endpoint, so an ejection only moves the keys of that endpoint.
+            for (size_t i {}; i < m_ring.size(); ++i, ++it) {
+                if (it == m_ring.end()) {
+                    it = m_ring.begin();
+                }
+                if (m_endpoints[it->second]->healthy(now)) {
+                    return it->second;
+                }
+            }
+            return it == m_ring.end() ? m_ring.front().second : it->second;
+        }
+        case Policy::POWER_OF_TWO_CHOICES:
+        case Policy::LATENCY_EWMA: {
+            const auto a = pick_random(now);
+            auto b = pick_random(now);
+
+            if (a == b) {
+                b = next_healthy(a);
+            }
+            return cost(*m_endpoints[a]) <= cost(*m_endpoints[b]) ? a : b;
+        }
+        case Policy::ROUND_ROBIN:
+            break;
+        }
+
+        const auto start = m_next.fetch_add(1, std::memory_order_relaxed) % n;
+        return m_endpoints[start]->healthy(now) ? start : next_healthy(start);
+    }
+
+    /**
+     * @brief Finds the next healthy endpoint after the given one, or simply the next one if none are healthy.
+     */
+    [[nodiscard]] size_t next_healthy(size_t index) const
+    {
+        const auto now = now_ticks();
+        const auto n = m_endpoints.size();
+
+        for (size_t i { 1 }; i < n; ++i) {
+            if (const auto candidate = (index + i) % n; m_endpoints[candidate]->healthy(now)) {
+                return candidate;
+            }
+        }
+        return (index + 1) % n;
+    }
+
+    [[nodiscard]] size_t pick_random(int64_t now) const
+    {
+        const auto n = static_cast<uint32_t>(m_endpoints.size());
+        size_t ret {};
+
+        for (uint32_t attempt {}; attempt < n; ++attempt) {
+            ret = util::get_random_number(0, n - 1);
+
+            if (m_endpoints[ret]->healthy(now)) {
+                break;
+            }
+        }
+        return ret;
+    }
+
+    [[nodiscard]] double cost(const EndpointState& ep) const
+    {
+        const auto outstanding = static_cast<double>(ep.outstanding.load(std::memory_order_relaxed));
+
+        if (m_policy == Policy::POWER_OF_TWO_CHOICES) {
+            return outstanding;
+        }
+        // Endpoints without samples yet look as fast as possible, so they get tried.
+        return ep.latency_us.load(std::memory_order_relaxed) * (outstanding + 1);
+    }
+
+    static void record_latency(EndpointState& ep, std::chrono::steady_clock::duration elapsed)
+    {
+        const auto sample = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        const auto old = ep.latency_us.load(std::memory_order_relaxed);
+
+        ep.latency_us.store(old == 0 ? sample : old + EWMA_ALPHA * (sample - old), std::memory_order_relaxed);
+    }
+
+    void record_failure(EndpointState& ep) const
+    {
+        const auto failures = ep.failures.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        if (m_max_failures != 0 && failures >= m_max_failures) {
+            ep.ejected_until.store(now_ticks() + m_ejection_duration, std::memory_order_relaxed);
+            // Give the endpoint a clean slate for when it comes back.
+            ep.failures.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /// The policy used to pick endpoints.
+    Policy m_policy {};
+    /// The state of every endpoint.
+    std::vector<std::unique_ptr<EndpointState>> m_endpoints {};
+    /// The hash ring used for consistent hashing, sorted by hash.
+    std::vector<std::pair<uint64_t, size_t>> m_ring {};
+    /// Counter used for round-robin.
+    std::atomic_size_t m_next {};
+    /// Number of consecutive failures before ejecting an endpoint.
+    std::atomic_uint32_t m_max_failures { DEFAULT_MAX_FAILURES };
+    /// How long an endpoint stays ejected, in steady_clock ticks.
+    std::atomic_int64_t m_ejection_duration {
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(DEFAULT_EJECTION_DURATION).count()
+    };
+    /// The maximum number of idle connections kept per endpoint.
+    std::atomic_size_t m_max_idle { DEFAULT_MAX_IDLE_CONNECTIONS };
+};
+
+LoadBalancer::LoadBalancer(std::vector<Endpoint> endpoints, Policy policy)
+    : m_impl { std::make_unique<LoadBalancer::Impl>(std::move(endpoints), policy) }
+{
+}
+
+LoadBalancer::LoadBalancer(LoadBalancer&&) noexcept = default;
+LoadBalancer& LoadBalancer::operator=(LoadBalancer&&) noexcept = default;
+LoadBalancer::~LoadBalancer() = default;
+
+LoadBalancer LoadBalancer::from_dns(std::string_view url, Policy policy)
+{
+    const auto uri = Uri::parse(url);
+    const auto port = uri.port.value_or(static_cast<uint16_t>(util::iequals(uri.scheme, "https") ? 443 : 80));
+    auto addresses = util::resolve_addresses(uri.host, port);
+
+    if (addresses.empty()) {
+        throw errors::HttpClientError(fmt::format("Unable to lookup address: {}", uri.host));
+    }
+
+    std::vector<Endpoint> endpoints {};
+    endpoints.reserve(addresses.size());
+
+    for (auto& address : addresses) {
+        endpoints.emplace_back(Endpoint { std::string { url }, std::move(address) });
+    }
+
+    return LoadBalancer { std::move(endpoints), policy };
+}
+
+void LoadBalancer::set_ejection(uint32_t max_failures, std::chrono::milliseconds duration) const
+{
+    m_impl->set_ejection(max_failures, duration);
+}
+
+void LoadBalancer::set_max_idle_connections(size_t max_idle) const { m_impl->set_max_idle_connections(max_idle); }
+
+Response LoadBalancer::request(const Method& method, std::string_view path, const Headers& headers,
+    std::string_view body, std::string_view key, bool stream, const BodyCallback& cb) const
+{
+    std::error_code ec {};
+    auto res = m_impl->request(method, path, headers, body, key, ec, stream, cb);
+
+    if (ec) {
+        throw errors::HttpClientError(fmt::format("{}: {}", ec.message(), path));
+    }
+    return res;
+}
+
+Response LoadBalancer::request(const Method& method, std::string_view path, const Headers& headers,
+    std::string_view body, std::string_view key, std::error_code& ec, bool stream, const BodyCallback& cb) const
+{
+    return m_impl->request(method, path, headers, body, key, ec, stream, cb);
+}
+
+std::vector<EndpointStats> LoadBalancer::stats() const { return m_impl->stats(); }
+} // namespace ekisocket::http
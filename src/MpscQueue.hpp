@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace ekisocket {
+/**
+ * @brief An unbounded lock-free queue with any number of producers and a single consumer. Pushing is one atomic
+ * exchange and never waits for the consumer, which makes it suitable for handing frames from threads calling send() to
+ * the thread doing the I/O.
+ *
+ * The consumer always owns a node whose value has already been taken (the stub at first), and pops by advancing to the
+ * next one. A producer that has swapped itself in as the head but not yet linked its node makes the queue look empty
+ * to the consumer for that instant, which is fine since the producer signals the consumer afterwards.
+ */
+template <typename T> class MpscQueue {
+public:
+    MpscQueue() = default;
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+    MpscQueue(MpscQueue&&) = delete;
+    MpscQueue& operator=(MpscQueue&&) = delete;
+
+    ~MpscQueue()
+    {
+        while (pop()) { }
+        release(m_tail);
+    }
+
+    /**
+     * @brief Adds a value to the queue. Safe to call from any thread.
+     */
+    void push(T value)
+    {
+        auto* node = new Node { {}, std::move(value) };
+        auto* prev = m_head.exchange(node, std::memory_order_acq_rel);
+
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief Takes the oldest value out of the queue. Must only be called by the consumer.
+     *
+     * @return std::optional The value, or std::nullopt if the queue is empty.
+     */
+    [[nodiscard]] std::optional<T> pop()
+    {
+        auto* next = m_tail->next.load(std::memory_order_acquire);
+
+        if (next == nullptr) {
+            return std::nullopt;
+        }
+
+        // The node of the value becomes the one the consumer owns.
+        auto ret = std::move(next->value);
+
+        next->value.reset();
+        release(std::exchange(m_tail, next));
+        return ret;
+    }
+
+    /**
+     * @brief Whether or not the queue is empty, as seen by the consumer.
+     */
+    [[nodiscard]] bool empty() const { return m_tail->next.load(std::memory_order_acquire) == nullptr; }
+
+private:
+    struct Node {
+        std::atomic<Node*> next {};
+        std::optional<T> value {};
+    };
+
+    void release(Node* node)
+    {
+        if (node != &m_stub) {
+            delete node;
+        }
+    }
+
+    Node m_stub {};
+    /// The most recently pushed node, written by the producers.
+    std::atomic<Node*> m_head { &m_stub };
+    /// The node owned by the consumer, whose successor is the oldest value.
+    Node* m_tail { &m_stub };
+};
+} // namespace ekisocket
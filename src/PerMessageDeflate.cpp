@@ -0,0 +1,300 @@
+#include <PerMessageDeflate.hpp>
+#include <algorithm>
+#include <charconv>
+#include <ekisocket/Util.hpp>
+#include <fmt/format.h>
+#include <limits>
+
+namespace {
+/// How much the output grows by whenever zlib runs out of room.
+constexpr size_t OUTPUT_CHUNK_SIZE { 16384 };
+/// What a sync flush ends with, which permessage-deflate leaves out of every message.
+constexpr std::string_view FLUSH_TRAILER { "\x00\x00\xff\xff", 4 };
+/// zlib cannot produce raw deflate streams with a window of 8 bits.
+constexpr uint8_t MIN_DEFLATE_WINDOW_BITS { 9 };
+constexpr uint8_t MIN_WINDOW_BITS { 8 };
+constexpr uint8_t MAX_WINDOW_BITS { 15 };
+
+/**
+ * @brief Feeds the input to a zlib stream one step at a time, growing the output until the step produces no more.
+ *
+ * @param max_size Stops once the output grows past this size, so that a small input cannot expand without limit.
+ * @return bool Whether or not every step succeeded, and the output stayed within max_size.
+ */
+template <typename Step>
+bool pump(z_stream& stream, std::string_view in, std::string& out, Step&& step,
+    size_t max_size = std::numeric_limits<size_t>::max())
+{
+    do {
+        const auto chunk = in.substr(0, std::numeric_limits<uInt>::max());
+
+        in.remove_prefix(chunk.size());
+        stream.next_in = reinterpret_cast<const Bytef*>(chunk.data());
+        stream.avail_in = static_cast<uInt>(chunk.size());
+
+        do {
+            const auto size = out.size();
+
+            out.resize(size + OUTPUT_CHUNK_SIZE);
+            stream.next_out = reinterpret_cast<Bytef*>(out.data() + size);
+            stream.avail_out = static_cast<uInt>(OUTPUT_CHUNK_SIZE);
+
+            const auto ret = step();
+
+            out.resize(out.size() - stream.avail_out);
+
+            if (out.size() > max_size) {
+                return false;
+            }
+
+            // No progress is possible, which is not an error as long as there is nothing left to do.
+            if (ret == Z_BUF_ERROR) {
+                break;
+            }
+            if (ret != Z_OK) {
+                return false;
+            }
+        } while (stream.avail_out == 0 || stream.avail_in > 0);
+    } while (!in.empty());
+    return true;
+}
+
+/**
+ * @brief Removes the spaces and tabs around an extension token.
+ */
+std::string_view trim(std::string_view s)
+{
+    while (s.starts_with(' ') || s.starts_with('\t')) {
+        s.remove_prefix(1);
+    }
+    while (s.ends_with(' ') || s.ends_with('\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+/**
+ * @brief Parses the value of a window bits parameter, which may be quoted.
+ */
+std::optional<uint8_t> parse_window_bits(std::string_view value)
+{
+    if (value.length() >= 2 && value.starts_with('"') && value.ends_with('"')) {
+        value = value.substr(1, value.length() - 2);
+    }
+
+    uint8_t ret {};
+    const auto [end, ec] = std::from_chars(value.data(), value.data() + value.length(), ret);
+
+    if (ec != std::errc {} || end != value.data() + value.length() || ret < MIN_WINDOW_BITS
+        || ret > MAX_WINDOW_BITS) {
+        return std::nullopt;
+    }
+    return ret;
+}
+} // namespace
+
+namespace ekisocket::ws {
+PerMessageDeflate::PerMessageDeflate(const DeflateParameters& parameters, size_t min_message_size)
+    : m_parameters { parameters }
+    , m_min_message_size { min_message_size }
+{
+    m_deflate_ready = deflateInit2(&m_deflate, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                          -(std::max)(m_parameters.client_max_window_bits, MIN_DEFLATE_WINDOW_BITS), 8,
+                          Z_DEFAULT_STRATEGY)
+        == Z_OK;
+    m_inflate_ready = inflateInit2(&m_inflate, -m_parameters.server_max_window_bits) == Z_OK;
+}
+
+PerMessageDeflate::~PerMessageDeflate()
+{
+    if (m_deflate_ready) {
+        deflateEnd(&m_deflate);
+    }
+    if (m_inflate_ready) {
+        inflateEnd(&m_inflate);
+    }
+}
+
+std::string PerMessageDeflate::offer(const DeflateOptions& options)
+{
+    // Offering client_max_window_bits without a value tells the server it may ask for a smaller window.
+    std::string ret { "permessage-deflate; client_max_window_bits" };
+
+    if (options.client_max_window_bits) {
+        ret += fmt::format(
+            "={}", std::clamp(*options.client_max_window_bits, MIN_DEFLATE_WINDOW_BITS, MAX_WINDOW_BITS));
+    }
+    if (options.server_max_window_bits) {
+        ret += fmt::format("; server_max_window_bits={}",
+            std::clamp(*options.server_max_window_bits, MIN_WINDOW_BITS, MAX_WINDOW_BITS));
+    }
+    if (options.server_no_context_takeover) {
+        ret += "; server_no_context_takeover";
+    }
+    if (options.client_no_context_takeover) {
+        ret += "; client_no_context_takeover";
+    }
+    return ret;
+}
+
+std::optional<DeflateParameters> PerMessageDeflate::negotiate(std::string_view response, const DeflateOptions& options)
+{
+    // Only one extension was offered, so the server cannot have accepted more than that.
+    if (response.find(',') != std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    const auto params = util::split(response, ";");
+
+    if (trim(params[0]) != "permessage-deflate") {
+        return std::nullopt;
+    }
+
+    DeflateParameters ret {};
+    bool has_server_max_window_bits {};
+    bool has_client_max_window_bits {};
+
+    if (options.client_max_window_bits) {
+        ret.client_max_window_bits
+            = std::clamp(*options.client_max_window_bits, MIN_DEFLATE_WINDOW_BITS, MAX_WINDOW_BITS);
+    }
+
+    for (size_t i { 1 }; i < params.size(); ++i) {
+        auto name = trim(params[i]);
+        std::optional<std::string_view> value {};
+
+        if (const auto equals = name.find('='); equals != std::string_view::npos) {
+            value = trim(name.substr(equals + 1));
+            name = trim(name.substr(0, equals));
+        }
+
+        // Every parameter may only appear once, and the flags take no value.
+        if (name == "server_no_context_takeover" && !value && !ret.server_no_context_takeover) {
+            ret.server_no_context_takeover = true;
+        } else if (name == "client_no_context_takeover" && !value && !ret.client_no_context_takeover) {
+            ret.client_no_context_takeover = true;
+        } else if (name == "server_max_window_bits" && value && !has_server_max_window_bits) {
+            const auto bits = parse_window_bits(*value);
+
+            if (!bits || (options.server_max_window_bits && *bits > *options.server_max_window_bits)) {
+                return std::nullopt;
+            }
+            ret.server_max_window_bits = *bits;
+            has_server_max_window_bits = true;
+        } else if (name == "client_max_window_bits" && value && !has_client_max_window_bits) {
+            const auto bits = parse_window_bits(*value);
+
+            if (!bits || *bits > ret.client_max_window_bits) {
+                return std::nullopt;
+            }
+            ret.client_max_window_bits = *bits;
+            has_client_max_window_bits = true;
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    // A server accepts these parameters by repeating them, it cannot accept the extension while ignoring them.
+    if ((options.server_no_context_takeover && !ret.server_no_context_takeover)
+        || (options.server_max_window_bits && !has_server_max_window_bits)) {
+        return std::nullopt;
+    }
+    return ret;
+}
+
+bool PerMessageDeflate::deflate(std::string_view message, std::string& out, bool fin)
+{
+    if (!m_deflate_ready) {
+        return false;
+    }
+
+    const auto start = out.size();
+
+    out.reserve(start + deflateBound(&m_deflate, message.length()) + FLUSH_TRAILER.length());
+
+    if (!pump(m_deflate, message, out, [this] { return ::deflate(&m_deflate, Z_SYNC_FLUSH); })) {
+        out.resize(start);
+        return false;
+    }
+    // The trailers of the fragments before the last one are empty blocks, which the server skips over.
+    if (!fin) {
+        return true;
+    }
+    if (std::string_view { out }.substr(start).ends_with(FLUSH_TRAILER)) {
+        out.resize(out.size() - FLUSH_TRAILER.length());
+    }
+    if (m_parameters.client_no_context_takeover) {
+        deflateReset(&m_deflate);
+    }
+    return true;
+}
+
+bool PerMessageDeflate::inflate(std::string_view fragment, std::string& out, size_t max_size)
+{
+    if (!m_inflate_ready) {
+        return false;
+    }
+
+    return pump(
+        m_inflate, fragment, out,
+        [this] {
+            const auto ret = ::inflate(&m_inflate, Z_SYNC_FLUSH);
+
+            // The server ended its stream with a final block, whatever follows starts a new one.
+            if (ret == Z_STREAM_END) {
+                return inflateReset(&m_inflate);
+            }
+            return ret;
+        },
+        max_size);
+}
+
+bool PerMessageDeflate::finish_inflate(std::string& out, size_t max_size)
+{
+    if (!inflate(FLUSH_TRAILER, out, max_size)) {
+        return false;
+    }
+    if (m_parameters.server_no_context_takeover) {
+        inflateReset(&m_inflate);
+    }
+    return true;
+}
+
+ZlibStream::ZlibStream() { m_inflate_ready = inflateInit(&m_inflate) == Z_OK; }
+
+ZlibStream::~ZlibStream()
+{
+    if (m_inflate_ready) {
+        inflateEnd(&m_inflate);
+    }
+}
+
+ZlibStream::Result ZlibStream::feed(std::string_view data, std::string& out, size_t max_size)
+{
+    if (!m_inflate_ready) {
+        return Result::CORRUPT;
+    }
+
+    // Data that completes a message on its own is decompressed straight away, without buffering it first.
+    if (!m_pending.empty() || !data.ends_with(FLUSH_TRAILER)) {
+        m_pending += data;
+        if (!data.ends_with(FLUSH_TRAILER)) {
+            return Result::PARTIAL;
+        }
+        data = m_pending;
+    }
+
+    out.clear();
+
+    const auto ok = pump(
+        m_inflate, data, out, [this] { return ::inflate(&m_inflate, Z_SYNC_FLUSH); }, max_size);
+
+    m_pending.clear();
+    if (!ok) {
+        m_inflate_ready = false;
+        inflateEnd(&m_inflate);
+        return Result::CORRUPT;
+    }
+    return Result::COMPLETE;
+}
+} // namespace ekisocket::ws
@@ -0,0 +1,134 @@
+#pragma once
+#include <ekisocket/WebSocketClient.hpp>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#define ZLIB_CONST
+#include <zlib.h>
+
+namespace ekisocket::ws {
+/**
+ * @brief The permessage-deflate parameters both ends agreed on in the handshake.
+ */
+struct DeflateParameters {
+    bool server_no_context_takeover {};
+    bool client_no_context_takeover {};
+    uint8_t server_max_window_bits { 15 };
+    uint8_t client_max_window_bits { 15 };
+};
+
+/**
+ * @brief The compression contexts of a connection that negotiated permessage-deflate (RFC 7692). Messages are
+ * compressed and decompressed one frame at a time.
+ */
+class PerMessageDeflate {
+public:
+    /**
+     * @param parameters The parameters agreed on in the handshake.
+     * @param min_message_size The size below which messages are sent uncompressed.
+     */
+    PerMessageDeflate(const DeflateParameters& parameters, size_t min_message_size);
+    PerMessageDeflate(const PerMessageDeflate&) = delete;
+    PerMessageDeflate& operator=(const PerMessageDeflate&) = delete;
+    PerMessageDeflate(PerMessageDeflate&&) = delete;
+    PerMessageDeflate& operator=(PerMessageDeflate&&) = delete;
+    ~PerMessageDeflate();
+
+    /**
+     * @brief Builds the value of the "Sec-WebSocket-Extensions" header offering the given options.
+     */
+    [[nodiscard]] static std::string offer(const DeflateOptions& options);
+
+    /**
+     * @brief Validates the extension the server accepted against what was offered.
+     *
+     * @param response The value of the "Sec-WebSocket-Extensions" header of the handshake response.
+     * @param options The options that were offered.
+     * @return std::optional The agreed parameters, or std::nullopt if the server response is invalid.
+     */
+    [[nodiscard]] static std::optional<DeflateParameters> negotiate(
+        std::string_view response, const DeflateOptions& options);
+
+    /**
+     * @brief Whether or not a message of the given size is worth compressing.
+     */
+    [[nodiscard]] bool should_deflate(size_t size) const { return size >= m_min_message_size; }
+
+    /**
+     * @brief Compresses a message, or the next part of one, appending the payload to send to out.
+     *
+     * @param fin Whether or not this ends the message.
+     * @return bool Whether or not the data was compressed.
+     */
+    [[nodiscard]] bool deflate(std::string_view message, std::string& out, bool fin = true);
+
+    /**
+     * @brief Decompresses the next frame of the message being received, appending the data to out.
+     *
+     * @param max_size Decompression stops once out grows past this size.
+     * @return bool Whether or not the data could be decompressed, without out growing past max_size.
+     */
+    [[nodiscard]] bool inflate(
+        std::string_view fragment, std::string& out, size_t max_size = std::numeric_limits<size_t>::max());
+
+    /**
+     * @brief Ends the message being received, once its final frame has been passed to inflate().
+     *
+     * @return bool Whether or not the message could be decompressed, without out growing past max_size.
+     */
+    [[nodiscard]] bool finish_inflate(std::string& out, size_t max_size = std::numeric_limits<size_t>::max());
+
+private:
+    DeflateParameters m_parameters {};
+    size_t m_min_message_size {};
+    z_stream m_deflate {};
+    z_stream m_inflate {};
+    /// Whether or not the streams were initialised, which only fails when out of memory.
+    bool m_deflate_ready {};
+    bool m_inflate_ready {};
+};
+
+/**
+ * @brief Decompresses a zlib stream that spans the whole connection, as sent by servers such as the Discord gateway
+ * with "compress=zlib-stream". The stream is flushed at the end of every message, so whole messages are delivered
+ * once data ending with a flush has arrived.
+ */
+class ZlibStream {
+public:
+    enum class Result : uint8_t {
+        /// The message continues in the next data.
+        PARTIAL,
+        /// A whole message was decompressed.
+        COMPLETE,
+        /// The stream is corrupt, and cannot be decompressed any further.
+        CORRUPT,
+    };
+
+    ZlibStream();
+    ZlibStream(const ZlibStream&) = delete;
+    ZlibStream& operator=(const ZlibStream&) = delete;
+    ZlibStream(ZlibStream&&) = delete;
+    ZlibStream& operator=(ZlibStream&&) = delete;
+    ~ZlibStream();
+
+    /**
+     * @brief Adds the payload of a message to the stream.
+     *
+     * @param data The compressed data.
+     * @param out Replaced by the decompressed message, if it is complete. Its capacity is reused.
+     * @param max_size The largest message accepted. The stream is corrupt once a message grows past it, since the rest
+     * of the message is not decompressed.
+     * @return Result Whether a whole message was decompressed into out.
+     */
+    [[nodiscard]] Result feed(
+        std::string_view data, std::string& out, size_t max_size = std::numeric_limits<size_t>::max());
+
+private:
+    z_stream m_inflate {};
+    bool m_inflate_ready {};
+    /// Compressed data received before the flush that completes it.
+    std::string m_pending {};
+};
+} // namespace ekisocket::ws
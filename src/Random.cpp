@@ -0,0 +1,181 @@
+#include <Random.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <openssl/rand.h>
+#include <random>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/random.h>
+#endif
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+namespace {
+/// Counts the forks of the process, so that a child does not go on with the output of its parent.
+std::atomic_uint64_t g_forks {};
+
+constexpr uint32_t rotl(uint32_t x, uint32_t n) { return (x << n) | (x >> (32U - n)); }
+
+constexpr void quarter_round(std::array<uint32_t, 16>& s, size_t a, size_t b, size_t c, size_t d)
+{
+    s[a] += s[b];
+    s[d] = rotl(s[d] ^ s[a], 16);
+    s[c] += s[d];
+    s[b] = rotl(s[b] ^ s[c], 12);
+    s[a] += s[b];
+    s[d] = rotl(s[d] ^ s[a], 8);
+    s[c] += s[d];
+    s[b] = rotl(s[b] ^ s[c], 7);
+}
+
+/**
+ * @brief Computes a ChaCha20 block (RFC 8439) with a 64-bit counter and a zero nonce.
+ */
+void chacha20_block(const std::array<uint32_t, 8>& key, uint64_t counter, uint8_t* out)
+{
+    // "expand 32-byte k"
+    std::array<uint32_t, 16> input { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+
+    std::copy(key.begin(), key.end(), input.begin() + 4);
+    input[12] = static_cast<uint32_t>(counter);
+    input[13] = static_cast<uint32_t>(counter >> 32U);
+
+    auto state = input;
+
+    for (size_t i {}; i < 10; ++i) {
+        quarter_round(state, 0, 4, 8, 12);
+        quarter_round(state, 1, 5, 9, 13);
+        quarter_round(state, 2, 6, 10, 14);
+        quarter_round(state, 3, 7, 11, 15);
+        quarter_round(state, 0, 5, 10, 15);
+        quarter_round(state, 1, 6, 11, 12);
+        quarter_round(state, 2, 7, 8, 13);
+        quarter_round(state, 3, 4, 9, 14);
+    }
+    for (size_t i {}; i < state.size(); ++i) {
+        const auto word = state[i] + input[i];
+
+        // Little-endian, whatever the platform.
+        out[i * 4] = static_cast<uint8_t>(word);
+        out[i * 4 + 1] = static_cast<uint8_t>(word >> 8U);
+        out[i * 4 + 2] = static_cast<uint8_t>(word >> 16U);
+        out[i * 4 + 3] = static_cast<uint8_t>(word >> 24U);
+    }
+}
+
+/**
+ * @brief Reads entropy from the operating system, through getrandom() where there is one and OpenSSL otherwise.
+ */
+void os_random(uint8_t* out, size_t len)
+{
+#ifdef __linux__
+    size_t done {};
+
+    while (done < len) {
+        const auto ret = getrandom(out + done, len - done, 0);
+
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        done += static_cast<size_t>(ret);
+    }
+    if (done == len) {
+        return;
+    }
+#endif
+    if (RAND_bytes(out, static_cast<int>(len)) == 1) {
+        return;
+    }
+
+    // Neither is available, which leaves the generator of the standard library.
+    std::random_device rd {};
+    for (size_t i {}; i < len; ++i) {
+        out[i] = static_cast<uint8_t>(rd());
+    }
+}
+} // namespace
+
+namespace ekisocket {
+ChaChaRng& ChaChaRng::local()
+{
+#ifndef _WIN32
+    static std::once_flag at_fork {};
+    std::call_once(at_fork, [] { pthread_atfork(nullptr, nullptr, [] { ++g_forks; }); });
+#endif
+
+    thread_local ChaChaRng rng {};
+    return rng;
+}
+
+void ChaChaRng::fill(uint8_t* out, size_t len)
+{
+    if (!m_seeded || m_since_reseed >= RESEED_INTERVAL || m_forks != g_forks.load(std::memory_order_relaxed)) {
+        reseed();
+    }
+
+    m_since_reseed += len;
+    while (len > 0) {
+        if (m_available == 0) {
+            refill();
+        }
+
+        auto* const start = m_buffer.data() + (BUFFER_SIZE - m_available);
+        const auto size = (std::min)(len, m_available);
+
+        std::memcpy(out, start, size);
+        std::memset(start, 0, size);
+        out += size;
+        len -= size;
+        m_available -= size;
+    }
+}
+
+uint32_t ChaChaRng::next_u32()
+{
+    std::array<uint8_t, 4> bytes {};
+
+    fill(bytes.data(), bytes.size());
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8U)
+        | (static_cast<uint32_t>(bytes[2]) << 16U) | (static_cast<uint32_t>(bytes[3]) << 24U);
+}
+
+void ChaChaRng::reseed()
+{
+    std::array<uint8_t, KEY_SIZE> seed {};
+
+    os_random(seed.data(), seed.size());
+    for (size_t i {}; i < m_key.size(); ++i) {
+        uint32_t word {};
+
+        std::memcpy(&word, seed.data() + i * 4, 4);
+        m_key[i] ^= word;
+    }
+    std::memset(seed.data(), 0, seed.size());
+
+    // Output generated with the old key is not handed out anymore.
+    std::memset(m_buffer.data(), 0, m_buffer.size());
+    m_available = 0;
+    m_since_reseed = 0;
+    m_forks = g_forks.load(std::memory_order_relaxed);
+    m_seeded = true;
+}
+
+void ChaChaRng::refill()
+{
+    for (size_t i {}; i < BUFFER_SIZE / BLOCK_SIZE; ++i) {
+        chacha20_block(m_key, i, m_buffer.data() + i * BLOCK_SIZE);
+    }
+
+    // The key of the next batch comes from this one, and is not part of the output.
+    std::memcpy(m_key.data(), m_buffer.data(), KEY_SIZE);
+    std::memset(m_buffer.data(), 0, KEY_SIZE);
+    m_available = BUFFER_SIZE - KEY_SIZE;
+}
+} // namespace ekisocket
@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace ekisocket {
+/**
+ * @brief A ChaCha20-based random generator, for masking keys, handshake keys and boundaries. Every thread has its own,
+ * seeded from the operating system on first use, then reseeded after every RESEED_INTERVAL bytes and after a fork, so
+ * that generating numbers does not cost a system call.
+ *
+ * Blocks are generated in batches, the first 32 bytes of which become the key of the next batch, and bytes are wiped
+ * as they are handed out ("fast key erasure"), so that output that has been used cannot be recovered from the state.
+ */
+class ChaChaRng {
+public:
+    ChaChaRng(const ChaChaRng&) = delete;
+    ChaChaRng& operator=(const ChaChaRng&) = delete;
+    ChaChaRng(ChaChaRng&&) = delete;
+    ChaChaRng& operator=(ChaChaRng&&) = delete;
+    ~ChaChaRng() = default;
+
+    /**
+     * @brief The generator of the calling thread.
+     */
+    [[nodiscard]] static ChaChaRng& local();
+
+    /**
+     * @brief Fills out with len random bytes.
+     */
+    void fill(uint8_t* out, size_t len);
+
+    /**
+     * @brief A random 32-bit unsigned integer.
+     */
+    [[nodiscard]] uint32_t next_u32();
+
+private:
+    static constexpr size_t KEY_SIZE { 32 };
+    static constexpr size_t BLOCK_SIZE { 64 };
+    static constexpr size_t BUFFER_SIZE { BLOCK_SIZE * 16 };
+    static constexpr uint64_t RESEED_INTERVAL { uint64_t { 1 } << 20U };
+
+    ChaChaRng() = default;
+
+    /**
+     * @brief Mixes fresh entropy from the operating system into the key, and discards the buffered output.
+     */
+    void reseed();
+
+    /**
+     * @brief Generates the next batch of blocks, taking the key of the batch after it from the front.
+     */
+    void refill();
+
+    std::array<uint32_t, KEY_SIZE / 4> m_key {};
+    std::array<uint8_t, BUFFER_SIZE> m_buffer {};
+    /// How many bytes at the end of the buffer have not been handed out yet.
+    size_t m_available {};
+    /// How many bytes have been handed out since the last reseed.
+    uint64_t m_since_reseed {};
+    /// The number of forks the process had gone through when the generator was last seeded.
+    uint64_t m_forks {};
+    bool m_seeded {};
+};
+} // namespace ekisocket
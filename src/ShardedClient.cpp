@@ -0,0 +1,197 @@
+#include <ekisocket/ShardedClient.hpp>
+#include <fmt/format.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+constexpr std::chrono::seconds DEFAULT_DNS_TTL { 60 };
+constexpr uint16_t HTTP_PORT { 80 };
+constexpr uint16_t HTTPS_PORT { 443 };
+
+/**
+ * @brief Everything a shard owns. Only ever touched by the thread it belongs to, and aligned so that two shards never
+ * share a cache line.
+ */
+struct alignas(64) Shard {
+    struct CachedAddress {
+        std::string address {};
+        std::chrono::steady_clock::time_point expires {};
+    };
+
+    struct Connection {
+        std::unique_ptr<ekisocket::http::Client> client {};
+        /// The address the client is currently pinned to.
+        std::string address {};
+    };
+
+    /**
+     * @brief Returns the keep-alive connection to the origin of the URI, pinned to a cached address of its host.
+     *
+     * @param uri The parsed URI of the request.
+     * @param ttl How long resolved addresses are cached, 0 disables the cache.
+     * @return ekisocket::http::Client& The client to use.
+     */
+    ekisocket::http::Client& client_for(const ekisocket::http::Uri& uri, std::chrono::seconds ttl)
+    {
+        const auto https = ekisocket::util::iequals(uri.scheme, "https");
+        const auto port = uri.port.value_or(https ? HTTPS_PORT : HTTP_PORT);
+        auto& conn = connections[fmt::format("{}://{}:{}", uri.scheme, uri.host, port)];
+
+        if (!conn.client) {
+            conn.client = std::make_unique<ekisocket::http::Client>();
+        }
+        if (ttl.count() == 0) {
+            return *conn.client;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        auto& cached = dns[uri.host];
+
+        if (cached.address.empty() || cached.expires <= now) {
+            auto addresses = ekisocket::util::resolve_addresses(uri.host, port);
+            // If the lookup fails, the client resolves the host itself and reports the error.
+            cached.address = addresses.empty() ? std::string {} : std::move(addresses.front());
+            cached.expires = now + ttl;
+        }
+        if (conn.address != cached.address) {
+            conn.client->set_address(cached.address);
+            conn.address = cached.address;
+        }
+
+        return *conn.client;
+    }
+
+    /// Keep-alive connections, keyed by origin.
+    std::unordered_map<std::string, Connection> connections {};
+    /// Resolved addresses, keyed by host.
+    std::unordered_map<std::string, CachedAddress> dns {};
+};
+
+/// The owner and shard of the current thread, if it is a worker.
+thread_local const void* t_owner {};
+thread_local Shard* t_shard {};
+} // namespace
+
+namespace ekisocket::http {
+struct ShardedClient::Impl {
+    Impl(size_t shards, bool pin_threads)
+        : m_shards { shards == 0 ? (std::max)(std::thread::hardware_concurrency(), 1U) : shards }
+        , m_pin_threads { pin_threads }
+    {
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+    Impl(Impl&&) = delete;
+    Impl& operator=(Impl&&) = delete;
+
+    ~Impl() { join(); }
+
+    void set_dns_ttl(std::chrono::seconds ttl) { m_dns_ttl = ttl; }
+
+    void run(const std::function<void(size_t shard)>& worker)
+    {
+        m_workers.reserve(m_workers.size() + m_shards);
+
+        for (size_t i {}; i < m_shards; ++i) {
+            m_workers.emplace_back([this, i, worker] {
+                if (m_pin_threads) {
+                    (void)util::pin_thread_to_core(i);
+                }
+
+                // Allocated by the worker itself, so its memory is local to the core it runs on.
+                const auto shard = std::make_unique<Shard>();
+                t_owner = this;
+                t_shard = shard.get();
+                worker(i);
+                t_owner = nullptr;
+                t_shard = nullptr;
+            });
+        }
+    }
+
+    void join()
+    {
+        for (auto& worker : m_workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+        m_workers.clear();
+    }
+
+    [[nodiscard]] size_t shard_count() const { return m_shards; }
+
+    Response request(const Method& method, std::string_view url, const Headers& headers, std::string_view body,
+        std::error_code& ec, bool stream, const BodyCallback& cb)
+    {
+        auto& shard = current_shard();
+        const auto uri = Uri::parse(url);
+        auto& client = shard.client_for(uri, m_dns_ttl);
+        auto res = client.request(method, url, headers, body, ec, true, stream, cb);
+
+        // The cached address may be stale, so look it up again next time.
+        if (ec) {
+            shard.dns.erase(uri.host);
+        }
+        return res;
+    }
+
+private:
+    Shard& current_shard() const
+    {
+        if (t_owner == this) {
+            return *t_shard;
+        }
+
+        // Threads that are not our workers get their own shard.
+        thread_local Shard own_shard {};
+        return own_shard;
+    }
+
+    /// The number of shards.
+    size_t m_shards {};
+    /// Whether or not to pin the workers to cores.
+    bool m_pin_threads {};
+    /// How long the shards cache resolved addresses.
+    std::chrono::seconds m_dns_ttl { DEFAULT_DNS_TTL };
+    /// The worker threads, one per shard.
+    std::vector<std::jthread> m_workers {};
+};
+
+ShardedClient::ShardedClient(size_t shards, bool pin_threads)
+    : m_impl { std::make_unique<ShardedClient::Impl>(shards, pin_threads) }
+{
+}
+
+ShardedClient::ShardedClient(ShardedClient&&) noexcept = default;
+ShardedClient& ShardedClient::operator=(ShardedClient&&) noexcept = default;
+ShardedClient::~ShardedClient() = default;
+
+void ShardedClient::set_dns_ttl(std::chrono::seconds ttl) const { m_impl->set_dns_ttl(ttl); }
+
+void ShardedClient::run(const std::function<void(size_t shard)>& worker) const { m_impl->run(worker); }
+
+void ShardedClient::join() const { m_impl->join(); }
+
+size_t ShardedClient::shard_count() const { return m_impl->shard_count(); }
+
+Response ShardedClient::request(const Method& method, std::string_view url, const Headers& headers,
+    std::string_view body, bool stream, const BodyCallback& cb) const
+{
+    std::error_code ec {};
+    auto res = m_impl->request(method, url, headers, body, ec, stream, cb);
+
+    if (ec) {
+        throw errors::HttpClientError(fmt::format("{}: {}", ec.message(), url));
+    }
+    return res;
+}
+
+Response ShardedClient::request(const Method& method, std::string_view url, const Headers& headers,
+    std::string_view body, std::error_code& ec, bool stream, const BodyCallback& cb) const
+{
+    return m_impl->request(method, url, headers, body, ec, stream, cb);
+}
+} // namespace ekisocket::http
@@ -1,3 +1,4 @@
+#include <array>
 #include <atomic>
 #include <ekisocket/Socket.hpp>
 #include <ekisocket/SslClient.hpp>
@@ -10,6 +11,9 @@
 #ifdef _WIN32
 #include <shlwapi.h>
 #include <wincrypt.h>
+#else
+#include <sys/socket.h>
+#include <sys/uio.h>
 #endif
 #ifndef _WIN32
 #pragma GCC diagnostic push
@@ -28,6 +32,27 @@
 #endif
 
 namespace {
+/// The most data gathered into a single write, which TLS encrypts into as few records as it can.
+constexpr size_t MAX_GATHER_SIZE { 65536 };
+#ifndef _WIN32
+/// The maximum number of buffers handed to a single sendmsg().
+constexpr size_t MAX_IOVECS { 64 };
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS { MSG_NOSIGNAL };
+#else
+constexpr int SEND_FLAGS {};
+#endif
+
+bool would_block()
+{
+#if EAGAIN == EWOULDBLOCK
+    return socketerrno == EAGAIN || socketerrno == EINTR;
+#else
+    return socketerrno == EAGAIN || socketerrno == EWOULDBLOCK || socketerrno == EINTR;
+#endif
+}
+#endif
+
 template <typename T> struct DeleterOf;
 
 template <> struct DeleterOf<BIO> {
@@ -46,43 +71,30 @@ UniqueSSLPtr<BIO> operator|(UniqueSSLPtr<BIO>& lower, UniqueSSLPtr<BIO>&& upper)
     return std::move(upper);
 }
 
-std::string get_errno_string()
+/**
+ * @brief Captures the most specific error available, preferring the OpenSSL error queue, then the socket errno, and
+ * finally the given fallback. No strings are formatted here, that only happens if the caller asks for ec.message().
+ */
+void set_error(std::error_code& ec, ekisocket::errors::Error fallback, bool use_ssl, bool use_errno = true)
 {
-    std::string ret {};
-#ifdef _WIN32
-    ret.resize(256);
-    FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, nullptr, socketerrno,
-        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), ret.data(), static_cast<DWORD>(ret.size()), nullptr);
-
-    if (ret.empty()) {
-        ret = std::to_string(socketerrno);
+    if (const auto err = ERR_peek_last_error(); use_ssl && err != 0) {
+        ec.assign(static_cast<int>(err), ekisocket::errors::ssl_category());
+    } else if (const auto err_no = socketerrno; use_errno && err_no != 0) {
+        ec.assign(err_no, std::system_category());
+    } else {
+        ec = fallback;
     }
-    ret = fmt::format("{}: {}", socketerrno, ret);
-#else
-    ret = fmt::format("{}: {}", socketerrno, std::strerror(socketerrno));
-#endif
-    return ret;
+    ERR_clear_error();
 }
 
-[[noreturn]] void print_errors_and_throw(std::string_view message, bool use_ssl, bool print_errno = true)
+[[noreturn]] void throw_error_impl(std::string_view message, const std::error_code& ec)
 {
-    const auto bio = UniqueSSLPtr<BIO>(BIO_new(BIO_s_mem()));
-    ERR_print_errors(bio.get());
-    char* buf {};
-#ifndef _WIN32
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wold-style-cast"
-#endif
-    const auto len = BIO_get_mem_data(bio.get(), &buf);
-#ifndef _WIN32
-#pragma GCC diagnostic pop
-#endif
-    std::string err_str(buf, static_cast<size_t>(len));
+    const auto& cat = ec.category();
     const auto combined_msg = fmt::format("{}\n"
                                           "{}"
                                           "{}",
-        message, use_ssl ? fmt::format("OpenSSL Error: {}\n", err_str) : "",
-        print_errno ? fmt::format("Socket Error: {}\n", get_errno_string()) : "");
+        message, cat == ekisocket::errors::ssl_category() ? fmt::format("OpenSSL Error: {}\n", ec.message()) : "",
+        cat == std::system_category() ? fmt::format("Socket Error: {}: {}\n", ec.value(), ec.message()) : "");
 
     throw ekisocket::errors::SslClientError(combined_msg);
 }
@@ -98,9 +110,6 @@ SSL* get_ssl(BIO* bio)
 #ifndef _WIN32
 #pragma GCC diagnostic pop
 #endif
-    if (ssl == nullptr) {
-        print_errors_and_throw("Unable to get SSL object from BIO.", true);
-    }
     return ssl;
 }
 
@@ -136,23 +145,28 @@ bool load_windows_certificates(const SSL_CTX* ssl)
 }
 #endif
 
-void verify_the_certificate(SSL const* ssl, [[maybe_unused]] std::string_view expected_hostname)
+/**
+ * @brief Verifies the certificate presented by the server.
+ *
+ * @return const char* nullptr if the certificate is valid, otherwise a static string describing the failure.
+ */
+const char* verify_the_certificate(SSL const* ssl, [[maybe_unused]] std::string_view expected_hostname)
 {
     if (const auto err = SSL_get_verify_result(ssl); err != X509_V_OK) {
-        const char* message = X509_verify_cert_error_string(err);
-        print_errors_and_throw(message, true);
+        return X509_verify_cert_error_string(err);
     }
     if (const auto* cert = SSL_get_peer_certificate(ssl); cert == nullptr) {
-        print_errors_and_throw("No certificate was presented by the server.", true);
+        return "No certificate was presented by the server.";
     }
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
     if (X509_check_host(cert, expected_hostname.data(), expected_hostname.size(), 0, nullptr) != 1) {
-        print_errors_and_throw("Certificate verification error: X509_check_host failed.", true);
+        return "Certificate verification error: X509_check_host failed.";
     }
 #else
     // X509_check_host is called automatically during verification,
     // because we set it up in main().
 #endif
+    return nullptr;
 }
 
 template <class T, class U> constexpr bool cmp_equal(T t, U u) noexcept
@@ -208,11 +222,7 @@ struct Client::Impl {
 
     ~Impl()
     {
-        try {
-            close();
-        } catch (const errors::SslClientError& e) {
-            fmt::print(stderr, "Error closing SslClient connection: {}\n", e.what());
-        }
+        close();
         // When there are no more SSL instances, we must shutdown winsock if using windows.
         if (--ssl_client_count == 0) {
             BIO_sock_cleanup();
@@ -245,6 +255,12 @@ struct Client::Impl {
         m_hostname = std::move(hostname);
     }
 
+    void set_address(std::string address)
+    {
+        std::scoped_lock lk { m_mtx };
+        m_address = std::move(address);
+    }
+
     void set_port(uint16_t port)
     {
         std::scoped_lock lk { m_mtx };
@@ -269,9 +285,10 @@ struct Client::Impl {
         m_verify_certs = verify;
     }
 
-    bool connect()
+    bool connect(std::error_code& ec)
     {
         std::scoped_lock lk { m_mtx };
+        ec.clear();
         // Check the obvious case of none provided.
         if (m_hostname.empty() || m_port == 0 || m_connected) {
             return false;
@@ -279,10 +296,13 @@ struct Client::Impl {
 
         BIO_ADDRINFO* res {};
 
-        if (BIO_lookup_ex(m_hostname.c_str(), std::to_string(m_port).c_str(), BIO_LOOKUP_CLIENT, AF_INET,
+        // A pinned address skips the hostname resolution, while the hostname is still used for SNI/verification.
+        const auto& node = m_address.empty() ? m_hostname : m_address;
+
+        if (BIO_lookup_ex(node.c_str(), std::to_string(m_port).c_str(), BIO_LOOKUP_CLIENT, AF_INET,
                 m_use_udp ? SOCK_DGRAM : SOCK_STREAM, m_use_udp ? IPPROTO_UDP : IPPROTO_TCP, &res)
             == 0) {
-            print_errors_and_throw("Unable to lookup address.", m_use_ssl);
+            return fail(ec, errors::Error::LOOKUP_FAILED, "Unable to lookup address.");
         }
         for (const BIO_ADDRINFO* ai = res; ai != nullptr; ai = BIO_ADDRINFO_next(ai)) {
             const auto sfd
@@ -305,17 +325,15 @@ struct Client::Impl {
                 BIO_closesocket(sfd);
                 continue;
             }
-            if (cmp_equal(sfd, INVALID_SOCKET)) {
-                print_errors_and_throw("Unable to connect to host.", m_use_ssl);
-            }
 
             m_context.bio = UniqueSSLPtr<BIO>(BIO_new_socket(sfd, BIO_CLOSE));
             m_context.sfd.store(sfd);
-            BIO_ADDRINFO_free(res);
             break;
         }
+        BIO_ADDRINFO_free(res);
+
         if (!m_context.bio) {
-            print_errors_and_throw("Error creating BIO.", m_use_ssl);
+            return fail(ec, errors::Error::CONNECT_FAILED, "Error creating BIO.");
         }
 
         const auto old_timeout = m_timeout.load();
@@ -337,49 +355,58 @@ struct Client::Impl {
 #define OPTVAL (&optval)
 #endif
             if (getsockopt(m_context.sfd.load(), SOL_SOCKET, SO_ERROR, OPTVAL, &optlen) == -1) {
-                print_errors_and_throw("Unable to get socket options.", m_use_ssl);
+                return fail(ec, errors::Error::CONNECT_FAILED, "Unable to get socket options.");
             }
             if (optval != 0) {
-                std::string so_err_str {};
-#ifdef _WIN32
-                std::string buffer(94, '\0');
-                (void)strerror_s(buffer.data(), buffer.size(), optval);
-                so_err_str = buffer;
-#else
-                so_err_str = strerror(optval);
-#endif
-                print_errors_and_throw(fmt::format("Socket Error {}: {}", optval, so_err_str), m_use_ssl, false);
+                ec.assign(optval, std::system_category());
+                m_error_context = "Unable to connect to host.";
+                reset();
+                return false;
             }
         } else {
             m_connected = true;
         }
 
         if (m_use_ssl) {
-            create_context();
-            if (auto ret = BIO_do_connect(m_context.bio.get()); ret <= 0) {
-                if (!BIO_should_retry(m_context.bio.get())) {
-                    print_errors_and_throw("Unable to connect to host.", m_use_ssl);
-                }
-                do {
-                    ret = BIO_do_connect(m_context.bio.get());
-                } while (ret != 1);
+            if (!create_context(ec)) {
+                return false;
+            }
+
+            auto ret = BIO_do_connect(m_context.bio.get());
+
+            while (ret <= 0 && BIO_should_retry(m_context.bio.get())) {
+                ret = BIO_do_connect(m_context.bio.get());
+            }
+            if (ret <= 0) {
+                return fail(ec, errors::Error::SSL_FAILED, "Unable to connect to host.");
             }
             if (m_verify_certs) {
-                verify_the_certificate(get_ssl(m_context.bio.get()), m_hostname);
+                if (const auto* message = verify_the_certificate(get_ssl(m_context.bio.get()), m_hostname);
+                    message != nullptr) {
+                    ec = errors::Error::CERTIFICATE_INVALID;
+                    m_error_context = message;
+                    reset();
+                    return false;
+                }
             }
         }
         return true;
     }
 
-    size_t send(std::string_view message)
+    size_t send(std::string_view message, std::error_code& ec)
     {
+        ec.clear();
         // If the length of our message is greater than the max value of an int, we cannot guarantee that we can send it
         // all.
         if (message.length() > static_cast<size_t>((std::numeric_limits<int>::max)())) {
-            throw errors::SslClientError("Message too long to send. Please split it into smaller messages.");
+            ec = errors::Error::MESSAGE_TOO_LONG;
+            m_error_context = "Message too long to send. Please split it into smaller messages.";
+            return 0;
         }
         if (!m_connected) {
-            print_errors_and_throw("Not connected.", m_use_ssl);
+            ec = errors::Error::NOT_CONNECTED;
+            m_error_context = "Not connected.";
+            return 0;
         }
         if (!query(false, true)) {
             return 0;
@@ -392,6 +419,9 @@ struct Client::Impl {
                 return 0;
             }
             m_connected = false;
+            set_error(ec, errors::Error::CONNECTION_CLOSED, m_use_ssl);
+            m_error_context = "Error sending data.";
+            return 0;
         }
 #ifndef _WIN32
 #pragma GCC diagnostic push
@@ -405,52 +435,141 @@ struct Client::Impl {
         return static_cast<size_t>(ret);
     }
 
-    std::string receive(size_t buf_size = 4096)
+    size_t sendv(std::span<const std::string_view> bufs, std::error_code& ec)
     {
-        if (buf_size > static_cast<size_t>((std::numeric_limits<int>::max)())) {
-            throw errors::SslClientError("Buffer size too large to receive. Please split it into smaller buffers.");
+        ec.clear();
+        if (!m_connected) {
+            ec = errors::Error::NOT_CONNECTED;
+            m_error_context = "Not connected.";
+            return 0;
+        }
+#ifndef _WIN32
+        // Plain TCP goes straight to the socket, which sends all the buffers with a single system call.
+        if (!m_use_ssl && !m_use_udp) {
+            if (!query(false, true)) {
+                return 0;
+            }
+
+            std::array<iovec, MAX_IOVECS> iov {};
+            const auto count = (std::min)(bufs.size(), iov.size());
+
+            for (size_t i {}; i < count; ++i) {
+                iov[i] = iovec { const_cast<char*>(bufs[i].data()), bufs[i].size() };
+            }
+
+            msghdr msg {};
+            msg.msg_iov = iov.data();
+#ifdef __APPLE__
+            msg.msg_iovlen = static_cast<int>(count);
+#else
+            msg.msg_iovlen = count;
+#endif
+            const auto ret = ::sendmsg(m_context.sfd.load(), &msg, SEND_FLAGS);
+
+            if (ret < 0) {
+                if (would_block()) {
+                    return 0;
+                }
+                m_connected = false;
+                set_error(ec, errors::Error::CONNECTION_CLOSED, false);
+                m_error_context = "Error sending data.";
+                return 0;
+            }
+            return static_cast<size_t>(ret);
+        }
+#endif
+        // Everything else is gathered into one write, so that TLS produces as few records as possible, and is flushed
+        // once. Retried writes gather the same bytes again, which is what OpenSSL expects.
+        m_gather.clear();
+        for (const auto buf : bufs) {
+            m_gather += buf.substr(0, MAX_GATHER_SIZE - m_gather.size());
+            if (m_gather.size() == MAX_GATHER_SIZE) {
+                break;
+            }
+        }
+        return send(m_gather, ec);
+    }
+
+    std::string receive(size_t buf_size, std::error_code& ec)
+    {
+        std::string ret(buf_size, '\0');
+
+        ret.resize(receive_into(ret, ec));
+        ret.shrink_to_fit();
+        return ret;
+    }
+
+    size_t receive_into(std::span<char> buf, std::error_code& ec)
+    {
+        ec.clear();
+        if (buf.size() > static_cast<size_t>((std::numeric_limits<int>::max)())) {
+            ec = errors::Error::MESSAGE_TOO_LONG;
+            m_error_context = "Buffer size too large to receive. Please split it into smaller buffers.";
+            return 0;
         }
         if (!m_connected) {
-            print_errors_and_throw("Not connected.", m_use_ssl);
+            ec = errors::Error::NOT_CONNECTED;
+            m_error_context = "Not connected.";
+            return 0;
         }
         if (!m_context.bio) {
-            print_errors_and_throw("Could not retrieve the underlying socket BIO.", m_use_ssl);
+            ec = errors::Error::NOT_CONNECTED;
+            m_error_context = "Could not retrieve the underlying socket BIO.";
+            return 0;
         }
 
         size_t bytes_read {};
-        std::string ret(buf_size, '\0');
 
         // Check if we have any pending data left in our BIO's read buffer.
         if (const auto pending = BIO_ctrl_pending(m_context.bio.get()); pending > 0) {
             bytes_read += static_cast<size_t>((std::max)(
-                BIO_read(m_context.bio.get(), ret.data(), static_cast<int>((std::min)(buf_size, pending))), 0));
+                BIO_read(m_context.bio.get(), buf.data(), static_cast<int>((std::min)(buf.size(), pending))), 0));
         }
         // Reads of 0 should still be allowed for disconnect discovery.
-        if (bytes_read > 0 && bytes_read == buf_size) {
-            return ret;
+        if (bytes_read > 0 && bytes_read == buf.size()) {
+            return bytes_read;
         }
 
         (void)query(true, false);
 
         const auto len = BIO_read(
-            m_context.bio.get(), std::span(ret).subspan(bytes_read).data(), static_cast<int>(buf_size - bytes_read));
+            m_context.bio.get(), buf.subspan(bytes_read).data(), static_cast<int>(buf.size() - bytes_read));
 
         bytes_read += static_cast<size_t>((std::max)(len, 0));
-        ret.resize(bytes_read);
-        ret.shrink_to_fit();
 
         if (len == 0 && !BIO_should_retry(m_context.bio.get())) {
             m_connected = false;
-            return ret;
+            return bytes_read;
         }
         if (len <= 0) {
             if (BIO_should_retry(m_context.bio.get())) {
-                return ret;
+                return bytes_read;
             }
-            print_errors_and_throw("Error receiving data.", m_use_ssl);
+            // A hard error (e.g. a reset by the peer) means the connection is no longer usable.
+            m_connected = false;
+            set_error(ec, errors::Error::CONNECTION_CLOSED, m_use_ssl);
+            m_error_context = "Error receiving data.";
         }
 
-        return ret;
+        return bytes_read;
+    }
+
+    [[nodiscard]] bool zero_copy_receive() const
+    {
+        std::scoped_lock lk { m_mtx };
+        if (!m_connected || !m_context.bio) {
+            return false;
+        }
+        if (!m_use_ssl) {
+            return true;
+        }
+#ifdef BIO_get_ktls_recv
+        // With kernel TLS the socket yields plaintext, as long as OpenSSL has nothing decrypted left in user space.
+        auto* ssl = get_ssl(m_context.bio.get());
+        return ssl != nullptr && BIO_get_ktls_recv(SSL_get_rbio(ssl)) && SSL_pending(ssl) == 0;
+#else
+        return false;
+#endif
     }
 
     [[nodiscard]] bool query(bool want_read = false, bool want_write = false) const
@@ -497,8 +616,10 @@ struct Client::Impl {
             const auto old_timeout = m_timeout.load();
             set_blocking(false);
 
-            while (m_connected) {
-                receive();
+            // Drain until the peer closes, an error at this point means we are already disconnected.
+            std::error_code ec {};
+            while (m_connected && !ec) {
+                (void)receive(4096, ec);
             }
 #ifdef _WIN32
             WSACloseEvent(event);
@@ -522,12 +643,16 @@ struct Client::Impl {
             bio = BIO_next(bio);
         }
 
-        m_context.bio = nullptr;
-        m_context.ctx = nullptr;
-        m_context.sfd.store(INVALID_SOCKET);
-        m_connected = false;
+        reset();
     }
 
+    /**
+     * @brief Throws the error stored in ec, alongside the context of the operation that failed.
+     *
+     * @param ec The error to throw.
+     */
+    [[noreturn]] void throw_error(const std::error_code& ec) const { throw_error_impl(m_error_context, ec); }
+
 private:
     static void initialize_ssl()
     {
@@ -559,7 +684,7 @@ private:
     /**
      * @brief Creates a new SSL context, which contains data that is essential for establishing an SSL/TLS connection.
      */
-    void create_context()
+    bool create_context(std::error_code& ec)
     {
         UniqueSSLPtr<SSL_CTX> ctx {};
 
@@ -573,12 +698,12 @@ private:
 #endif
         }
         if (!ctx) {
-            print_errors_and_throw("Unable to create SSL context.", true);
+            return fail(ec, errors::Error::SSL_FAILED, "Unable to create SSL context.");
         }
 #if OPENSSL_VERSION_NUMBER >= 0x10100000L
         // Set minimum TLS version.
         if (!SSL_CTX_set_min_proto_version(ctx.get(), m_use_udp ? DTLS1_2_VERSION : TLS1_2_VERSION)) {
-            print_errors_and_throw("Unable to set minimum TLS version.", true);
+            return fail(ec, errors::Error::SSL_FAILED, "Unable to set minimum TLS version.");
         }
 #endif
         // Get certificates from the system store.
@@ -589,34 +714,68 @@ private:
         loaded_certs = SSL_CTX_set_default_verify_paths(ctx.get()) == 1;
 #endif
         if (!loaded_certs) {
-            print_errors_and_throw("Unable to load certificates from the system store.", true);
+            return fail(ec, errors::Error::SSL_FAILED, "Unable to load certificates from the system store.");
         }
 
         m_context.ctx = std::move(ctx);
 
         // Create a new SSL object.
         m_context.bio = m_context.bio | UniqueSSLPtr<BIO>(BIO_new_ssl(m_context.ctx.get(), 1));
+
+        auto* ssl = get_ssl(m_context.bio.get());
+
+        if (ssl == nullptr) {
+            return fail(ec, errors::Error::SSL_FAILED, "Unable to get SSL object from BIO.");
+        }
+
         // Disabling retries.
-        SSL_set_mode(get_ssl(m_context.bio.get()), SSL_MODE_AUTO_RETRY);
+        SSL_set_mode(ssl, SSL_MODE_AUTO_RETRY);
 // Server Name Indication.
 #ifndef _WIN32
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wold-style-cast"
 #endif
-        SSL_set_tlsext_host_name(get_ssl(m_context.bio.get()), m_hostname.c_str());
+        SSL_set_tlsext_host_name(ssl, m_hostname.c_str());
 #ifndef _WIN32
 #pragma GCC diagnostic pop
 #endif
         // Verifying the host is on the certificate.
 #if OPENSSL_VERSION_NUMBER >= 0x10100000L
-        SSL_set1_host(get_ssl(m_context.bio.get()), m_hostname.c_str());
+        SSL_set1_host(ssl, m_hostname.c_str());
 #endif
+        return true;
+    }
+
+    /**
+     * @brief Records a failed operation and drops any partially established connection.
+     *
+     * @return bool Always false, for convenience.
+     */
+    bool fail(std::error_code& ec, errors::Error fallback, const char* context)
+    {
+        set_error(ec, fallback, m_use_ssl);
+        m_error_context = context;
+        reset();
+        return false;
+    }
+
+    /**
+     * @brief Releases the underlying connection state without performing a graceful shutdown.
+     */
+    void reset()
+    {
+        m_context.bio = nullptr;
+        m_context.ctx = nullptr;
+        m_context.sfd.store(INVALID_SOCKET);
+        m_connected = false;
     }
 
     /// Mutex used for thread safety.
     mutable std::mutex m_mtx {};
     /// The hostname of the server.
     std::string m_hostname {};
+    /// The address to connect to instead of resolving the hostname, if not empty.
+    std::string m_address {};
     /// The port of the server.
     uint16_t m_port {};
     /// Whether or not ssl is enabled.
@@ -631,6 +790,10 @@ private:
     bool m_verify_certs {};
     /// The amount of time to wait for a socket to become ready for read/write. Defaults to -1, which means blocking.
     std::atomic_int m_timeout { -1 };
+    /// Static description of the last failed operation, only used when the error is thrown.
+    const char* m_error_context { "" };
+    /// Buffer that sendv() gathers data into, reused from write to write.
+    std::string m_gather {};
 };
 
 std::once_flag Client::Impl::ssl_init {};
@@ -654,6 +817,8 @@ void Client::set_blocking(bool blocking) const { return m_impl->set_blocking(blo
 
 void Client::set_hostname(std::string hostname) const { m_impl->set_hostname(std::move(hostname)); }
 
+void Client::set_address(std::string address) const { m_impl->set_address(std::move(address)); }
+
 void Client::set_port(uint16_t port) const { m_impl->set_port(port); }
 
 void Client::set_timeout(int milliseconds) const { return m_impl->set_timeout(milliseconds); }
@@ -662,14 +827,80 @@ void Client::set_use_ssl(bool use_ssl) const { m_impl->set_use_ssl(use_ssl); }
 
 void Client::set_verify_certs(bool verify) const { return m_impl->set_verify_certs(verify); }
 
-bool Client::connect() const { return m_impl->connect(); }
+bool Client::connect() const
+{
+    std::error_code ec {};
+    const auto ret = m_impl->connect(ec);
+
+    if (ec) {
+        m_impl->throw_error(ec);
+    }
+    return ret;
+}
+
+bool Client::connect(std::error_code& ec) const { return m_impl->connect(ec); }
+
+size_t Client::send(std::string_view message) const
+{
+    std::error_code ec {};
+    const auto ret = m_impl->send(message, ec);
+
+    if (ec) {
+        m_impl->throw_error(ec);
+    }
+    return ret;
+}
 
-size_t Client::send(std::string_view message) const { return m_impl->send(message); }
+size_t Client::send(std::string_view message, std::error_code& ec) const { return m_impl->send(message, ec); }
 
-std::string Client::receive(size_t buf_size) const { return m_impl->receive(buf_size); }
+size_t Client::sendv(std::span<const std::string_view> bufs) const
+{
+    std::error_code ec {};
+    const auto ret = m_impl->sendv(bufs, ec);
+
+    if (ec) {
+        m_impl->throw_error(ec);
+    }
+    return ret;
+}
+
+size_t Client::sendv(std::span<const std::string_view> bufs, std::error_code& ec) const
+{
+    return m_impl->sendv(bufs, ec);
+}
+
+std::string Client::receive(size_t buf_size) const
+{
+    std::error_code ec {};
+    auto ret = m_impl->receive(buf_size, ec);
+
+    if (ec) {
+        m_impl->throw_error(ec);
+    }
+    return ret;
+}
+
+std::string Client::receive(size_t buf_size, std::error_code& ec) const { return m_impl->receive(buf_size, ec); }
+
+size_t Client::receive_into(std::span<char> buf) const
+{
+    std::error_code ec {};
+    const auto ret = m_impl->receive_into(buf, ec);
+
+    if (ec) {
+        m_impl->throw_error(ec);
+    }
+    return ret;
+}
+
+size_t Client::receive_into(std::span<char> buf, std::error_code& ec) const { return m_impl->receive_into(buf, ec); }
+
+bool Client::zero_copy_receive() const { return m_impl->zero_copy_receive(); }
 
 bool Client::query(bool want_read, bool want_write) const { return m_impl->query(want_read, want_write); }
 
 void Client::close() const { return m_impl->close(); }
 
+void Client::throw_error(const std::error_code& ec) const { m_impl->throw_error(ec); }
+
 } // namespace ekisocket::ssl
@@ -0,0 +1,215 @@
+#include <TimerWheel.hpp>
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <utility>
+
+namespace ekisocket {
+TimerWheel::~TimerWheel()
+{
+    // Timers outliving the wheel must not try to cancel themselves from it.
+    const auto forget = [](Timer* timer) {
+        while (timer != nullptr) {
+            timer->m_wheel = nullptr;
+            timer = std::exchange(timer->m_next, nullptr);
+        }
+    };
+
+    for (auto& level : m_slots) {
+        std::ranges::for_each(level, forget);
+    }
+    forget(m_expired);
+}
+
+void TimerWheel::schedule(Timer& timer, Clock::time_point deadline)
+{
+    if (timer.m_wheel != nullptr) {
+        timer.m_wheel->cancel(timer);
+    }
+
+    timer.m_deadline = deadline;
+    timer.m_expiry = (std::max)(tick_of(deadline), m_now);
+    timer.m_wheel = this;
+    ++m_size;
+    place(timer);
+}
+
+void TimerWheel::cancel(Timer& timer)
+{
+    if (timer.m_wheel != this) {
+        return;
+    }
+
+    unlink(timer);
+    timer.m_wheel = nullptr;
+    --m_size;
+}
+
+size_t TimerWheel::advance(Clock::time_point now)
+{
+    if (now < m_start) {
+        return 0;
+    }
+
+    // Unlike deadlines, the current time is rounded down: a tick is processed once it has entirely passed.
+    const auto target = static_cast<uint64_t>((now - m_start) / TICK);
+    size_t fired {};
+
+    while (m_now <= target) {
+        if (m_size == 0) {
+            m_now = target + 1;
+            break;
+        }
+
+        const auto slot = m_now & (LEVEL_SIZE - 1);
+
+        if (slot == 0) {
+            cascade(1);
+        }
+
+        // The timers of the tick move to the expired list, so that the callbacks can cancel them like any other.
+        for (auto* timer = std::exchange(m_slots[0][slot], nullptr); timer != nullptr;) {
+            auto* next = timer->m_next;
+
+            link(*timer, &m_expired);
+            timer->m_level = EXPIRED_LEVEL;
+            timer = next;
+        }
+        m_occupied[0] &= ~(uint64_t { 1 } << slot);
+
+        // Timers scheduled by the callbacks for deadlines that have already passed fire on the next tick.
+        ++m_now;
+        while (m_expired != nullptr) {
+            auto& timer = *m_expired;
+
+            cancel(timer);
+            ++fired;
+            if (timer.m_callback) {
+                timer.m_callback();
+            }
+        }
+
+        // Skip ahead to the next tick with timers in it, or the next one timers are cascaded at.
+        const auto index = m_now & (LEVEL_SIZE - 1);
+        auto next = (m_now | (LEVEL_SIZE - 1)) + 1;
+
+        if (index == 0) {
+            next = m_now;
+        } else if (const auto later = m_occupied[0] & (~uint64_t {} << index); later != 0) {
+            next = m_now - index + static_cast<uint64_t>(std::countr_zero(later));
+        }
+        m_now = (std::min)(next, target + 1);
+    }
+    return fired;
+}
+
+std::optional<TimerWheel::Clock::time_point> TimerWheel::next_expiry() const
+{
+    if (m_size == 0) {
+        return std::nullopt;
+    }
+
+    auto earliest = (std::numeric_limits<uint64_t>::max)();
+
+    for (size_t level {}; level < LEVELS; ++level) {
+        if (m_occupied[level] == 0) {
+            continue;
+        }
+
+        const auto shift = LEVEL_BITS * level;
+        const auto bucket = m_now >> shift;
+        const auto index = static_cast<int>(bucket & (LEVEL_SIZE - 1));
+        // How many slots after the current one the first occupied one is.
+        const auto offset = static_cast<uint64_t>(std::countr_zero(std::rotr(m_occupied[level], index)));
+        auto tick = (bucket + offset) << shift;
+
+        // The current slot of an upper level has already been cascaded, unless the current tick is its first.
+        if (level > 0 && offset == 0 && tick != m_now) {
+            tick = (bucket + LEVEL_SIZE) << shift;
+        }
+        earliest = (std::min)(earliest, (std::max)(tick, m_now));
+    }
+    return m_start + earliest * TICK;
+}
+
+void TimerWheel::place(Timer& timer)
+{
+    const auto delta = timer.m_expiry - (std::min)(timer.m_expiry, m_now);
+    size_t level {};
+
+    while (level + 1 < LEVELS && delta >= (uint64_t { 1 } << (LEVEL_BITS * (level + 1)))) {
+        ++level;
+    }
+
+    // Deadlines beyond the last level alias to a slot that comes up earlier, and are simply cascaded again.
+    const auto slot = (timer.m_expiry >> (LEVEL_BITS * level)) & (LEVEL_SIZE - 1);
+
+    link(timer, &m_slots[level][slot]);
+    timer.m_level = static_cast<uint8_t>(level);
+    timer.m_slot = static_cast<uint8_t>(slot);
+    m_occupied[level] |= uint64_t { 1 } << slot;
+}
+
+void TimerWheel::link(Timer& timer, Timer** list)
+{
+    timer.m_list = list;
+    timer.m_prev = nullptr;
+    timer.m_next = *list;
+    if (*list != nullptr) {
+        (*list)->m_prev = &timer;
+    }
+    *list = &timer;
+}
+
+void TimerWheel::unlink(Timer& timer)
+{
+    if (timer.m_prev != nullptr) {
+        timer.m_prev->m_next = timer.m_next;
+    } else {
+        *timer.m_list = timer.m_next;
+    }
+    if (timer.m_next != nullptr) {
+        timer.m_next->m_prev = timer.m_prev;
+    }
+    if (*timer.m_list == nullptr && timer.m_level != EXPIRED_LEVEL) {
+        m_occupied[timer.m_level] &= ~(uint64_t { 1 } << timer.m_slot);
+    }
+
+    timer.m_list = nullptr;
+    timer.m_prev = nullptr;
+    timer.m_next = nullptr;
+}
+
+void TimerWheel::cascade(size_t level)
+{
+    if (level >= LEVELS) {
+        return;
+    }
+
+    const auto slot = (m_now >> (LEVEL_BITS * level)) & (LEVEL_SIZE - 1);
+
+    auto* timer = std::exchange(m_slots[level][slot], nullptr);
+
+    // The timers of the slot are placed again, in the level below unless their deadline is further than it covers.
+    m_occupied[level] &= ~(uint64_t { 1 } << slot);
+    while (timer != nullptr) {
+        auto* next = timer->m_next;
+
+        place(*timer);
+        timer = next;
+    }
+
+    // The level above wraps around at the same time.
+    if (slot == 0) {
+        cascade(level + 1);
+    }
+}
+
+uint64_t TimerWheel::tick_of(Clock::time_point time) const
+{
+    if (time <= m_start) {
+        return 0;
+    }
+    return static_cast<uint64_t>((time - m_start + TICK - Clock::duration { 1 }) / TICK);
+}
+} // namespace ekisocket
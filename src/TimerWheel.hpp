@@ -0,0 +1,156 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+namespace ekisocket {
+/**
+ * @brief A hierarchical timing wheel, for the deadlines of many connections driven by a single thread: heartbeats,
+ * handshake, close and idle timeouts. Scheduling and cancelling a timer are O(1), and so is firing it, give or take
+ * being moved down the levels of the wheel a few times as its deadline comes closer.
+ *
+ * Time is counted in ticks of TICK. The first level has a slot per tick for the next LEVEL_SIZE ticks, and every
+ * level after it a slot per LEVEL_SIZE slots of the one below it. A timer sits in the level matching how far away its
+ * deadline is, and is cascaded to the level below when the slot it sits in comes up. Timers never fire early, and at
+ * most a tick late. Not thread-safe, timers are meant to be scheduled and fired by the thread owning the wheel.
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds TICK { 1 };
+
+    /**
+     * @brief A timer, owned by whoever schedules it. It is cancelled when it is destroyed.
+     */
+    class Timer {
+    public:
+        explicit Timer(std::function<void()> callback = {})
+            : m_callback { std::move(callback) }
+        {
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        Timer(Timer&&) = delete;
+        Timer& operator=(Timer&&) = delete;
+
+        ~Timer()
+        {
+            if (m_wheel != nullptr) {
+                m_wheel->cancel(*this);
+            }
+        }
+
+        /**
+         * @brief Sets the function called when the timer fires. Must not be called while the timer is scheduled.
+         */
+        void set_callback(std::function<void()> callback) { m_callback = std::move(callback); }
+
+        [[nodiscard]] bool scheduled() const { return m_wheel != nullptr; }
+
+        /**
+         * @brief When the timer fires, if it is scheduled.
+         */
+        [[nodiscard]] Clock::time_point deadline() const { return m_deadline; }
+
+    private:
+        friend class TimerWheel;
+
+        std::function<void()> m_callback {};
+        Clock::time_point m_deadline {};
+        /// The tick the timer fires at.
+        uint64_t m_expiry {};
+        /// The wheel the timer is scheduled in, if it is.
+        TimerWheel* m_wheel {};
+        /// The list the timer is in, and its neighbours in it.
+        Timer** m_list {};
+        Timer* m_prev {};
+        Timer* m_next {};
+        uint8_t m_level {};
+        uint8_t m_slot {};
+    };
+
+    TimerWheel() = default;
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+    TimerWheel(TimerWheel&&) = delete;
+    TimerWheel& operator=(TimerWheel&&) = delete;
+    ~TimerWheel();
+
+    /**
+     * @brief Schedules a timer, or moves it if it is already scheduled.
+     *
+     * @param timer The timer, which has to outlive its schedule.
+     * @param deadline When to fire it. Deadlines in the past fire on the next call to advance().
+     */
+    void schedule(Timer& timer, Clock::time_point deadline);
+
+    /**
+     * @brief Cancels a timer, if it is scheduled.
+     */
+    void cancel(Timer& timer);
+
+    /**
+     * @brief Fires every timer whose deadline has passed. The callbacks may schedule and cancel timers, including the
+     * ones being fired.
+     *
+     * @param now The current time.
+     * @return size_t The number of timers fired.
+     */
+    size_t advance(Clock::time_point now = Clock::now());
+
+    /**
+     * @brief When advance() should be called next. It may be before the earliest deadline, when timers have to be
+     * cascaded, but never after it.
+     *
+     * @return std::optional The time, or std::nullopt if no timer is scheduled.
+     */
+    [[nodiscard]] std::optional<Clock::time_point> next_expiry() const;
+
+    /**
+     * @brief The number of scheduled timers.
+     */
+    [[nodiscard]] size_t size() const { return m_size; }
+
+private:
+    static constexpr size_t LEVEL_BITS { 6 };
+    static constexpr size_t LEVEL_SIZE { size_t { 1 } << LEVEL_BITS };
+    /// With 1ms ticks, the last level covers over two years. Deadlines further out are cascaded from it repeatedly.
+    static constexpr size_t LEVELS { 6 };
+    /// The level of the list of timers being fired.
+    static constexpr uint8_t EXPIRED_LEVEL { LEVELS };
+
+    /**
+     * @brief Puts a timer in the slot matching how far away its expiry is.
+     */
+    void place(Timer& timer);
+
+    void link(Timer& timer, Timer** list);
+
+    void unlink(Timer& timer);
+
+    /**
+     * @brief Moves the timers of a slot down the wheel, as the current tick reaches the start of the slot.
+     */
+    void cascade(size_t level);
+
+    /**
+     * @brief The tick a time point falls in, rounded up so that timers never fire early.
+     */
+    [[nodiscard]] uint64_t tick_of(Clock::time_point time) const;
+
+    std::array<std::array<Timer*, LEVEL_SIZE>, LEVELS> m_slots {};
+    /// Which slots of each level have timers in them.
+    std::array<uint64_t, LEVELS> m_occupied {};
+    /// The timers being fired by advance().
+    Timer* m_expired {};
+    /// What tick 0 is.
+    Clock::time_point m_start { Clock::now() };
+    /// The next tick to process, every tick before it has been.
+    uint64_t m_now {};
+    size_t m_size {};
+};
+} // namespace ekisocket
@@ -0,0 +1,60 @@
+#include <TokenBucket.hpp>
+#include <algorithm>
+
+namespace {
+/// By default, up to 100 clients reconnect at once, then 100 per second.
+constexpr double DEFAULT_RECONNECT_RATE { 100 };
+constexpr size_t DEFAULT_RECONNECT_BURST { 100 };
+} // namespace
+
+namespace ekisocket {
+TokenBucket::TokenBucket(double rate, size_t burst)
+{
+    configure(rate, burst);
+}
+
+TokenBucket& TokenBucket::reconnects()
+{
+    static TokenBucket bucket { DEFAULT_RECONNECT_RATE, DEFAULT_RECONNECT_BURST };
+    return bucket;
+}
+
+void TokenBucket::configure(double rate, size_t burst)
+{
+    std::scoped_lock lk { m_mtx };
+    m_rate = (std::max)(rate, 0.0);
+    // A bucket that cannot hold a whole token would never hand one out.
+    m_burst = (std::max)(static_cast<double>(burst), 1.0);
+    m_tokens = m_burst;
+    m_refilled = Clock::now();
+}
+
+TokenBucket::Clock::duration TokenBucket::try_acquire(Clock::time_point now)
+{
+    std::scoped_lock lk { m_mtx };
+
+    if (m_rate == 0) {
+        return {};
+    }
+
+    refill(now);
+    if (m_tokens >= 1) {
+        m_tokens -= 1;
+        return {};
+    }
+
+    const std::chrono::duration<double> missing { (1 - m_tokens) / m_rate };
+    return (std::max)(std::chrono::ceil<Clock::duration>(missing), Clock::duration { 1 });
+}
+
+void TokenBucket::refill(Clock::time_point now)
+{
+    if (now <= m_refilled) {
+        return;
+    }
+
+    const std::chrono::duration<double> elapsed { now - m_refilled };
+    m_tokens = (std::min)(m_burst, m_tokens + elapsed.count() * m_rate);
+    m_refilled = now;
+}
+} // namespace ekisocket
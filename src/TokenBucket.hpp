@@ -0,0 +1,52 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+namespace ekisocket {
+/**
+ * @brief A token bucket, refilled at a steady rate and holding at most a burst of tokens, to limit how often something
+ * happens across threads. A full bucket lets a burst through at once, after which tokens are handed out as they are
+ * refilled.
+ */
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param rate How many tokens are added per second, 0 for an unlimited supply.
+     * @param burst How many tokens the bucket holds at most, which it starts with.
+     */
+    TokenBucket(double rate, size_t burst);
+
+    /**
+     * @brief The bucket shared by the reconnections of every client of the process.
+     */
+    [[nodiscard]] static TokenBucket& reconnects();
+
+    /**
+     * @brief Changes the rate and the size of the bucket, which is refilled.
+     */
+    void configure(double rate, size_t burst);
+
+    /**
+     * @brief Takes a token if there is one.
+     *
+     * @param now The current time.
+     * @return Clock::duration 0 if a token was taken, otherwise how long until there is one to take.
+     */
+    [[nodiscard]] Clock::duration try_acquire(Clock::time_point now = Clock::now());
+
+private:
+    /**
+     * @brief Adds the tokens earned since the last refill.
+     */
+    void refill(Clock::time_point now);
+
+    std::mutex m_mtx {};
+    double m_rate {};
+    double m_burst {};
+    double m_tokens {};
+    Clock::time_point m_refilled { Clock::now() };
+};
+} // namespace ekisocket
@@ -0,0 +1,559 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <ekisocket/Socket.hpp>
+#include <ekisocket/Transport.hpp>
+#include <mutex>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS { MSG_NOSIGNAL };
+#else
+constexpr int SEND_FLAGS {};
+#endif
+/// The maximum number of buffers handed to a single sendmsg().
+constexpr size_t MAX_IOVECS { 64 };
+/// How many consumed bytes a memory channel keeps around before compacting its buffer.
+constexpr size_t COMPACT_THRESHOLD { 65536 };
+
+bool would_block()
+{
+#ifdef _WIN32
+    return socketerrno == WSAEWOULDBLOCK;
+#elif EAGAIN == EWOULDBLOCK
+    return socketerrno == EAGAIN || socketerrno == EINTR;
+#else
+    return socketerrno == EAGAIN || socketerrno == EWOULDBLOCK || socketerrno == EINTR;
+#endif
+}
+
+/**
+ * @brief The data flowing towards one end of a memory pipe.
+ */
+struct Channel {
+    std::mutex mtx {};
+    std::condition_variable cv {};
+    std::string data {};
+    /// How much of the data has already been received.
+    size_t offset {};
+    /// Whether or not either end closed the pipe.
+    bool closed {};
+};
+
+struct MemoryPipe {
+    std::array<Channel, 2> channels {};
+};
+} // namespace
+
+namespace ekisocket {
+struct SocketTransport::Impl : ssl::Client {
+    Impl(std::string_view hostname, uint16_t port, bool use_tls)
+        : ssl::Client(hostname, port, use_tls)
+    {
+    }
+
+    using ssl::Client::throw_error;
+};
+
+SocketTransport::SocketTransport(std::string_view hostname, uint16_t port, bool use_tls)
+    : m_impl { std::make_unique<SocketTransport::Impl>(hostname, port, use_tls) }
+{
+}
+
+SocketTransport::~SocketTransport() = default;
+
+ssl::Client& SocketTransport::client() const { return *m_impl; }
+
+bool SocketTransport::connected() const { return m_impl->connected(); }
+
+bool SocketTransport::connect(std::error_code& ec) { return m_impl->connect(ec); }
+
+size_t SocketTransport::send(std::string_view data, std::error_code& ec) { return m_impl->send(data, ec); }
+
+size_t SocketTransport::sendv(std::span<const std::string_view> bufs, std::error_code& ec)
+{
+    return m_impl->sendv(bufs, ec);
+}
+
+size_t SocketTransport::receive_into(std::span<char> buf, std::error_code& ec) { return m_impl->receive_into(buf, ec); }
+
+bool SocketTransport::wait(bool want_read, bool want_write) const { return m_impl->query(want_read, want_write); }
+
+void SocketTransport::set_timeout(int milliseconds) { m_impl->set_timeout(milliseconds); }
+
+int SocketTransport::timeout() const { return m_impl->timeout(); }
+
+void SocketTransport::close() { m_impl->close(); }
+
+socket_t SocketTransport::native_handle() const { return m_impl->socket(); }
+
+bool SocketTransport::zero_copy_receive() const { return m_impl->zero_copy_receive(); }
+
+void SocketTransport::throw_error(const std::error_code& ec) const { m_impl->throw_error(ec); }
+
+struct UnixTransport::Impl {
+    explicit Impl(std::string path)
+        : m_path { std::move(path) }
+    {
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+    Impl(Impl&&) = delete;
+    Impl& operator=(Impl&&) = delete;
+
+    ~Impl() { close(); }
+
+    [[nodiscard]] bool connected() const { return m_connected.load(); }
+
+    bool connect(std::error_code& ec)
+    {
+        ec.clear();
+        if (m_connected.load()) {
+            return false;
+        }
+#ifdef _WIN32
+        ec = std::make_error_code(std::errc::operation_not_supported);
+        return false;
+#else
+        sockaddr_un addr {};
+        addr.sun_family = AF_UNIX;
+
+        if (m_path.empty() || m_path.size() >= sizeof(addr.sun_path)) {
+            ec = std::make_error_code(std::errc::filename_too_long);
+            return false;
+        }
+        std::ranges::copy(m_path, std::begin(addr.sun_path));
+
+        const auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (fd == -1) {
+            ec.assign(errno, std::system_category());
+            return false;
+        }
+        // Connecting to a local socket does not block, so the socket is only made non-blocking afterwards.
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ec.assign(errno, std::system_category());
+            (void)::close(fd);
+            return false;
+        }
+        (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+        (void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        m_fd.store(fd);
+        m_connected.store(true);
+        return true;
+#endif
+    }
+
+    size_t send(std::string_view data, std::error_code& ec)
+    {
+        ec.clear();
+        if (!m_connected.load()) {
+            ec = errors::Error::NOT_CONNECTED;
+            return 0;
+        }
+
+        // A closed peer is reported by send() itself, so the result of the wait does not matter.
+        (void)wait(false, true);
+#ifdef _WIN32
+        const auto len = ::send(m_fd.load(), data.data(), static_cast<int>(data.size()), SEND_FLAGS);
+#else
+        const auto len = ::send(m_fd.load(), data.data(), data.size(), SEND_FLAGS);
+#endif
+        return finish(len, ec);
+    }
+
+    size_t sendv(std::span<const std::string_view> bufs, std::error_code& ec)
+    {
+#ifdef _WIN32
+        size_t total {};
+
+        for (const auto buf : bufs) {
+            const auto sent = send(buf, ec);
+
+            total += sent;
+            if (ec || sent < buf.size()) {
+                break;
+            }
+        }
+        return total;
+#else
+        ec.clear();
+        if (!m_connected.load()) {
+            ec = errors::Error::NOT_CONNECTED;
+            return 0;
+        }
+
+        std::array<iovec, MAX_IOVECS> iov {};
+        const auto count = (std::min)(bufs.size(), iov.size());
+
+        for (size_t i {}; i < count; ++i) {
+            iov[i] = iovec { const_cast<char*>(bufs[i].data()), bufs[i].size() };
+        }
+
+        msghdr msg {};
+        msg.msg_iov = iov.data();
+#ifdef __APPLE__
+        msg.msg_iovlen = static_cast<int>(count);
+#else
+        msg.msg_iovlen = count;
+#endif
+        (void)wait(false, true);
+        return finish(::sendmsg(m_fd.load(), &msg, SEND_FLAGS), ec);
+#endif
+    }
+
+    size_t receive_into(std::span<char> buf, std::error_code& ec)
+    {
+        ec.clear();
+        if (!m_connected.load()) {
+            ec = errors::Error::NOT_CONNECTED;
+            return 0;
+        }
+
+        // The end of the stream is reported by recv() itself, so the result of the wait does not matter.
+        (void)wait(true, false);
+
+        // Receives of 0 bytes peek at the socket instead, to discover whether the peer is gone.
+        char peek {};
+        const auto discovery = buf.empty();
+        const auto data = discovery ? std::span { &peek, 1 } : buf;
+#ifdef _WIN32
+        const auto len = ::recv(m_fd.load(), data.data(), static_cast<int>(data.size()), discovery ? MSG_PEEK : 0);
+#else
+        const auto len = ::recv(m_fd.load(), data.data(), data.size(), discovery ? MSG_PEEK : 0);
+#endif
+        if (len == 0) {
+            m_connected.store(false);
+            return 0;
+        }
+
+        const auto received = finish(len, ec);
+        return discovery ? 0 : received;
+    }
+
+    [[nodiscard]] bool wait(bool want_read, bool want_write) const
+    {
+        const auto fd = m_fd.load();
+
+        if (fd == INVALID_SOCKET) {
+            return false;
+        }
+
+        pollfd pfd { .fd = fd, .events = 0, .revents = 0 };
+
+        if (want_read) {
+            pfd.events |= POLLIN;
+        }
+        if (want_write) {
+            pfd.events |= POLLOUT;
+        }
+        if (::poll(&pfd, 1, m_timeout.load()) <= 0) {
+            return false;
+        }
+
+        return (want_read == static_cast<bool>(pfd.revents & POLLIN))
+            && (want_write == static_cast<bool>(pfd.revents & POLLOUT))
+            && !static_cast<bool>(pfd.revents & (POLLNVAL | POLLERR | POLLHUP));
+    }
+
+    void set_timeout(int milliseconds) { m_timeout.store(milliseconds); }
+
+    [[nodiscard]] int timeout() const { return m_timeout.load(); }
+
+    void close()
+    {
+        const auto fd = m_fd.exchange(INVALID_SOCKET);
+
+        m_connected.store(false);
+        if (fd == INVALID_SOCKET) {
+            return;
+        }
+#ifdef _WIN32
+        shutdown(fd, SD_SEND);
+        closesocket(fd);
+#else
+        shutdown(fd, SHUT_WR);
+        (void)::close(fd);
+#endif
+    }
+
+    [[nodiscard]] socket_t native_handle() const { return m_fd.load(); }
+
+private:
+    /**
+     * @brief Turns the result of a send or receive into the number of bytes transferred, recording hard errors.
+     */
+    template <typename T> size_t finish(T len, std::error_code& ec)
+    {
+        if (len >= 0) {
+            return static_cast<size_t>(len);
+        }
+        if (!would_block()) {
+            m_connected.store(false);
+            ec.assign(socketerrno, std::system_category());
+        }
+        return 0;
+    }
+
+    /// The path of the socket.
+    std::string m_path {};
+    /// The connected socket.
+    std::atomic<socket_t> m_fd { INVALID_SOCKET };
+    /// Whether or not the socket is connected.
+    std::atomic_bool m_connected {};
+    /// How long to wait for the socket to become ready, -1 meaning forever.
+    std::atomic_int m_timeout { -1 };
+};
+
+UnixTransport::UnixTransport(std::string path)
+    : m_impl { std::make_unique<UnixTransport::Impl>(std::move(path)) }
+{
+}
+
+UnixTransport::~UnixTransport() = default;
+
+bool UnixTransport::connected() const { return m_impl->connected(); }
+
+bool UnixTransport::connect(std::error_code& ec) { return m_impl->connect(ec); }
+
+size_t UnixTransport::send(std::string_view data, std::error_code& ec) { return m_impl->send(data, ec); }
+
+size_t UnixTransport::sendv(std::span<const std::string_view> bufs, std::error_code& ec)
+{
+    return m_impl->sendv(bufs, ec);
+}
+
+size_t UnixTransport::receive_into(std::span<char> buf, std::error_code& ec) { return m_impl->receive_into(buf, ec); }
+
+bool UnixTransport::wait(bool want_read, bool want_write) const { return m_impl->wait(want_read, want_write); }
+
+void UnixTransport::set_timeout(int milliseconds) { m_impl->set_timeout(milliseconds); }
+
+int UnixTransport::timeout() const { return m_impl->timeout(); }
+
+void UnixTransport::close() { m_impl->close(); }
+
+socket_t UnixTransport::native_handle() const { return m_impl->native_handle(); }
+
+bool UnixTransport::zero_copy_receive() const { return m_impl->connected(); }
+
+struct MemoryTransport::Impl {
+    Impl(std::shared_ptr<MemoryPipe> pipe, size_t side)
+        : m_pipe { std::move(pipe) }
+        , m_side { side }
+    {
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+    Impl(Impl&&) = delete;
+    Impl& operator=(Impl&&) = delete;
+
+    ~Impl() { close(); }
+
+    [[nodiscard]] bool connected() const { return m_connected.load(); }
+
+    bool connect(std::error_code& ec)
+    {
+        ec.clear();
+        if (m_connected.load()) {
+            return false;
+        }
+
+        std::scoped_lock lk { inbound().mtx, outbound().mtx };
+
+        // A closed pipe cannot be reopened.
+        if (inbound().closed || outbound().closed) {
+            ec = errors::Error::CONNECT_FAILED;
+            return false;
+        }
+        m_connected.store(true);
+        return true;
+    }
+
+    size_t sendv(std::span<const std::string_view> bufs, std::error_code& ec)
+    {
+        ec.clear();
+        if (!m_connected.load()) {
+            ec = errors::Error::NOT_CONNECTED;
+            return 0;
+        }
+
+        auto& channel = outbound();
+        size_t total {};
+        {
+            std::scoped_lock lk { channel.mtx };
+
+            if (channel.closed) {
+                m_connected.store(false);
+                ec = errors::Error::CONNECTION_CLOSED;
+                return 0;
+            }
+            for (const auto buf : bufs) {
+                channel.data += buf;
+                total += buf.size();
+            }
+        }
+        channel.cv.notify_all();
+        return total;
+    }
+
+    size_t receive_into(std::span<char> buf, std::error_code& ec)
+    {
+        ec.clear();
+        if (!m_connected.load()) {
+            ec = errors::Error::NOT_CONNECTED;
+            return 0;
+        }
+
+        auto& channel = inbound();
+        std::unique_lock lk { channel.mtx };
+
+        wait_readable(lk);
+
+        const auto available = channel.data.size() - channel.offset;
+
+        if (available == 0) {
+            if (channel.closed) {
+                m_connected.store(false);
+            }
+            return 0;
+        }
+
+        const auto len = (std::min)(available, buf.size());
+
+        std::copy_n(channel.data.begin() + static_cast<std::ptrdiff_t>(channel.offset), len, buf.begin());
+        channel.offset += len;
+
+        if (channel.offset == channel.data.size()) {
+            channel.data.clear();
+            channel.offset = 0;
+        } else if (channel.offset > COMPACT_THRESHOLD && channel.offset > channel.data.size() / 2) {
+            channel.data.erase(0, channel.offset);
+            channel.offset = 0;
+        }
+        return len;
+    }
+
+    [[nodiscard]] bool wait(bool want_read, bool want_write) const
+    {
+        if (!m_connected.load()) {
+            return false;
+        }
+        if (want_write) {
+            std::scoped_lock lk { outbound().mtx };
+
+            if (outbound().closed) {
+                return false;
+            }
+        }
+        if (want_read) {
+            std::unique_lock lk { inbound().mtx };
+
+            wait_readable(lk);
+            return inbound().offset < inbound().data.size() || inbound().closed;
+        }
+        return true;
+    }
+
+    void set_timeout(int milliseconds) { m_timeout.store(milliseconds); }
+
+    [[nodiscard]] int timeout() const { return m_timeout.load(); }
+
+    void close()
+    {
+        m_connected.store(false);
+
+        // Closing both directions makes the peer see the end of the stream, and fail any further sends.
+        for (auto& channel : m_pipe->channels) {
+            {
+                std::scoped_lock lk { channel.mtx };
+                channel.closed = true;
+            }
+            channel.cv.notify_all();
+        }
+    }
+
+private:
+    [[nodiscard]] Channel& inbound() const { return m_pipe->channels.at(m_side); }
+    [[nodiscard]] Channel& outbound() const { return m_pipe->channels.at(1 - m_side); }
+
+    /**
+     * @brief Waits, for at most the timeout, until the inbound channel has data or is closed.
+     */
+    void wait_readable(std::unique_lock<std::mutex>& lk) const
+    {
+        auto& channel = inbound();
+        const auto ready = [&channel] { return channel.offset < channel.data.size() || channel.closed; };
+
+        if (const auto timeout = m_timeout.load(); timeout < 0) {
+            channel.cv.wait(lk, ready);
+        } else {
+            channel.cv.wait_for(lk, std::chrono::milliseconds { timeout }, ready);
+        }
+    }
+
+    /// The pipe shared by both ends.
+    std::shared_ptr<MemoryPipe> m_pipe {};
+    /// The index of the channel this end receives from.
+    size_t m_side {};
+    /// Whether or not this end is connected.
+    std::atomic_bool m_connected {};
+    /// How long to wait for data, -1 meaning forever.
+    std::atomic_int m_timeout { -1 };
+};
+
+MemoryTransport::MemoryTransport(std::unique_ptr<Impl> impl)
+    : m_impl { std::move(impl) }
+{
+}
+
+std::pair<std::unique_ptr<MemoryTransport>, std::unique_ptr<MemoryTransport>> MemoryTransport::pair()
+{
+    auto pipe = std::make_shared<MemoryPipe>();
+
+    // The constructor is private, so std::make_unique cannot be used.
+    return { std::unique_ptr<MemoryTransport>(new MemoryTransport(std::make_unique<Impl>(pipe, 0))),
+        std::unique_ptr<MemoryTransport>(new MemoryTransport(std::make_unique<Impl>(pipe, 1))) };
+}
+
+MemoryTransport::~MemoryTransport() = default;
+
+bool MemoryTransport::connected() const { return m_impl->connected(); }
+
+bool MemoryTransport::connect(std::error_code& ec) { return m_impl->connect(ec); }
+
+size_t MemoryTransport::send(std::string_view data, std::error_code& ec)
+{
+    return m_impl->sendv(std::span { &data, 1 }, ec);
+}
+
+size_t MemoryTransport::sendv(std::span<const std::string_view> bufs, std::error_code& ec)
+{
+    return m_impl->sendv(bufs, ec);
+}
+
+size_t MemoryTransport::receive_into(std::span<char> buf, std::error_code& ec)
+{
+    return m_impl->receive_into(buf, ec);
+}
+
+bool MemoryTransport::wait(bool want_read, bool want_write) const { return m_impl->wait(want_read, want_write); }
+
+void MemoryTransport::set_timeout(int milliseconds) { m_impl->set_timeout(milliseconds); }
+
+int MemoryTransport::timeout() const { return m_impl->timeout(); }
+
+void MemoryTransport::close() { m_impl->close(); }
+} // namespace ekisocket
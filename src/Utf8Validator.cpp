@@ -0,0 +1,465 @@
+#include <Utf8Validator.hpp>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define EKISOCKET_UTF8_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define EKISOCKET_UTF8_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#define EKISOCKET_TARGET(isa)
+#else
+#define EKISOCKET_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace {
+using Utf8Kernel = bool (*)(const uint8_t*, size_t);
+
+/**
+ * @brief The length of a character from its first byte, or 0 if no character can start with it. 0xC0 and 0xC1 could
+ * only start overlong encodings, and anything past 0xF4 a code point above U+10FFFF.
+ */
+constexpr size_t sequence_length(uint8_t lead)
+{
+    if (lead < 0x80) {
+        return 1;
+    }
+    if (lead < 0xC2) {
+        return 0;
+    }
+    if (lead < 0xE0) {
+        return 2;
+    }
+    if (lead < 0xF0) {
+        return 3;
+    }
+    return lead < 0xF5 ? 4 : 0;
+}
+
+/**
+ * @brief Checks the first n bytes of a character, whose first byte can start one and n being at most its length.
+ */
+constexpr bool valid_prefix(const uint8_t* p, size_t n)
+{
+    if (n < 2) {
+        return true;
+    }
+
+    // The second byte rules out overlong encodings, surrogates and code points above U+10FFFF.
+    uint8_t low { 0x80 };
+    uint8_t high { 0xBF };
+
+    switch (p[0]) {
+    case 0xE0:
+        low = 0xA0;
+        break;
+    case 0xED:
+        high = 0x9F;
+        break;
+    case 0xF0:
+        low = 0x90;
+        break;
+    case 0xF4:
+        high = 0x8F;
+        break;
+    default:
+        break;
+    }
+    if (p[1] < low || p[1] > high) {
+        return false;
+    }
+    return std::all_of(p + 2, p + n, [](uint8_t c) { return (c & 0xC0) == 0x80; });
+}
+
+/**
+ * @brief How many bytes at the end of data belong to a character cut off by the end of it.
+ */
+size_t incomplete_tail(const uint8_t* data, size_t len)
+{
+    for (size_t i { 1 }; i <= (std::min)(len, size_t { 3 }); ++i) {
+        const auto c = data[len - i];
+
+        if ((c & 0xC0) == 0x80) {
+            continue;
+        }
+        return c >= 0xC0 && sequence_length(c) > i ? i : 0;
+    }
+    return 0;
+}
+
+bool validate_scalar(const uint8_t* data, size_t len)
+{
+    size_t i {};
+
+    while (i < len) {
+        // Skip over ASCII a word at a time.
+        if (uint64_t word {}; i + sizeof(word) <= len) {
+            std::memcpy(&word, data + i, sizeof(word));
+            if ((word & 0x8080808080808080) == 0) {
+                i += sizeof(word);
+                continue;
+            }
+        }
+
+        const auto length = sequence_length(data[i]);
+        if (length == 0 || length > len - i || !valid_prefix(data + i, length)) {
+            return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+// The lookup tables of the SIMD kernels. Each one maps a nibble of the bytes to the errors they could be part of, and
+// a sequence is invalid where the errors of the high and low nibbles of a byte and the high nibble of the byte after it
+// have a bit in common.
+constexpr uint8_t TOO_SHORT { 1 << 0 };      // A leading byte or ASCII followed by a leading byte.
+constexpr uint8_t TOO_LONG { 1 << 1 };       // ASCII followed by a continuation byte.
+constexpr uint8_t OVERLONG_3 { 1 << 2 };     // A 3 byte character that would fit in 2.
+constexpr uint8_t TOO_LARGE { 1 << 3 };      // A code point above U+10FFFF.
+constexpr uint8_t SURROGATE { 1 << 4 };      // U+D800 to U+DFFF.
+constexpr uint8_t OVERLONG_2 { 1 << 5 };     // A 2 byte character that would fit in 1.
+constexpr uint8_t TOO_LARGE_1000 { 1 << 6 }; // F4 followed by 90 or above. Never applies with OVERLONG_4.
+constexpr uint8_t OVERLONG_4 { 1 << 6 };     // A 4 byte character that would fit in 3.
+constexpr uint8_t TWO_CONTS { 1 << 7 };      // Two continuation bytes, unless a leading byte comes before them.
+constexpr uint8_t CARRY { TOO_SHORT | TOO_LONG | TWO_CONTS };
+
+/// Errors by the high nibble of the first byte.
+alignas(16) constexpr std::array<uint8_t, 16> BYTE_1_HIGH {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, // 0xxx
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,                                     // 10xx
+    TOO_SHORT | OVERLONG_2,                                                         // 1100
+    TOO_SHORT,                                                                      // 1101
+    TOO_SHORT | OVERLONG_3 | SURROGATE,                                             // 1110
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,                            // 1111
+};
+
+/// Errors by the low nibble of the first byte.
+alignas(16) constexpr std::array<uint8_t, 16> BYTE_1_LOW {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,       // 0000
+    CARRY | OVERLONG_2,                                 // 0001
+    CARRY,                                              // 0010
+    CARRY,                                              // 0011
+    CARRY | TOO_LARGE,                                  // 0100
+    CARRY | TOO_LARGE | TOO_LARGE_1000,                 // 0101
+    CARRY | TOO_LARGE | TOO_LARGE_1000,                 // 0110
+    CARRY | TOO_LARGE | TOO_LARGE_1000,                 // 0111
+    CARRY | TOO_LARGE | TOO_LARGE_1000,                 // 1000
+    CARRY | TOO_LARGE | TOO_LARGE_1000,                 // 1001
+    CARRY | TOO_LARGE | TOO_LARGE_1000,                 // 1010
+    CARRY | TOO_LARGE | TOO_LARGE_1000,                 // 1011
+    CARRY | TOO_LARGE | TOO_LARGE_1000,                 // 1100
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,     // 1101
+    CARRY | TOO_LARGE | TOO_LARGE_1000,                 // 1110
+    CARRY | TOO_LARGE | TOO_LARGE_1000,                 // 1111
+};
+
+/// Errors by the high nibble of the second byte.
+alignas(16) constexpr std::array<uint8_t, 16> BYTE_2_HIGH {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, // 0xxx
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,           // 1000
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,                             // 1001
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,                              // 1010
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,                              // 1011
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,                                             // 11xx
+};
+
+/// A block ending in a byte above these leaves a character unfinished.
+alignas(32) constexpr std::array<uint8_t, 32> MAX_VALUE { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xF0 - 1, 0xE0 - 1, 0xC0 - 1 };
+
+/**
+ * @brief Copies the bytes past the last whole block into a block of its own, padded with zeros (ASCII).
+ */
+template <size_t BlockSize> std::array<uint8_t, BlockSize> last_block(const uint8_t* data, size_t len)
+{
+    std::array<uint8_t, BlockSize> block {};
+    std::memcpy(block.data(), data + (len - len % BlockSize), len % BlockSize);
+    return block;
+}
+
+#ifdef EKISOCKET_UTF8_X86
+struct Sse41State {
+    __m128i prev_input {};
+    __m128i prev_incomplete {};
+    __m128i error {};
+
+    EKISOCKET_TARGET("sse4.1") [[nodiscard]] bool valid() const
+    {
+        const auto errors = _mm_or_si128(error, prev_incomplete);
+        return _mm_testz_si128(errors, errors) != 0;
+    }
+};
+
+EKISOCKET_TARGET("sse4.1") __m128i lookup_sse41(const std::array<uint8_t, 16>& table, __m128i nibbles)
+{
+    return _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(table.data())), nibbles);
+}
+
+EKISOCKET_TARGET("sse4.1") void check_block_sse41(Sse41State& s, const uint8_t* data)
+{
+    const auto input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+
+    // An ASCII block is valid, as long as the one before it did not end in the middle of a character.
+    if (_mm_movemask_epi8(input) == 0) {
+        s.error = _mm_or_si128(s.error, s.prev_incomplete);
+        s.prev_input = input;
+        s.prev_incomplete = _mm_setzero_si128();
+        return;
+    }
+
+    const auto low_nibble = _mm_set1_epi8(0x0F);
+    const auto prev1 = _mm_alignr_epi8(input, s.prev_input, 15);
+    const auto special = _mm_and_si128(
+        _mm_and_si128(lookup_sse41(BYTE_1_HIGH, _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble)),
+            lookup_sse41(BYTE_1_LOW, _mm_and_si128(prev1, low_nibble))),
+        lookup_sse41(BYTE_2_HIGH, _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble)));
+
+    // The third and fourth bytes of 3 and 4 byte characters are the only continuation bytes allowed after another one.
+    const auto prev2 = _mm_alignr_epi8(input, s.prev_input, 14);
+    const auto prev3 = _mm_alignr_epi8(input, s.prev_input, 13);
+    const auto must_be_continuation = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80)),
+                                                        _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80))),
+        _mm_set1_epi8(static_cast<char>(0x80)));
+
+    s.error = _mm_or_si128(s.error, _mm_xor_si128(must_be_continuation, special));
+    s.prev_incomplete = _mm_subs_epu8(input, _mm_loadu_si128(reinterpret_cast<const __m128i*>(MAX_VALUE.data() + 16)));
+    s.prev_input = input;
+}
+
+EKISOCKET_TARGET("sse4.1") bool validate_sse41(const uint8_t* data, size_t len)
+{
+    Sse41State state {};
+    size_t i {};
+
+    for (; i + sizeof(__m128i) <= len; i += sizeof(__m128i)) {
+        check_block_sse41(state, data + i);
+    }
+    if (i < len) {
+        check_block_sse41(state, last_block<sizeof(__m128i)>(data, len).data());
+    }
+    return state.valid();
+}
+
+struct Avx2State {
+    __m256i prev_input {};
+    __m256i prev_incomplete {};
+    __m256i error {};
+
+    EKISOCKET_TARGET("avx2") [[nodiscard]] bool valid() const
+    {
+        const auto errors = _mm256_or_si256(error, prev_incomplete);
+        return _mm256_testz_si256(errors, errors) != 0;
+    }
+};
+
+EKISOCKET_TARGET("avx2") __m256i lookup_avx2(const std::array<uint8_t, 16>& table, __m256i nibbles)
+{
+    // The shuffle looks up each 128-bit lane in its own half of the table, so both halves are the same.
+    const auto half = _mm_load_si128(reinterpret_cast<const __m128i*>(table.data()));
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(half), nibbles);
+}
+
+/**
+ * @brief The input shifted by N bytes, the first N coming from the end of the previous block.
+ */
+template <int N> EKISOCKET_TARGET("avx2") __m256i prev_avx2(__m256i input, __m256i prev_input)
+{
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev_input, input, 0x21), 16 - N);
+}
+
+EKISOCKET_TARGET("avx2") void check_block_avx2(Avx2State& s, const uint8_t* data)
+{
+    const auto input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+
+    if (_mm256_movemask_epi8(input) == 0) {
+        s.error = _mm256_or_si256(s.error, s.prev_incomplete);
+        s.prev_input = input;
+        s.prev_incomplete = _mm256_setzero_si256();
+        return;
+    }
+
+    const auto low_nibble = _mm256_set1_epi8(0x0F);
+    const auto prev1 = prev_avx2<1>(input, s.prev_input);
+    const auto special = _mm256_and_si256(
+        _mm256_and_si256(lookup_avx2(BYTE_1_HIGH, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble)),
+            lookup_avx2(BYTE_1_LOW, _mm256_and_si256(prev1, low_nibble))),
+        lookup_avx2(BYTE_2_HIGH, _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble)));
+
+    const auto prev2 = prev_avx2<2>(input, s.prev_input);
+    const auto prev3 = prev_avx2<3>(input, s.prev_input);
+    const auto must_be_continuation
+        = _mm256_and_si256(_mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80)),
+                               _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80))),
+            _mm256_set1_epi8(static_cast<char>(0x80)));
+
+    s.error = _mm256_or_si256(s.error, _mm256_xor_si256(must_be_continuation, special));
+    s.prev_incomplete
+        = _mm256_subs_epu8(input, _mm256_load_si256(reinterpret_cast<const __m256i*>(MAX_VALUE.data())));
+    s.prev_input = input;
+}
+
+EKISOCKET_TARGET("avx2") bool validate_avx2(const uint8_t* data, size_t len)
+{
+    Avx2State state {};
+    size_t i {};
+
+    for (; i + sizeof(__m256i) <= len; i += sizeof(__m256i)) {
+        check_block_avx2(state, data + i);
+    }
+    if (i < len) {
+        check_block_avx2(state, last_block<sizeof(__m256i)>(data, len).data());
+    }
+    return state.valid();
+}
+
+/**
+ * @brief Picks the widest kernel the CPU and the OS support.
+ */
+Utf8Kernel select_utf8_kernel()
+{
+#ifdef _MSC_VER
+    std::array<int, 4> info {};
+    __cpuid(info.data(), 1);
+    const auto sse41 = (info[2] & (1 << 19)) != 0;
+    const auto os_avx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info.data(), 7, 0);
+    if (os_avx && (info[1] & (1 << 5)) != 0) {
+        return validate_avx2;
+    }
+    if (sse41) {
+        return validate_sse41;
+    }
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return validate_avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return validate_sse41;
+    }
+#endif
+    return validate_scalar;
+}
+#elif defined(EKISOCKET_UTF8_NEON)
+struct NeonState {
+    uint8x16_t prev_input {};
+    uint8x16_t prev_incomplete {};
+    uint8x16_t error {};
+
+    [[nodiscard]] bool valid() const { return vmaxvq_u8(vorrq_u8(error, prev_incomplete)) == 0; }
+};
+
+void check_block_neon(NeonState& s, const uint8_t* data)
+{
+    const auto input = vld1q_u8(data);
+
+    if (vmaxvq_u8(input) < 0x80) {
+        s.error = vorrq_u8(s.error, s.prev_incomplete);
+        s.prev_input = input;
+        s.prev_incomplete = vdupq_n_u8(0);
+        return;
+    }
+
+    const auto prev1 = vextq_u8(s.prev_input, input, 15);
+    const auto special = vandq_u8(vandq_u8(vqtbl1q_u8(vld1q_u8(BYTE_1_HIGH.data()), vshrq_n_u8(prev1, 4)),
+                                      vqtbl1q_u8(vld1q_u8(BYTE_1_LOW.data()), vandq_u8(prev1, vdupq_n_u8(0x0F)))),
+        vqtbl1q_u8(vld1q_u8(BYTE_2_HIGH.data()), vshrq_n_u8(input, 4)));
+
+    const auto prev2 = vextq_u8(s.prev_input, input, 14);
+    const auto prev3 = vextq_u8(s.prev_input, input, 13);
+    const auto must_be_continuation = vandq_u8(
+        vorrq_u8(vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80)), vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80))),
+        vdupq_n_u8(0x80));
+
+    s.error = vorrq_u8(s.error, veorq_u8(must_be_continuation, special));
+    s.prev_incomplete = vqsubq_u8(input, vld1q_u8(MAX_VALUE.data() + 16));
+    s.prev_input = input;
+}
+
+bool validate_neon(const uint8_t* data, size_t len)
+{
+    NeonState state { vdupq_n_u8(0), vdupq_n_u8(0), vdupq_n_u8(0) };
+    size_t i {};
+
+    for (; i + sizeof(uint8x16_t) <= len; i += sizeof(uint8x16_t)) {
+        check_block_neon(state, data + i);
+    }
+    if (i < len) {
+        check_block_neon(state, last_block<sizeof(uint8x16_t)>(data, len).data());
+    }
+    return state.valid();
+}
+
+Utf8Kernel select_utf8_kernel() { return validate_neon; }
+#else
+Utf8Kernel select_utf8_kernel() { return validate_scalar; }
+#endif
+
+/// Below this many bytes, the scalar loop is faster than setting up a kernel.
+constexpr size_t UTF8_KERNEL_THRESHOLD { 16 };
+
+bool validate_bytes(const uint8_t* data, size_t len)
+{
+    static const auto kernel = select_utf8_kernel();
+    return len < UTF8_KERNEL_THRESHOLD ? validate_scalar(data, len) : kernel(data, len);
+}
+} // namespace
+
+namespace ekisocket {
+bool Utf8Validator::feed(std::string_view data)
+{
+    if (!m_valid) {
+        return false;
+    }
+
+    const auto* p = reinterpret_cast<const uint8_t*>(data.data());
+    auto len = data.size();
+
+    // Finish the character the last piece ended in the middle of first.
+    if (m_pending_size > 0) {
+        const auto length = sequence_length(m_pending[0]);
+        const auto taken = (std::min)(length - m_pending_size, len);
+
+        std::copy_n(p, taken, m_pending.begin() + static_cast<std::ptrdiff_t>(m_pending_size));
+        m_pending_size += taken;
+        p += taken;
+        len -= taken;
+
+        if (!valid_prefix(m_pending.data(), m_pending_size)) {
+            m_valid = false;
+            return false;
+        }
+        if (m_pending_size < length) {
+            return true;
+        }
+        m_pending_size = 0;
+    }
+
+    // Then hold back the character this one ends in the middle of, if it does.
+    const auto tail = incomplete_tail(p, len);
+
+    if (!validate_bytes(p, len - tail)) {
+        m_valid = false;
+        return false;
+    }
+
+    std::copy_n(p + (len - tail), tail, m_pending.begin());
+    m_pending_size = tail;
+    m_valid = valid_prefix(m_pending.data(), m_pending_size);
+    return m_valid;
+}
+
+bool Utf8Validator::validate(std::string_view data)
+{
+    return validate_bytes(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+} // namespace ekisocket
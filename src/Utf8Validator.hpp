@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace ekisocket {
+/**
+ * @brief Validates UTF-8 text that arrives in pieces, such as the frames of a TEXT message. A character split between
+ * two pieces is held back until the rest of it arrives, and invalid text is reported as soon as it is seen rather than
+ * at the end of the message.
+ *
+ * Whole blocks are checked with the lookup tables of Keiser and Lemire ("Validating UTF-8 In Less Than One Instruction
+ * Per Byte"), using the widest SIMD instructions the CPU supports (SSE4.1 or AVX2 on x86, NEON on ARM), and blocks of
+ * ASCII are skipped altogether.
+ */
+class Utf8Validator {
+public:
+    /**
+     * @brief Validates the next piece of the text.
+     *
+     * @return bool Whether or not the text is valid so far. Once it is not, it never is again until reset().
+     */
+    bool feed(std::string_view data);
+
+    /**
+     * @brief Whether or not the text fed so far is valid and complete, i.e. does not end in the middle of a character.
+     */
+    [[nodiscard]] bool finish() const { return m_valid && m_pending_size == 0; }
+
+    /**
+     * @brief Starts over with a new text.
+     */
+    void reset()
+    {
+        m_pending_size = 0;
+        m_valid = true;
+    }
+
+    /**
+     * @brief Validates a whole text at once.
+     */
+    [[nodiscard]] static bool validate(std::string_view data);
+
+private:
+    /// The beginning of a character whose remaining bytes have not arrived yet.
+    std::array<uint8_t, 4> m_pending {};
+    size_t m_pending_size {};
+    bool m_valid { true };
+};
+} // namespace ekisocket
@@ -1,12 +1,37 @@
+#include <Handshake.hpp>
+#include <Random.hpp>
+#include <Utf8Validator.hpp>
 #include <algorithm>
 #include <array>
+#include <cstring>
 #include <ekisocket/Util.hpp>
 #include <fmt/format.h>
 #include <functional>
+#include <ekisocket/Socket.hpp>
+#include <openssl/bio.h>
+#include <openssl/crypto.h>
 #include <openssl/sha.h>
-#include <random>
+#include <thread>
 #include <unordered_map>
 
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define EKISOCKET_MASK_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define EKISOCKET_MASK_NEON
+#include <arm_neon.h>
+#endif
+
 namespace {
 // Static Constexpr Map of all the file extension to their content type.
 using namespace std::literals::string_view_literals;
@@ -386,6 +411,138 @@ std::string encode_triple(uint32_t triple, uint8_t num_of_bits)
 
     return result;
 }
+
+/* ----------------------------- Masking Kernels ---------------------------- */
+
+/**
+ * @brief The 4 bytes of a masking key in the order they apply to the payload, starting at the given phase, packed into
+ * an integer the way they are laid out in memory.
+ */
+uint32_t mask_pattern(uint32_t masking_key, size_t phase)
+{
+    std::array<char, 4> bytes {};
+
+    for (size_t i {}; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<char>(masking_key >> (24 - (((phase + i) % 4) * 8)));
+    }
+
+    uint32_t ret {};
+    std::memcpy(&ret, bytes.data(), sizeof(ret));
+    return ret;
+}
+
+/**
+ * @brief Masks as many whole blocks as fit into len, returning the number of bytes masked. Blocks are a multiple of 4
+ * bytes, so the pattern lines up again after each one.
+ */
+using MaskKernel = size_t (*)(const char* in, char* out, size_t len, uint32_t pattern);
+
+size_t mask_words(const char* in, char* out, size_t len, uint32_t pattern)
+{
+    const auto wide = static_cast<uint64_t>(pattern) | (static_cast<uint64_t>(pattern) << 32U);
+    size_t i {};
+
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word {};
+        std::memcpy(&word, in + i, sizeof(word));
+        word ^= wide;
+        std::memcpy(out + i, &word, sizeof(word));
+    }
+    return i;
+}
+
+#ifdef EKISOCKET_MASK_X86
+size_t mask_sse2(const char* in, char* out, size_t len, uint32_t pattern)
+{
+    const auto key = _mm_set1_epi32(static_cast<int>(pattern));
+    size_t i {};
+
+    for (; i + sizeof(__m128i) <= len; i += sizeof(__m128i)) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(block, key));
+    }
+    return i;
+}
+
+#ifndef _MSC_VER
+__attribute__((target("avx2")))
+#endif
+size_t mask_avx2(const char* in, char* out, size_t len, uint32_t pattern)
+{
+    const auto key = _mm256_set1_epi32(static_cast<int>(pattern));
+    size_t i {};
+
+    for (; i + sizeof(__m256i) <= len; i += sizeof(__m256i)) {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_xor_si256(block, key));
+    }
+    return i;
+}
+
+#ifndef _MSC_VER
+__attribute__((target("avx512f")))
+#endif
+size_t mask_avx512(const char* in, char* out, size_t len, uint32_t pattern)
+{
+    const auto key = _mm512_set1_epi32(static_cast<int>(pattern));
+    size_t i {};
+
+    for (; i + sizeof(__m512i) <= len; i += sizeof(__m512i)) {
+        const auto block = _mm512_loadu_si512(in + i);
+        _mm512_storeu_si512(out + i, _mm512_xor_si512(block, key));
+    }
+    return i;
+}
+
+/**
+ * @brief Picks the widest kernel the CPU and the OS support.
+ */
+MaskKernel select_mask_kernel()
+{
+#ifdef _MSC_VER
+    std::array<int, 4> info {};
+    __cpuid(info.data(), 1);
+    // AVX state has to be enabled by the OS, on top of the CPU supporting it.
+    const auto os_avx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    const auto os_avx512 = os_avx && (_xgetbv(0) & 0xE6) == 0xE6;
+    __cpuidex(info.data(), 7, 0);
+    if (os_avx512 && (info[1] & (1 << 16)) != 0) {
+        return mask_avx512;
+    }
+    if (os_avx && (info[1] & (1 << 5)) != 0) {
+        return mask_avx2;
+    }
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return mask_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return mask_avx2;
+    }
+#endif
+    return mask_sse2;
+}
+#elif defined(EKISOCKET_MASK_NEON)
+size_t mask_neon(const char* in, char* out, size_t len, uint32_t pattern)
+{
+    const auto key = vreinterpretq_u8_u32(vdupq_n_u32(pattern));
+    size_t i {};
+
+    for (; i + sizeof(uint8x16_t) <= len; i += sizeof(uint8x16_t)) {
+        const auto block = vld1q_u8(reinterpret_cast<const uint8_t*>(in + i));
+        vst1q_u8(reinterpret_cast<uint8_t*>(out + i), veorq_u8(block, key));
+    }
+    return i;
+}
+
+MaskKernel select_mask_kernel() { return mask_neon; }
+#else
+MaskKernel select_mask_kernel() { return mask_words; }
+#endif
+
+/// Below this many bytes, aligning the output and calling the kernel costs more than it saves.
+constexpr size_t MASK_KERNEL_THRESHOLD { 64 };
 } // namespace
 
 namespace ekisocket::util {
@@ -447,19 +604,42 @@ std::string base64_encode(std::string_view input)
 
 std::string compute_accept(const std::string& key)
 {
-    // The WebSocket key is computed as follows:
-    // 1.  Append the string "258EAFA5-E914-47DA-95CA-C5AB0DC85B11" to the end of the new header field value.
-    // 2.  Compute the SHA1 hash of this modified header field value.
-    // 3.  Base64 encode the SHA1 hash and replace the original header field value with this value.
-    // The computed_accept value is used as the Sec-WebSocket-Accept header field value in the handshake response.
-
-    // 1.
-    const auto key_with_suffix = fmt::format("{}258EAFA5-E914-47DA-95CA-C5AB0DC85B11", key);
-    // 2.
-    std::array<uint8_t, SHA_DIGEST_LENGTH> hash {};
-    SHA1(reinterpret_cast<const uint8_t*>(key_with_suffix.data()), key_with_suffix.length(), hash.data());
-    // 3.
-    return base64_encode(hash.data(), SHA_DIGEST_LENGTH);
+    // The key suffixed with a GUID, hashed with SHA-1 and encoded in base64.
+    const auto accept = ws::Handshake::accept_for(key);
+    return { accept.data(), accept.size() };
+}
+
+void mask(std::string_view data, char* out, uint32_t masking_key, size_t offset)
+{
+    static const auto kernel = select_mask_kernel();
+    const auto* in = data.data();
+    auto len = data.size();
+
+    // Mask byte by byte until the output is aligned for the kernel, or until the end for short payloads.
+    const auto misalignment = reinterpret_cast<uintptr_t>(out) % MASK_KERNEL_THRESHOLD;
+    const auto head
+        = len < MASK_KERNEL_THRESHOLD ? len : (MASK_KERNEL_THRESHOLD - misalignment) % MASK_KERNEL_THRESHOLD;
+
+    for (size_t i {}; i < head; ++i, ++offset) {
+        out[i] = static_cast<char>(in[i] ^ static_cast<char>(masking_key >> (24 - ((offset % 4) * 8))));
+    }
+    in += head;
+    out += head;
+    len -= head;
+
+    if (len == 0) {
+        return;
+    }
+
+    const auto pattern = mask_pattern(masking_key, offset);
+    auto done = kernel(in, out, len, pattern);
+
+    // Then whole words, and whatever is left byte by byte. Both kernels keep the pattern in phase.
+    done += mask_words(in + done, out + done, len - done, pattern);
+    offset += done;
+    for (auto i = done; i < len; ++i, ++offset) {
+        out[i] = static_cast<char>(in[i] ^ static_cast<char>(masking_key >> (24 - ((offset % 4) * 8))));
+    }
 }
 
 std::string get_random_base64_from(uint32_t source_len)
@@ -473,14 +653,12 @@ std::string get_random_base64_from(uint32_t source_len)
     // Have to reserve the theoretical space for encoding.
     const size_t reserved_bytes = rounded_bytes * 4 / 3;
 
-    ret.reserve(reserved_bytes);
-    std::random_device rd {};
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<uint16_t> dis(0, 63);
+    ret.resize(reserved_bytes - padding);
+    fill_random(ret.data(), ret.size());
 
-    // Append the random characters.
-    for (uint32_t i {}; i < reserved_bytes - padding; ++i) {
-        ret += BASE64_CHARS[static_cast<uint8_t>(dis(gen))];
+    // Turn the random bytes into random characters, 6 bits each, which keeps them uniform.
+    for (auto& c : ret) {
+        c = BASE64_CHARS[static_cast<uint8_t>(c) & 0x3FU];
     }
     // Append missing padding characters.
     for (uint32_t i {}; i < padding; ++i) {
@@ -492,10 +670,69 @@ std::string get_random_base64_from(uint32_t source_len)
 
 uint32_t get_random_number(uint32_t min, uint32_t max)
 {
-    std::random_device rd {};
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<uint32_t> dis(min, max);
-    return dis(gen);
+    auto& rng = ChaChaRng::local();
+    const uint64_t range = uint64_t { max } - min + 1;
+
+    if (range > (std::numeric_limits<uint32_t>::max)()) {
+        return rng.next_u32();
+    }
+
+    // Numbers past the last whole multiple of the range are drawn again, so that every value is as likely.
+    const uint64_t limit = (uint64_t { 1 } << 32U) - ((uint64_t { 1 } << 32U) % range);
+    uint64_t ret {};
+
+    do {
+        ret = rng.next_u32();
+    } while (ret >= limit);
+    return min + static_cast<uint32_t>(ret % range);
+}
+
+void fill_random(char* out, size_t len) { ChaChaRng::local().fill(reinterpret_cast<uint8_t*>(out), len); }
+
+bool is_valid_utf8(std::string_view data) { return Utf8Validator::validate(data); }
+
+std::vector<std::string> resolve_addresses(const std::string& host, uint16_t port)
+{
+    std::vector<std::string> ret {};
+    BIO_ADDRINFO* res {};
+
+    if (BIO_lookup_ex(host.c_str(), std::to_string(port).c_str(), BIO_LOOKUP_CLIENT, AF_INET, SOCK_STREAM,
+            IPPROTO_TCP, &res)
+        == 0) {
+        return ret;
+    }
+
+    for (const BIO_ADDRINFO* ai = res; ai != nullptr; ai = BIO_ADDRINFO_next(ai)) {
+        auto* address = BIO_ADDR_hostname_string(BIO_ADDRINFO_address(ai), 1);
+
+        if (address == nullptr) {
+            continue;
+        }
+        if (std::find(ret.begin(), ret.end(), address) == ret.end()) {
+            ret.emplace_back(address);
+        }
+
+        OPENSSL_free(address);
+    }
+
+    BIO_ADDRINFO_free(res);
+    return ret;
+}
+
+bool pin_thread_to_core(size_t core)
+{
+    const auto cores = (std::max)(std::thread::hardware_concurrency(), 1U);
+    core %= cores;
+#ifdef _WIN32
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR { 1 } << core) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
 }
 
 bool iequals(const std::string& a, const std::string& b)
@@ -567,13 +804,9 @@ std::string create_boundary()
 
     // 2.  Choose a random printable ASCII character.
     // The printable ASCII characters are the characters from the range 32 to 127, inclusive.
-    std::random_device rd {};
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution dis(32, 127);
-
     // 3.  Append the character to the string.
     for (size_t i {}; i < rng; ++i) {
-        ret += static_cast<char>(dis(gen));
+        ret += static_cast<char>(get_random_number(32, 127));
     }
 
     return ret;
@@ -0,0 +1,105 @@
+#include <Waker.hpp>
+#include <array>
+#include <ekisocket/Socket.hpp>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ekisocket {
+#ifdef _WIN32
+Waker::Waker()
+{
+    // Windows cannot poll pipes, so a connected pair of loopback sockets is used instead.
+    const auto listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in addr {};
+    int len = sizeof(addr);
+
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listener, reinterpret_cast<sockaddr*>(&addr), len);
+    listen(listener, 1);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+
+    m_write = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    connect(m_write, reinterpret_cast<sockaddr*>(&addr), len);
+    m_read = accept(listener, nullptr, nullptr);
+    closesocket(listener);
+
+    u_long non_blocking { 1 };
+    ioctlsocket(m_read, FIONBIO, &non_blocking);
+}
+
+Waker::~Waker()
+{
+    closesocket(m_read);
+    closesocket(m_write);
+}
+
+void Waker::wake()
+{
+    if (!m_pending.exchange(true)) {
+        const char byte {};
+        (void)::send(m_write, &byte, 1, 0);
+    }
+}
+
+void Waker::drain()
+{
+    std::array<char, 64> buf {};
+
+    m_pending.store(false);
+    while (::recv(m_read, buf.data(), static_cast<int>(buf.size()), 0) > 0) { }
+}
+#else
+Waker::Waker()
+{
+#ifdef __linux__
+    m_read = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_write = m_read;
+#else
+    std::array<int, 2> fds { -1, -1 };
+
+    if (pipe(fds.data()) == 0) {
+        for (const auto fd : fds) {
+            (void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+    m_read = fds[0];
+    m_write = fds[1];
+#endif
+}
+
+Waker::~Waker()
+{
+    if (m_read != -1) {
+        (void)close(m_read);
+    }
+    if (m_write != m_read && m_write != -1) {
+        (void)close(m_write);
+    }
+}
+
+void Waker::wake()
+{
+    if (!m_pending.exchange(true)) {
+        const uint64_t one { 1 };
+        // An eventfd needs all 8 bytes, a pipe only needs one of them.
+        (void)write(m_write, &one, sizeof(one));
+    }
+}
+
+void Waker::drain()
+{
+    std::array<uint64_t, 8> buf {};
+
+    m_pending.store(false);
+    while (read(m_read, buf.data(), sizeof(buf)) > 0) { }
+}
+#endif
+} // namespace ekisocket
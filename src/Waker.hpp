@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <ekisocket/SslClient.hpp>
+
+namespace ekisocket {
+/**
+ * @brief A descriptor that becomes readable when wake() is called from any thread, so a thread blocked in poll() (or
+ * epoll) on its own descriptors can be interrupted. Backed by an eventfd on Linux, a pipe on other POSIX systems and a
+ * loopback socket pair on Windows. Repeated wakes before the next drain() cost a single notification.
+ */
+class Waker {
+public:
+    Waker();
+    Waker(const Waker&) = delete;
+    Waker& operator=(const Waker&) = delete;
+    Waker(Waker&&) = delete;
+    Waker& operator=(Waker&&) = delete;
+    ~Waker();
+
+    /**
+     * @brief The descriptor to poll for readability.
+     */
+    [[nodiscard]] socket_t fd() const { return m_read; }
+
+    /**
+     * @brief Makes fd() readable, unless it already is.
+     */
+    void wake();
+
+    /**
+     * @brief Consumes the pending wake-up, making fd() unreadable again.
+     */
+    void drain();
+
+private:
+    /// The end that is polled.
+    socket_t m_read {};
+    /// The end that is written to, the same as m_read for an eventfd.
+    socket_t m_write {};
+    /// Whether or not a wake-up is pending, so concurrent wakes only write once.
+    std::atomic_bool m_pending {};
+};
+} // namespace ekisocket
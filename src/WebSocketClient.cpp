@@ -1,235 +1,1261 @@
+#include <BufferPool.hpp>
+#include <FrameParser.hpp>
+#include <Handshake.hpp>
+#include <MpscQueue.hpp>
+#include <PerMessageDeflate.hpp>
+#include <Random.hpp>
+#include <TokenBucket.hpp>
+#include <Utf8Validator.hpp>
+#include <Waker.hpp>
+#include <array>
+#include <cmath>
 #include <condition_variable>
+#include <deque>
 #include <ekisocket/Errors.hpp>
+#include <ekisocket/Socket.hpp>
 #include <ekisocket/WebSocketClient.hpp>
 #include <fmt/format.h>
+#include <limits>
 #include <mutex>
 #include <optional>
-#include <queue>
+#include <shared_mutex>
 #include <thread>
+#include <vector>
 
 namespace {
-constexpr std::chrono::seconds HEARTBEAT_INTERVAL { 30 };
 constexpr std::chrono::minutes TIMEOUT_INTERVAL { 2 };
 constexpr uint8_t MAX_HEADER_LENGTH { 14 };
+/// The largest payload of a control frame.
+constexpr size_t MAX_CONTROL_PAYLOAD { 125 };
+/// The largest handshake response accepted.
+constexpr size_t MAX_HANDSHAKE_LENGTH { 16384 };
+/// How much is read from the transport at once.
+constexpr size_t READ_CHUNK_SIZE { 16384 };
+/// How often start() checks transports that have no descriptor to poll.
+constexpr std::chrono::milliseconds FALLBACK_POLL_INTERVAL { 1 };
+/// How many payload buffers of sent frames are kept for reuse, and how large they may be.
+constexpr size_t POOLED_BUFFERS { 16 };
+constexpr size_t MAX_POOLED_BUFFER_SIZE { 262144 };
+/// How many buffers of retained messages are kept for reuse, and how large they may be.
+constexpr size_t POOLED_MESSAGES { 64 };
+constexpr size_t MAX_POOLED_MESSAGE_SIZE { 1048576 };
+/// How many bytes of queued frames are gathered into a single write.
+constexpr size_t WRITE_BATCH_SIZE { 65536 };
+/// The largest message accepted unless told otherwise, which is no limit at all.
+constexpr size_t MAX_MESSAGE_SIZE { std::numeric_limits<size_t>::max() };
 
 /**
- * @brief Represents a WebSocket Data Frame. This is what is sent between the client and server. Some of the following
- * fields have been included for being correct, but left out as they are not needed/used.
+ * @brief A frame waiting to be written. The header is built inline, and the masked payload lives in a pooled buffer,
+ * so that both can be written with a single vectored send.
  */
-struct WSFrame {
-    unsigned char fin : 1;
-    // unsigned int rsv1 : 1; // Not used.
-    // unsigned int rsv2 : 1; // Not used.
-    // unsigned int rsv3 : 1; // Not used.
-    unsigned char opcode : 4;
-    unsigned char masked : 1;
-    unsigned int payload_len : 7;
-    uint64_t ext_payload_len;
-    uint32_t masking_key;
-    // uint64_t payload_data; // Not needed.
-    unsigned char payload_start : 4; // Beginning of the payload, which can at most be 14.
+struct OutgoingFrame {
+    std::array<char, MAX_HEADER_LENGTH> header {};
+    uint8_t header_length {};
+    std::string payload {};
+    /// Called once the frame has been written, or dropped.
+    ekisocket::ws::SendCallback on_sent {};
+
+    [[nodiscard]] size_t size() const { return header_length + payload.size(); }
+
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
+    [[nodiscard]] std::string_view header_view() const { return { header.data(), header_length }; }
 };
 
-void mask_payload(std::string& payload, uint32_t masking_key, uint8_t start = 0)
+/**
+ * @brief The size of a client frame with a payload of the given length, header and masking key included.
+ */
+constexpr size_t frame_size(size_t payload_length)
 {
-    for (size_t i {}; i < payload.size() - start; ++i) {
-        auto j = i % 4;
-        // If j is 0, it represents the masking_key shifted by 24 bits (Octet 0).
-        // If j is 1, it represents the masking_key shifted by 16 bits (Octet 1).
-        // If j is 2, it represents the masking_key shifted by 8 bits (Octet 2).
-        // If j is 3, it represents the masking_key shifted by 0 bits (Octet 3).
-        *(reinterpret_cast<std::byte*>(&payload[start + i]))
-            ^= std::byte { static_cast<uint8_t>((masking_key >> (24 - (j * 8))) & 0xFF) };
+    return 2 + (payload_length < 126 ? 0 : payload_length < 65536 ? 2 : 8) + 4 + payload_length;
+}
+} // namespace
+
+namespace ekisocket::ws {
+struct Client::Impl : http::Client {
+    using Completions = std::vector<std::pair<SendCallback, std::error_code>>;
+
+    explicit Impl(std::string_view url)
+        : m_url { url }
+    {
+    }
+
+    Impl(std::string_view url, TransportFactory factory)
+        : http::Client(std::move(factory))
+        , m_url { url }
+    {
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+    Impl(Impl&&) = delete;
+    Impl& operator=(Impl&&) = delete;
+
+    ~Impl() override
+    {
+        set_automatic_reconnect(false);
+        close();
+    }
+
+    bool get_automatic_reconnect() const { return m_reconnect.load(); }
+
+    const std::string& get_url() const
+    {
+        std::scoped_lock lk { m_mtx };
+        return m_url;
+    }
+
+    [[nodiscard]] Status status() const { return m_status.load(); }
+
+    void set_automatic_reconnect(bool reconnect)
+    {
+        {
+            std::scoped_lock lk { m_mtx };
+            m_reconnect = reconnect;
+        }
+        // Stop waiting to reconnect.
+        m_reconnect_cv.notify_all();
+    }
+
+    void set_reconnect_policy(const ReconnectPolicy& policy)
+    {
+        std::scoped_lock lk { m_mtx };
+        m_reconnect_policy = policy;
+    }
+
+    void set_on_reconnect(ReconnectCallback cb)
+    {
+        std::scoped_lock lk { m_callback_mtx };
+        m_on_reconnect = std::move(cb);
+    }
+
+    [[nodiscard]] std::optional<std::chrono::milliseconds> next_reconnect_delay()
+    {
+        std::scoped_lock lk { m_mtx };
+        const auto& policy = m_reconnect_policy;
+
+        if (!m_reconnect.load() || !m_established
+            || (policy.max_attempts > 0 && m_reconnect_attempts >= policy.max_attempts)) {
+            return std::nullopt;
+        }
+
+        // Full jitter: anywhere between nothing and the exponentially growing ceiling.
+        const auto ceiling = (std::min)(static_cast<double>(policy.max_delay.count()),
+            static_cast<double>(policy.initial_delay.count())
+                * std::pow((std::max)(policy.multiplier, 1.0), m_reconnect_attempts));
+        const auto fraction = static_cast<double>(ChaChaRng::local().next_u32()) / 0x1p32;
+
+        ++m_reconnect_attempts;
+        return std::chrono::milliseconds { static_cast<std::chrono::milliseconds::rep>(ceiling * fraction) };
+    }
+
+    void set_on_message(const MessageCallback& cb)
+    {
+        std::scoped_lock lk { m_callback_mtx };
+        m_on_message = cb;
+    }
+
+    void set_on_fragment(const FragmentCallback& cb)
+    {
+        std::scoped_lock lk { m_callback_mtx };
+        m_on_fragment = cb;
+    }
+
+    void set_max_message_size(size_t size) { m_max_message_size = size; }
+
+    void set_on_message_view(const MessageViewCallback& cb)
+    {
+        std::scoped_lock lk { m_callback_mtx };
+        m_on_message_view = cb;
+    }
+
+    [[nodiscard]] const std::shared_ptr<BufferPool>& message_pool() const { return m_message_pool; }
+
+    void set_url(std::string_view url)
+    {
+        std::scoped_lock lk { m_mtx };
+        m_url = url;
+        m_handshake.reset();
+    }
+
+    void set_wakeup(std::function<void()> cb)
+    {
+        std::scoped_lock lk { m_wakeup_mtx };
+        m_wakeup = std::move(cb);
+    }
+
+    void set_compression(std::optional<DeflateOptions> options)
+    {
+        std::scoped_lock lk { m_mtx };
+        m_compression = options;
+        m_handshake.reset();
+    }
+
+    void set_handshake_headers(const http::Headers& headers)
+    {
+        std::scoped_lock lk { m_mtx };
+        m_handshake_headers = headers;
+        m_handshake.reset();
+    }
+
+    void set_subprotocols(std::vector<std::string> protocols)
+    {
+        std::scoped_lock lk { m_mtx };
+        m_subprotocols = std::move(protocols);
+        m_handshake.reset();
+    }
+
+    [[nodiscard]] std::string subprotocol() const
+    {
+        std::scoped_lock lk { m_mtx };
+        return m_subprotocol;
+    }
+
+    [[nodiscard]] http::Headers handshake_headers() const
+    {
+        std::string response {};
+        {
+            std::scoped_lock lk { m_mtx };
+            response = m_handshake_response;
+        }
+
+        // Only parsed on demand, the handshake itself does not need the headers collected.
+        http::Headers ret {};
+
+        for (auto start = (std::min)(response.find("\r\n"), response.size()); start < response.size();) {
+            start += 2;
+
+            const auto end = (std::min)(response.find("\r\n", start), response.size());
+            const auto line = std::string_view { response }.substr(start, end - start);
+            const auto colon = line.find(':');
+
+            start = end;
+            if (colon == std::string_view::npos) {
+                continue;
+            }
+
+            auto value = line.substr(colon + 1);
+            while (value.starts_with(' ')) {
+                value.remove_prefix(1);
+            }
+            ret.emplace(line.substr(0, colon), value);
+        }
+        return ret;
+    }
+
+    void set_transport_compression(TransportCompression compression)
+    {
+        std::scoped_lock lk { m_mtx };
+        m_transport_compression = compression;
+    }
+
+    [[nodiscard]] bool compression_enabled() const
+    {
+        std::scoped_lock lk { m_deflate_mtx };
+        return m_deflate != nullptr;
+    }
+
+    [[nodiscard]] CompressionStats compression_stats() const
+    {
+        std::scoped_lock lk { m_deflate_mtx };
+        return m_compression_stats;
+    }
+
+    void set_send_buffer(const SendBufferOptions& options)
+    {
+        std::scoped_lock lk { m_drain_mtx };
+        m_high_watermark = options.high_watermark;
+        m_low_watermark = options.low_watermark;
+        m_overflow_policy = options.policy;
+        m_block_timeout = options.block_timeout;
+    }
+
+    void set_heartbeat(const HeartbeatOptions& options)
+    {
+        {
+            std::scoped_lock lk { m_mtx };
+            m_heartbeat = options;
+            // Room has to be left for the timestamp.
+            if (m_heartbeat.payload_prefix.size() > MAX_CONTROL_PAYLOAD - sizeof(int64_t)) {
+                m_heartbeat.payload_prefix.resize(MAX_CONTROL_PAYLOAD - sizeof(int64_t));
+            }
+            m_next_heartbeat = (std::min)(m_next_heartbeat, std::chrono::steady_clock::now() + m_heartbeat.interval);
+        }
+        notify();
+    }
+
+    void set_timeouts(std::chrono::milliseconds handshake, std::chrono::milliseconds close)
+    {
+        std::scoped_lock lk { m_mtx };
+        m_handshake_time_limit = handshake;
+        m_close_time_limit = close;
+    }
+
+    [[nodiscard]] RttStats rtt_stats() const
+    {
+        std::scoped_lock lk { m_mtx };
+        auto ret = m_rtt_stats;
+        ret.missed_heartbeats = m_missed_heartbeats.load();
+        return ret;
+    }
+
+    void set_on_rtt(RttCallback cb)
+    {
+        std::scoped_lock lk { m_callback_mtx };
+        m_on_rtt = std::move(cb);
+    }
+
+    void set_idle_timeout(std::chrono::milliseconds timeout)
+    {
+        {
+            std::scoped_lock lk { m_mtx };
+            m_idle_timeout = timeout;
+        }
+        // Whoever drives the connection has to pick up the new deadline.
+        notify();
+    }
+
+    void set_on_drain(std::function<void()> cb)
+    {
+        std::scoped_lock lk { m_callback_mtx };
+        m_on_drain = std::move(cb);
+    }
+
+    [[nodiscard]] size_t buffered_amount() const { return m_buffered.load(); }
+
+    bool send(Opcode opcode, std::string_view message, SendCallback on_sent, std::error_code& ec)
+    {
+        std::shared_lock lk { m_message_mtx };
+
+        // The frames of a streamed message cannot be interleaved with those of another message.
+        ec = m_streaming ? std::error_code { errors::Error::MESSAGE_IN_PROGRESS }
+                         : send_data(opcode, message, std::move(on_sent));
+        return !ec;
+    }
+
+    /**
+     * @brief Reserves the connection for a streamed message.
+     *
+     * @param connection Set to the connection the message is sent on.
+     * @return std::error_code Why the message cannot be started, if it cannot.
+     */
+    std::error_code begin_message(Opcode type, uint64_t& connection)
+    {
+        if (type != Opcode::TEXT && type != Opcode::BINARY) {
+            return std::make_error_code(std::errc::invalid_argument);
+        }
+        if (m_status.load() != Status::OPEN) {
+            return errors::Error::NOT_OPEN;
+        }
+
+        std::scoped_lock lk { m_message_mtx };
+        if (m_streaming) {
+            return errors::Error::MESSAGE_IN_PROGRESS;
+        }
+        m_streaming = true;
+        connection = m_connection;
+        return {};
+    }
+
+    /**
+     * @brief Sends a frame of a streamed message, and releases the connection for other messages after the last one.
+     *
+     * @param connection The connection the message was started on.
+     */
+    std::error_code send_fragment(Opcode opcode, std::string_view chunk, bool fin, uint64_t connection)
+    {
+        // The connection the message was started on is gone, and the new one is not in the middle of it.
+        if (connection != m_connection.load()) {
+            return errors::Error::NOT_OPEN;
+        }
+        if (auto ec = send_data(opcode, chunk, {}, fin)) {
+            return ec;
+        }
+        if (fin) {
+            std::scoped_lock lk { m_message_mtx };
+            if (connection == m_connection.load()) {
+                m_streaming = false;
+            }
+        }
+        return {};
+    }
+
+    bool open(std::error_code& ec)
+    {
+        if (!begin_open(ec)) {
+            return false;
+        }
+
+        // Drive the handshake, blocking until the transport is ready or the handshake times out.
+        while (m_status.load() == Status::CONNECTING) {
+            const auto writing = interest() == Interest::READ_WRITE;
+            const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+                m_handshake_timeout - std::chrono::steady_clock::now());
+
+            transport().set_timeout(static_cast<int>((std::max)(remaining.count(), std::chrono::milliseconds::rep {})));
+            (void)transport().wait(!writing, writing);
+            transport().set_blocking(false);
+
+            writing ? on_writable() : on_readable();
+            on_timer();
+        }
+
+        ec = m_open_error;
+        return !ec;
+    }
+
+    /**
+     * @brief Connects to the endpoint and queues the handshake, which completes through on_readable() and
+     * on_writable().
+     *
+     * @param ec Set if the connection could not be established.
+     * @return bool Whether or not the handshake is now underway.
+     */
+    bool begin_open(std::error_code& ec)
+    {
+        ec.clear();
+        if (const auto status = m_status.load(); status == Status::CONNECTING || status == Status::OPEN) {
+            return false;
+        }
+        if (!connect(ec)) {
+            std::scoped_lock lk { m_mtx };
+            m_open_error = ec;
+            return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] std::error_code open_error() const
+    {
+        std::scoped_lock lk { m_mtx };
+        return m_open_error;
+    }
+
+    void start(std::error_code& ec)
+    {
+        ec.clear();
+        if (!open(ec)) {
+            return;
+        }
+
+        while (true) {
+            run();
+
+            // Failed attempts are retried, after a longer and longer wait, until one succeeds or they are used up.
+            do {
+                const auto delay = next_reconnect_delay();
+                if (!delay || !wait_to_reconnect(*delay)) {
+                    return;
+                }
+            } while (!open(ec));
+        }
+    }
+
+    /**
+     * @brief Waits for the delay, then for the process to let one more client reconnect.
+     *
+     * @return bool Whether or not to reconnect, which automatic reconnection being turned off in the meantime cancels.
+     */
+    bool wait_to_reconnect(std::chrono::milliseconds delay)
+    {
+        auto until = std::chrono::steady_clock::now() + delay;
+        std::unique_lock lk { m_mtx };
+
+        while (true) {
+            if (m_reconnect_cv.wait_until(lk, until, [this] { return !m_reconnect.load(); })) {
+                return false;
+            }
+
+            const auto wait = TokenBucket::reconnects().try_acquire();
+            if (wait == std::chrono::steady_clock::duration {}) {
+                return true;
+            }
+            until = std::chrono::steady_clock::now() + wait;
+        }
+    }
+
+    void start_async()
+    {
+        if (m_running_thread.joinable()) {
+            return;
+        }
+        m_running_thread = std::jthread([this] {
+            std::error_code ec {};
+            start(ec);
+        });
+    }
+
+    void close(uint16_t code = 1000, std::string_view reason = {})
+    {
+        using enum ekisocket::ws::Status;
+
+        if (const auto status = m_status.load(); status == CLOSING || status == CLOSED) {
+            return;
+        }
+        // There is nobody to send a close frame to yet.
+        if (m_status.load() == CONNECTING) {
+            return fail_open(std::make_error_code(std::errc::operation_canceled));
+        }
+
+        m_status = CLOSING;
+
+        // The message to send with this frame is the close code occupies 2 bytes, and the reason for closing can occupy
+        // the rest.
+        std::string data {};
+        data.reserve(2 + reason.length());
+        data.push_back(static_cast<char>(code >> 8));
+        data.push_back(static_cast<char>(code));
+        data += reason;
+        send_data(Opcode::CLOSE, data);
+    }
+
+    [[nodiscard]] socket_t fd() { return is_active() ? transport().native_handle() : ~socket_t {}; }
+
+    [[nodiscard]] Interest interest() const
+    {
+        if (!is_active()) {
+            return Interest::NONE;
+        }
+
+        std::scoped_lock lk { m_mtx };
+        return m_batch.empty() && m_control_frames.empty() && m_data_frames.empty() && m_outbox.empty()
+            ? Interest::READ
+            : Interest::READ_WRITE;
+    }
+
+    [[nodiscard]] std::optional<std::chrono::steady_clock::time_point> next_deadline() const
+    {
+        if (!is_active()) {
+            return std::nullopt;
+        }
+
+        std::scoped_lock lk { m_mtx };
+        if (m_status.load() == Status::CONNECTING) {
+            return m_handshake_timeout;
+        }
+        // Heartbeats stop once we are closing, only the close timeout is left.
+        if (m_close_flags.client) {
+            return m_close_timeout;
+        }
+        if (m_status.load() != Status::OPEN) {
+            return std::nullopt;
+        }
+
+        std::optional<std::chrono::steady_clock::time_point> ret {};
+
+        if (m_heartbeat.interval.count() > 0) {
+            ret = m_next_heartbeat;
+        }
+        if (m_idle_timeout.count() > 0) {
+            ret = (std::min)(ret.value_or(std::chrono::steady_clock::time_point::max()),
+                m_last_received + m_idle_timeout);
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Reads everything the transport has to offer, and processes the complete frames.
+     */
+    void on_readable()
+    {
+        if (!is_active()) {
+            return;
+        }
+
+        // Errors such as a reset by the peer leave the transport disconnected, which is handled below.
+        std::error_code ec {};
+        bool received_any {};
+
+        while (true) {
+            const auto received = transport().receive_into(m_inbox.prepare(READ_CHUNK_SIZE), ec);
+
+            m_inbox.commit(received);
+
+            if (received == 0 || ec) {
+                break;
+            }
+            received_any = true;
+            // Frames are processed as they arrive, so that only the one being received is ever buffered.
+            if (m_status.load() != Status::CONNECTING) {
+                process_inbox();
+            }
+        }
+
+        if (received_any) {
+            std::scoped_lock lk { m_mtx };
+            m_last_received = std::chrono::steady_clock::now();
+        }
+        if (m_status.load() == Status::CONNECTING) {
+            process_handshake();
+        }
+        process_inbox();
+        check_close();
+    }
+
+    /**
+     * @brief Writes as much of the queued frames as the transport accepts.
+     */
+    void on_writable()
+    {
+        if (!is_active()) {
+            return;
+        }
+
+        std::error_code ec {};
+        Completions completions {};
+        bool drained {};
+        {
+            std::scoped_lock lk { m_mtx };
+            while (!m_batch.empty() || fill_batch()) {
+                // Everything in the batch that has not been written yet goes out in a single vectored send.
+                m_iov.clear();
+                auto skip = m_written;
+                for (const auto& frame : m_batch) {
+                    for (const auto part : { frame.header_view(), std::string_view { frame.payload } }) {
+                        if (skip >= part.length()) {
+                            skip -= part.length();
+                            continue;
+                        }
+                        m_iov.push_back(part.substr(skip));
+                        skip = 0;
+                    }
+                }
+
+                const auto sent = transport().sendv(m_iov, ec);
+
+                m_written += sent;
+                drained = release_buffered(sent) || drained;
+
+                // The connection is gone, check_close() will dispatch the disconnection.
+                if (ec) {
+                    clear_writes();
+                    break;
+                }
+                // The transport is full, we will be called again once it is writable.
+                if (m_written < m_batch_size) {
+                    break;
+                }
+                finish_batch();
+            }
+            completions.swap(m_completions);
+        }
+
+        run(completions);
+        if (drained) {
+            wake_senders();
+
+            std::scoped_lock lk { m_callback_mtx };
+            if (m_on_drain) {
+                m_on_drain();
+            }
+        }
+        check_close();
+    }
+
+    /**
+     * @brief Sends heartbeats and enforces the timeouts that are due.
+     */
+    void on_timer()
+    {
+        if (!is_active()) {
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+
+        if (m_status.load() == Status::CONNECTING) {
+            if (now >= m_handshake_timeout) {
+                fail_open(std::make_error_code(std::errc::timed_out));
+            }
+            return;
+        }
+
+        bool send_heartbeat {};
+        bool idle {};
+        uint8_t max_missed {};
+        std::string ping {};
+        {
+            std::scoped_lock lk { m_mtx };
+            if (m_status.load() == Status::OPEN && !m_close_flags.client) {
+                idle = m_idle_timeout.count() > 0 && now >= m_last_received + m_idle_timeout;
+                send_heartbeat = !idle && m_heartbeat.interval.count() > 0 && now >= m_next_heartbeat;
+            }
+            if (send_heartbeat) {
+                m_next_heartbeat = now + m_heartbeat.interval;
+                max_missed = m_heartbeat.max_missed;
+                ping = m_heartbeat.payload_prefix;
+            }
+        }
+
+        if (idle) {
+            close(1000, "Idle timeout.");
+        } else if (send_heartbeat) {
+            if (max_missed > 0 && m_missed_heartbeats.load() >= max_missed) {
+                return disconnect(Message { .type = Opcode::CLOSE, .data = "Too many missed heartbeats." });
+            }
+            ++m_missed_heartbeats;
+
+            // The pong echoes the time the ping was sent, in microseconds, which gives a round-trip time sample.
+            const auto sent = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+            for (size_t i {}; i < sizeof(sent); ++i) {
+                ping.push_back(static_cast<char>(static_cast<uint64_t>(sent) >> (56 - i * 8)));
+            }
+            send_data(Opcode::PING, ping);
+        }
+
+        check_close();
+    }
+
+private:
+    /**
+     * @brief Moves queued frames into the write batch, up to WRITE_BATCH_SIZE bytes. Control frames go first, except
+     * for CLOSE frames, which stay in order with the data frames and end the batch. Must be called with m_mtx held.
+     *
+     * @return bool Whether or not there is anything to write.
+     */
+    bool fill_batch()
+    {
+        take_outbox();
+
+        // Nothing may follow the CLOSE frame once it has been written.
+        if (m_close_flags.client) {
+            drop_queued(errors::Error::CONNECTION_CLOSED);
+        }
+
+        while (m_batch_size < WRITE_BATCH_SIZE && !m_batch_closes) {
+            auto& queue = m_control_frames.empty() ? m_data_frames : m_control_frames;
+
+            if (queue.empty()) {
+                break;
+            }
+
+            auto& frame = m_batch.emplace_back(std::move(queue.front()));
+
+            queue.pop_front();
+            m_batch_size += frame.size();
+            m_batch_closes = frame.header_length > 0
+                && static_cast<Opcode>(static_cast<uint8_t>(frame.header[0]) & 0x0FU) == Opcode::CLOSE;
+        }
+        return !m_batch.empty();
+    }
+
+    /**
+     * @brief Moves the frames queued by the senders to the queues of the writer. Must be called with m_mtx held.
+     */
+    void take_outbox()
+    {
+        // Frames queued from here on need a new wakeup.
+        m_outbox_signalled = false;
+        while (auto frame = m_outbox.pop()) {
+            const auto opcode = static_cast<Opcode>(static_cast<uint8_t>(frame->header[0]) & 0x0FU);
+
+            // Heartbeats and their answers overtake queued messages, so a large backlog does not delay them.
+            (opcode == Opcode::PING || opcode == Opcode::PONG ? m_control_frames : m_data_frames)
+                .push_back(std::move(*frame));
+        }
+    }
+
+    /**
+     * @brief Recycles the buffers of a batch that has been written completely. Must be called with m_mtx held.
+     */
+    void finish_batch()
+    {
+        // Once the CLOSE frame is out, nothing else may be sent, so whatever was queued behind it is dropped.
+        if (m_batch_closes) {
+            m_close_flags.client = 1;
+            m_close_timeout = std::chrono::steady_clock::now() + m_close_time_limit;
+            drop_queued(errors::Error::CONNECTION_CLOSED);
+        }
+        for (auto& frame : m_batch) {
+            complete(std::move(frame.on_sent), {});
+            m_buffer_pool.release(std::move(frame.payload));
+        }
+        m_batch.clear();
+        m_batch_size = 0;
+        m_batch_closes = false;
+        m_written = 0;
+    }
+
+    /**
+     * @brief Drops everything that is queued or being written. Must be called with m_mtx held.
+     */
+    void clear_writes()
+    {
+        take_outbox();
+        drop_queued(errors::Error::CONNECTION_CLOSED);
+
+        // Frames of the batch that went out before the connection was lost still count as written.
+        auto written = m_written;
+        for (auto& frame : m_batch) {
+            const auto size = frame.size();
+
+            complete(std::move(frame.on_sent),
+                written >= size ? std::error_code {} : std::error_code { errors::Error::CONNECTION_CLOSED });
+            written -= (std::min)(written, size);
+            m_buffer_pool.release(std::move(frame.payload));
+        }
+        m_buffered -= m_batch_size - m_written;
+        m_batch.clear();
+        m_batch_size = 0;
+        m_batch_closes = false;
+        m_written = 0;
+    }
+
+    /**
+     * @brief Drops the frames waiting to be written, calling their completion callbacks with ec. Must be called with
+     * m_mtx held.
+     */
+    void drop_queued(const std::error_code& ec)
+    {
+        for (auto* queue : { &m_control_frames, &m_data_frames }) {
+            for (auto& frame : *queue) {
+                drop(frame, ec);
+            }
+            queue->clear();
+        }
+    }
+
+    /**
+     * @brief Gives up on a frame that is not going to be written. Must be called with m_mtx held.
+     */
+    void drop(OutgoingFrame& frame, const std::error_code& ec)
+    {
+        m_buffered -= frame.size();
+        complete(std::move(frame.on_sent), ec);
+        m_buffer_pool.release(std::move(frame.payload));
+    }
+
+    /**
+     * @brief Queues the completion callback of a frame, to be called once m_mtx is released. Must be called with
+     * m_mtx held.
+     */
+    void complete(SendCallback&& on_sent, const std::error_code& ec)
+    {
+        if (on_sent) {
+            m_completions.emplace_back(std::move(on_sent), ec);
+        }
     }
-}
 
-std::string uri_to_string(ekisocket::http::Uri& uri)
-{
-    auto ret = fmt::format("{}://", uri.scheme);
+    /**
+     * @brief Calls the completion callbacks taken from m_completions.
+     */
+    static void run(Completions& completions)
+    {
+        for (auto& [on_sent, ec] : completions) {
+            on_sent(ec);
+        }
+        completions.clear();
+    }
 
-    if (!uri.username.empty()) {
-        ret += uri.username;
-        if (!uri.password.empty()) {
-            ret += fmt::format(":{}", uri.password);
+    /**
+     * @brief Takes the completion callbacks queued so far and calls them. Must be called without m_mtx held.
+     */
+    void run_completions()
+    {
+        Completions completions {};
+        {
+            std::scoped_lock lk { m_mtx };
+            completions.swap(m_completions);
         }
-        ret += "@";
+        run(completions);
     }
 
-    ret += uri.host;
+    /**
+     * @brief Accounts for a frame of the given size in the send buffer if it fits under the high watermark.
+     */
+    bool try_reserve(size_t size)
+    {
+        const auto high_watermark = m_high_watermark.load();
+        auto buffered = m_buffered.load();
 
-    if (uri.port.has_value()) {
-        ret += fmt::format(":{}", uri.port.value());
+        do {
+            if (buffered > 0 && buffered + size > high_watermark) {
+                return false;
+            }
+        } while (!m_buffered.compare_exchange_weak(buffered, buffered + size));
+        return true;
     }
 
-    ret += uri.path;
+    /**
+     * @brief Makes room in the send buffer for a frame of the given size, according to the overflow policy.
+     *
+     * @return std::error_code Why there is no room, if there is not.
+     */
+    std::error_code reserve(size_t size)
+    {
+        if (try_reserve(size)) {
+            return {};
+        }
+
+        std::unique_lock lk { m_drain_mtx };
 
-    if (!uri.query.empty()) {
-        ret += "?";
-        for (const auto& [key, value] : uri.query) {
-            ret += fmt::format("{}={}&", key, value);
+        switch (m_overflow_policy) {
+        case OverflowPolicy::FAIL:
+            m_overflowed = true;
+            return errors::Error::BUFFER_FULL;
+        case OverflowPolicy::BLOCK: {
+            const auto deadline = std::chrono::steady_clock::now() + m_block_timeout;
+
+            while (true) {
+                // Raised before checking, so that the writer cannot drain the buffer in between without waking us up.
+                m_overflowed = true;
+                if (try_reserve(size)) {
+                    return {};
+                }
+                if (const auto status = m_status.load(); status != Status::OPEN && status != Status::CLOSING) {
+                    return errors::Error::NOT_OPEN;
+                }
+                if (m_drain_cv.wait_until(lk, deadline) == std::cv_status::timeout) {
+                    return try_reserve(size) ? std::error_code {} : std::make_error_code(std::errc::timed_out);
+                }
+            }
         }
-        ret.pop_back();
-    }
-    if (!uri.fragment.empty()) {
-        ret += fmt::format("#{}", uri.fragment);
+        case OverflowPolicy::DROP_OLDEST:
+            lk.unlock();
+            return drop_oldest(size) ? std::error_code {} : errors::Error::BUFFER_FULL;
+        }
+        return errors::Error::BUFFER_FULL;
     }
-    return ret;
-}
-} // namespace
 
-namespace ekisocket::ws {
-struct Client::Impl : http::Client {
-    explicit Impl(std::string_view url)
-        : m_url { url }
+    /**
+     * @brief Drops the oldest messages that are not being written yet until a frame of the given size fits.
+     *
+     * @return bool Whether or not the frame now fits, and has been accounted for.
+     */
+    bool drop_oldest(size_t size)
     {
-    }
+        bool reserved {};
+        {
+            std::scoped_lock lk { m_mtx };
 
-    Impl(const Impl&) = delete;
-    Impl& operator=(const Impl&) = delete;
-    Impl(Impl&&) = delete;
-    Impl& operator=(Impl&&) = delete;
+            take_outbox();
+            reserved = try_reserve(size);
+            for (auto it = m_data_frames.begin(); !reserved && it != m_data_frames.end();) {
+                const auto first_byte = static_cast<uint8_t>(it->header[0]);
 
-    ~Impl() override
-    {
-        set_automatic_reconnect(false);
-        try {
-            close();
-        } catch (const errors::SslClientError& e) {
-            fmt::print(stderr, "Error closing WebSocket connection: {}\n", e.what());
+                const auto opcode = static_cast<Opcode>(first_byte & 0x0FU);
+
+                // Only whole uncompressed messages can go, not the CLOSE frame, the frames of a streamed message, or
+                // messages the compression context refers back to.
+                if ((first_byte & 0xC0U) != 0x80U || (opcode != Opcode::TEXT && opcode != Opcode::BINARY)) {
+                    ++it;
+                    continue;
+                }
+                drop(*it, errors::Error::BUFFER_FULL);
+                it = m_data_frames.erase(it);
+                reserved = try_reserve(size);
+            }
         }
+        run_completions();
+        return reserved;
     }
 
-    bool get_automatic_reconnect() const { return m_reconnect.load(); }
-
-    const std::string& get_url() const
+    /**
+     * @brief Takes bytes that have been written out of the send buffer.
+     *
+     * @return bool Whether or not the buffer has just drained down to its low watermark after overflowing.
+     */
+    bool release_buffered(size_t size)
     {
-        std::scoped_lock lk { m_mtx };
-        return m_url;
-    }
+        const auto buffered = m_buffered.fetch_sub(size) - size;
 
-    void set_automatic_reconnect(bool reconnect) { m_reconnect = reconnect; }
-
-    void set_on_message(const MessageCallback& cb)
-    {
-        std::scoped_lock lk { m_mtx };
-        m_on_message = cb;
+        return buffered <= m_low_watermark.load() && m_overflowed.exchange(false);
     }
 
-    void set_url(std::string_view url)
+    /**
+     * @brief Wakes up the senders waiting for room in the send buffer, or for the connection to go away.
+     */
+    void wake_senders()
     {
-        std::scoped_lock lk { m_mtx };
-        m_url = url;
+        {
+            std::scoped_lock lk { m_drain_mtx };
+        }
+        m_drain_cv.notify_all();
     }
 
-    bool send(std::string_view message) { return send_data(Opcode::TEXT, message); }
+    /**
+     * @brief Whether or not there is a connection to drive.
+     */
+    [[nodiscard]] bool is_active() const { return m_status.load() != Status::CLOSED; }
 
-    void start()
+    /**
+     * @brief Drives the connection until it is closed, waiting for readiness with poll() on the transport and a waker
+     * that is signalled whenever a frame is queued.
+     */
+    void run()
     {
-        do {
-            if (!connect()) {
-                return;
+        Waker waker {};
+        {
+            std::scoped_lock lk { m_wakeup_mtx };
+            m_waker = &waker;
+        }
+
+        while (is_active()) {
+            const auto sfd = fd();
+            const auto has_fd = sfd != ~socket_t {};
+            std::array<pollfd, 2> fds { pollfd { waker.fd(), POLLIN, 0 }, pollfd { sfd, POLLIN, 0 } };
+
+            if (interest() == Interest::READ_WRITE) {
+                fds[1].events |= POLLOUT;
             }
 
-            // When we are connected, we want to start sending heartbeats, so we can be notified when the connection is
-            // closed.
-            std::jthread heartbeat_thread(&Impl::heartbeat, this);
-            // We also want to continuously read messages, so we can dispatch them to the m_on_message callback.
-            std::jthread read_thread(&Impl::read, this);
+            int timeout { -1 };
 
-            {
-                std::scoped_lock lk { m_callback_mtx };
-                if (m_on_message) {
-                    m_on_message(Message { Opcode::OPEN, fmt::format("Connected to: {}", m_url) });
-                }
+            if (const auto deadline = next_deadline()) {
+                const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+                    *deadline - std::chrono::steady_clock::now());
+                timeout = static_cast<int>((std::max)(remaining.count(), std::chrono::milliseconds::rep {}));
             }
+            if (!has_fd && (timeout < 0 || timeout > FALLBACK_POLL_INTERVAL.count())) {
+                timeout = static_cast<int>(FALLBACK_POLL_INTERVAL.count());
+            }
+
+            (void)::poll(fds.data(), has_fd ? 2 : 1, timeout);
 
-            // Continue to receive data until the connection is closed.
-            while (m_status.load() != Status::CLOSED) {
-                // Wait for the condition variable to be notified, and only unblock if there is work to be done.
-                m_activity_flag.wait(false);
-                poll();
+            if (fds[0].revents != 0) {
+                waker.drain();
+            }
+            if (!has_fd || fds[1].revents != 0) {
+                on_readable();
+            }
+            if (interest() == Interest::READ_WRITE) {
+                on_writable();
             }
-        } while (m_reconnect.load());
+            if (const auto deadline = next_deadline(); deadline && *deadline <= std::chrono::steady_clock::now()) {
+                on_timer();
+            }
+        }
+
+        std::scoped_lock lk { m_wakeup_mtx };
+        m_waker = nullptr;
     }
 
-    void start_async()
+    /**
+     * @brief Tells whoever drives the connection that there is work to do.
+     */
+    void notify()
     {
-        if (m_running_thread.joinable()) {
-            return;
+        std::function<void()> wakeup {};
+        {
+            std::scoped_lock lk { m_wakeup_mtx };
+            if (m_waker != nullptr) {
+                m_waker->wake();
+            }
+            wakeup = m_wakeup;
+        }
+        if (wakeup) {
+            wakeup();
         }
-        m_running_thread = std::jthread(&Impl::start, this);
     }
 
-    void close(uint16_t code = 1000, std::string_view reason = {})
+    /**
+     * @brief Whether or not data messages are delivered frame by frame.
+     */
+    [[nodiscard]] bool has_fragment_callback() const
     {
-        using enum ekisocket::ws::Status;
+        std::scoped_lock lk { m_callback_mtx };
+        return static_cast<bool>(m_on_fragment);
+    }
 
-        if (const auto status = m_status.load(); status == CLOSING || status == CLOSED) {
-            return;
+    void dispatch_fragment(const Fragment& fragment)
+    {
+        std::scoped_lock lk { m_callback_mtx };
+        if (m_on_fragment) {
+            m_on_fragment(fragment);
         }
+    }
 
-        m_status = CLOSING;
+    void dispatch(const Message& message)
+    {
+        std::scoped_lock lk { m_callback_mtx };
+        if (m_on_message_view) {
+            m_on_message_view(MessageView { message.type, message.data, message.code });
+        } else if (m_on_message) {
+            m_on_message(message);
+        }
+    }
 
-        // The message to send with this frame is the close code occupies 2 bytes, and the reason for closing can occupy
-        // the rest.
-        std::string data {};
-        data.reserve(2 + reason.length());
-        data.push_back(static_cast<char>(code >> 8));
-        data.push_back(static_cast<char>(code));
-        data += reason;
-        send_data(Opcode::CLOSE, data);
+    /**
+     * @brief Dispatches a data message straight from the inbox, if the message callback does not need a copy.
+     *
+     * @return bool Whether or not the message was dispatched.
+     */
+    bool dispatch_view(Opcode type, std::string_view data)
+    {
+        std::scoped_lock lk { m_callback_mtx };
+        if (!m_on_message_view) {
+            return false;
+        }
+        m_on_message_view(MessageView { .type = type, .data = data });
+        return true;
     }
 
-private:
     /**
-     * @brief Connects to the endpoint.
+     * @brief Connects to the endpoint and queues the handshake.
      *
+     * @param ec Set if the connection could not be established.
      * @return bool Whether or not the connection was successful.
      */
-    bool connect()
+    bool connect(std::error_code& ec)
     {
-        if (const auto status = m_status.load(); status == Status::CONNECTING || status == Status::OPEN) {
+        if (std::scoped_lock lk { m_mtx }; !m_handshake.prepared()) {
+            if (m_url.empty()) {
+                ec = errors::Error::URL_NOT_SET;
+                return false;
+            }
+
+            // The URL is only parsed, and the handshake request serialised, when either changes.
+            m_uri = http::Uri::parse(m_url);
+
+            if (m_uri.scheme != "ws" && m_uri.scheme != "wss") {
+                ec = errors::Error::INVALID_SCHEME;
+                return false;
+            }
+
+            // Set the scheme to its HTTP counterpart.
+            m_uri.scheme = m_uri.scheme == "ws" ? "http" : "https";
+            m_handshake.prepare(m_uri, m_compression ? PerMessageDeflate::offer(*m_compression) : std::string {},
+                m_handshake_headers, m_subprotocols);
+        }
+
+        auto* const connection = http::Client::connect(m_uri, ec);
+
+        if (connection == nullptr) {
             return false;
         }
-        if (m_url.empty()) {
-            throw errors::WebSocketClientError("URL not set.");
+
+        // From now on, the connection is only ever driven by readiness, so nothing may block.
+        connection->set_blocking(false);
+
+        {
+            std::scoped_lock lk { m_deflate_mtx };
+            m_deflate.reset();
+        }
+        // Every connection starts a new stream.
+        m_zlib_stream.reset();
+        if (std::scoped_lock lk { m_mtx }; m_transport_compression == TransportCompression::ZLIB_STREAM) {
+            m_zlib_stream = std::make_unique<ZlibStream>();
         }
 
-        m_uri = http::Uri::parse(m_url);
+        {
+            // A message that was being streamed on the previous connection cannot be continued on this one.
+            std::scoped_lock lk { m_message_mtx };
+            m_streaming = false;
+            ++m_connection;
+        }
 
-        if (m_uri.scheme != "ws" && m_uri.scheme != "wss") {
-            return false;
+        {
+            std::scoped_lock lk { m_mtx };
+            m_offered_compression = m_compression;
+            m_open_error.clear();
+            m_inbox.clear();
+            m_read_buffer.clear();
+            m_read_size = 0;
+            m_discard_data = false;
+            clear_writes();
+            m_batch.push_back(OutgoingFrame { .payload = m_handshake.request() });
+            m_batch_size = m_batch.back().size();
+            m_buffered += m_batch_size;
+            m_handshake_timeout = std::chrono::steady_clock::now() + m_handshake_time_limit;
+            m_status = Status::CONNECTING;
         }
 
-        // Set the scheme to its HTTP counterpart.
-        m_uri.scheme = m_uri.scheme == "ws" ? "http" : "https";
+        // Messages queued after the previous connection was lost never went out.
+        run_completions();
+        return true;
+    }
+
+    /**
+     * @brief Validates the handshake response once it has been received completely. Anything received past it already
+     * belongs to the WebSocket stream, and is left in the inbox.
+     */
+    void process_handshake()
+    {
+        const auto inbox = m_inbox.data();
+        const auto end_of_headers = inbox.find("\r\n\r\n");
+
+        if (end_of_headers == std::string_view::npos) {
+            // Nobody sends headers this large, the server is not speaking HTTP.
+            if (inbox.length() > MAX_HANDSHAKE_LENGTH) {
+                fail_open(errors::Error::INVALID_RESPONSE);
+            }
+            return;
+        }
 
-        // Random 16 byte value that looks like it was encoded into base64.
-        const auto key = util::get_random_base64_from(16);
-        const http::Headers headers { { "Connection", "Upgrade" }, { "Upgrade", "websocket" },
-            { "Sec-WebSocket-Version", "13" }, { "Sec-WebSocket-Key", key } };
+        const auto head = inbox.substr(0, end_of_headers + 2);
+        const auto response = m_handshake.validate(head);
 
-        const auto res = http::Client::get(uri_to_string(m_uri), headers);
+        if (!response) {
+            return fail_open(errors::Error::HANDSHAKE_FAILED);
+        }
+        // The server may only accept extensions that were offered.
+        if (response->extensions) {
+            const auto parameters = m_offered_compression
+                ? PerMessageDeflate::negotiate(*response->extensions, *m_offered_compression)
+                : std::nullopt;
+
+            if (!parameters) {
+                return fail_open(errors::Error::HANDSHAKE_FAILED);
+            }
 
-        if (res.status_code != 101) {
-            return false;
+            std::scoped_lock lk { m_deflate_mtx };
+            m_deflate = std::make_unique<PerMessageDeflate>(*parameters, m_offered_compression->min_message_size);
         }
 
-        const auto& r_headers = res.headers;
+        {
+            std::scoped_lock lk { m_mtx };
+            m_subprotocol = response->protocol.value_or("");
+            m_handshake_response = head;
+        }
+        m_inbox.consume(end_of_headers + 4);
 
-        if (!r_headers.contains("Upgrade") || !util::iequals(r_headers.at("Upgrade"), "websocket")) {
-            return false;
+        // How many attempts it took, if the connection was re-established.
+        std::optional<uint32_t> reconnected {};
+        {
+            std::scoped_lock lk { m_mtx };
+            m_close_flags = { 0, 0 };
+            m_close_message.reset();
+            m_missed_heartbeats = 0;
+            m_rtt_stats = {};
+            // The first heartbeat is sent right away.
+            m_next_heartbeat = std::chrono::steady_clock::now();
+            m_last_received = m_next_heartbeat;
+            m_status = Status::OPEN;
+            reconnected = m_established ? std::optional { m_reconnect_attempts } : std::nullopt;
+            m_established = true;
+            m_reconnect_attempts = 0;
         }
-        if (!r_headers.contains("Connection") || !util::iequals(r_headers.at("Connection"), "Upgrade")) {
-            return false;
+
+        if (reconnected) {
+            std::scoped_lock lk { m_callback_mtx };
+            if (m_on_reconnect) {
+                m_on_reconnect(*reconnected);
+            }
         }
-        if (!r_headers.contains("Sec-WebSocket-Accept")
-            || r_headers.at("Sec-WebSocket-Accept") != util::compute_accept(key)) {
-            return false;
+
+        dispatch(Message { Opcode::OPEN, fmt::format("Connected to: {}", m_url) });
+        notify();
+    }
+
+    /**
+     * @brief Abandons a connection whose handshake did not complete, without notifying the callback.
+     *
+     * @param ec Why the handshake did not complete.
+     */
+    void fail_open(const std::error_code& ec)
+    {
+        {
+            std::scoped_lock lk { m_mtx };
+            m_open_error = ec;
+            m_inbox.clear();
+            clear_writes();
+            m_status = Status::CLOSED;
         }
 
-        m_status = Status::OPEN;
-        return true;
+        transport().close();
+        run_completions();
+        wake_senders();
+        notify();
     }
 
     /**
@@ -238,35 +1264,50 @@ private:
      */
     void disconnect(const Message& close_message)
     {
-        if (const auto status = m_status.load(); status != Status::OPEN && status != Status::CLOSING) {
+        if (!is_active()) {
             return;
         }
 
         m_status = Status::CLOSED;
-        ssl().close();
+        transport().close();
 
         {
             std::scoped_lock lk { m_mtx };
             m_close_flags = { 0, 0 };
 
             m_read_buffer.clear();
-            m_write_buffer = {};
+            m_inbox.clear();
+            clear_writes();
         }
 
-        {
-            std::scoped_lock lk { m_callback_mtx };
-            if (m_on_message) {
-                m_on_message(close_message);
+        run_completions();
+        wake_senders();
+        dispatch(close_message);
+        notify();
+    }
+
+    /**
+     * @brief Disconnects if the close handshake is complete, has timed out, or the transport is gone.
+     */
+    void check_close()
+    {
+        if (m_status.load() == Status::CONNECTING) {
+            if (!transport().connected()) {
+                fail_open(errors::Error::CONNECTION_CLOSED);
             }
+            return;
         }
 
-        m_activity_flag.test_and_set();
-        m_activity_flag.notify_one();
-        m_cv.notify_one();
-        m_heartbeat_flag.clear();
-        m_heartbeat_flag.notify_one();
-        m_read_flag.clear();
-        m_read_flag.notify_one();
+        std::unique_lock lk { m_mtx };
+        std::string reason {};
+
+        if ((m_close_flags.client && m_close_flags.server && !reason.append("Mutual disconnection.").empty())
+            || (m_close_flags.client && std::chrono::steady_clock::now() > m_close_timeout
+                && !reason.append("Connection closed because server took too long to send close frame.").empty())
+            || (!transport().connected() && !reason.append("No longer connected to the socket.").empty())) {
+            lk.unlock();
+            disconnect(m_close_message.value_or(Message { .type = Opcode::CLOSE, .data = reason }));
+        }
     }
 
     /**
@@ -275,232 +1316,447 @@ private:
      *
      * @param opcode The opcode of the WebSocket frame.
      * @param message The payload data to send.
-     * @return bool Whether or not the data was sent successfully.
+     * @param on_sent Called once the frame has been written, or dropped.
+     * @param fin Whether or not the frame ends its message.
+     * @return std::error_code Why the data could not be queued, if it could not.
      */
-    bool send_data(const Opcode& opcode, std::string_view data)
+    std::error_code send_data(
+        const Opcode& opcode, std::string_view data, SendCallback on_sent = {}, bool fin = true)
     {
         if (const auto status = m_status.load(); status != Status::OPEN && status != Status::CLOSING) {
-            return false;
+            return errors::Error::NOT_OPEN;
+        }
+
+        // Room is made before compressing, since a message cannot be given up on once the compression context has seen
+        // it. Control frames are always let through.
+        const auto reserved = frame_size(data.length());
+        const auto is_data = opcode == Opcode::TEXT || opcode == Opcode::BINARY || opcode == Opcode::CONTINUATION;
+
+        if (!is_data) {
+            m_buffered += reserved;
+        } else if (const auto ec = reserve(reserved)) {
+            return ec;
+        }
+
+        // Compressed messages have to be queued in the order they were compressed in, since each one can refer back to
+        // the ones before it.
+        std::unique_lock deflate_lk { m_deflate_mtx };
+        std::string deflated {};
+        bool compressed {};
+
+        // The first frame decides for the whole message. The size of a streamed message is not known, so it always is.
+        if (opcode == Opcode::TEXT || opcode == Opcode::BINARY) {
+            m_write_compressed = m_deflate != nullptr && (!fin || m_deflate->should_deflate(data.length()));
+        }
+        if (is_data && m_write_compressed && m_deflate != nullptr) {
+            const auto start = std::chrono::steady_clock::now();
+
+            if (m_deflate->deflate(data, deflated, fin)) {
+                m_compression_stats.deflate_time += std::chrono::steady_clock::now() - start;
+                m_compression_stats.messages_deflated += fin ? 1 : 0;
+                m_compression_stats.deflate_bytes_in += data.length();
+                m_compression_stats.deflate_bytes_out += deflated.length();
+                data = deflated;
+                compressed = true;
+            } else if (opcode == Opcode::CONTINUATION) {
+                // The rest of the message cannot be sent uncompressed.
+                m_buffered -= reserved;
+                return std::make_error_code(std::errc::not_enough_memory);
+            } else {
+                m_write_compressed = false;
+            }
+        }
+        if (!compressed) {
+            deflate_lk.unlock();
+        } else if (const auto size = frame_size(data.length()); size != reserved) {
+            m_buffered += size - reserved;
         }
 
         //* Masking key should be a random 32-bit integer.
         const auto masking_key = util::get_random_number();
 
-        // We can use a uint8_t vector to hold the frame.
-        std::string frame {};
-        frame.reserve(data.length() + MAX_HEADER_LENGTH);
+        OutgoingFrame frame {};
+        auto* header = frame.header.data();
 
-        //* First byte is the FIN bit, the opcode, and the mask bit.
-        frame.push_back(static_cast<char>(0x80 | static_cast<uint8_t>(opcode)));
+        //* First byte is the FIN bit, the RSV1 bit marking compressed messages on their first frame, and the opcode.
+        *header++ = static_cast<char>((fin ? 0x80 : 0) | (compressed && opcode != Opcode::CONTINUATION ? 0x40 : 0)
+            | static_cast<uint8_t>(opcode));
 
         //* Second byte is the mask bit and the length of the payload.
         //* If the payload length is less than 126, then we can send it in one byte.
         if (const uint64_t payload_length = data.length(); payload_length < 126) {
             // Push back the payload_length with the mask bit.
-            frame.push_back(static_cast<char>(payload_length | 0x80));
+            *header++ = static_cast<char>(payload_length | 0x80);
         }
         //* If the payload length is greater than 126, then we need to send it in 2 extra bytes.
         else if (payload_length < 65536) {
             // Push back 126 with the mask bit.
-            frame.push_back(static_cast<char>(126 | 0x80));
-            frame.push_back(static_cast<char>(payload_length >> 8));
-            frame.push_back(static_cast<char>(payload_length));
+            *header++ = static_cast<char>(126 | 0x80);
+            *header++ = static_cast<char>(payload_length >> 8);
+            *header++ = static_cast<char>(payload_length);
         }
         //* If the payload length is greater than 65536, then we need to send it in 8 extra bytes.
         else {
             // Push back 127 with the mask bit.
-            frame.push_back(static_cast<char>(127 | 0x80));
-            frame.push_back(static_cast<char>(payload_length >> 56));
-            frame.push_back(static_cast<char>(payload_length >> 48));
-            frame.push_back(static_cast<char>(payload_length >> 40));
-            frame.push_back(static_cast<char>(payload_length >> 32));
-            frame.push_back(static_cast<char>(payload_length >> 24));
-            frame.push_back(static_cast<char>(payload_length >> 16));
-            frame.push_back(static_cast<char>(payload_length >> 8));
-            frame.push_back(static_cast<char>(payload_length));
+            *header++ = static_cast<char>(127 | 0x80);
+            for (uint32_t shift { 56 }; shift > 0; shift -= 8) {
+                *header++ = static_cast<char>(payload_length >> shift);
+            }
+            *header++ = static_cast<char>(payload_length);
         }
 
         // Add the masking key to the frame.
-        frame.push_back(static_cast<char>(masking_key >> 24));
-        frame.push_back(static_cast<char>((masking_key >> 16) & 0xFF));
-        frame.push_back(static_cast<char>((masking_key >> 8) & 0xFF));
-        frame.push_back(static_cast<char>(masking_key & 0xFF));
+        *header++ = static_cast<char>(masking_key >> 24);
+        *header++ = static_cast<char>((masking_key >> 16) & 0xFF);
+        *header++ = static_cast<char>((masking_key >> 8) & 0xFF);
+        *header++ = static_cast<char>(masking_key & 0xFF);
+
+        frame.header_length = static_cast<uint8_t>(header - frame.header.data());
+
+        // The payload is masked straight from the caller's data into a pooled buffer, in a single pass.
+        frame.payload = m_buffer_pool.acquire();
+        frame.payload.resize(data.length());
+        util::mask(data, frame.payload.data(), masking_key);
+        frame.on_sent = std::move(on_sent);
+
+        m_outbox.push(std::move(frame));
+
+        // Only the first frame since the writer last looked at the outbox wakes it up, the rest ride along.
+        if (!m_outbox_signalled.exchange(true)) {
+            notify();
+        }
+        return {};
+    }
+
+    /**
+     * @brief Processes every complete frame received so far. Incomplete frames are left in the inbox until the rest of
+     * them arrives.
+     */
+    void process_inbox()
+    {
+        while (m_status.load() == Status::OPEN || m_status.load() == Status::CLOSING) {
+            const auto frame = m_inbox.next();
+
+            if (!frame) {
+                // A frame too large for the message it belongs to is dropped as it arrives, rather than buffered.
+                if (const auto length = m_inbox.pending_payload_length();
+                    length && *length > m_max_message_size.load() - m_read_size) {
+                    m_inbox.skip_pending();
+                    if (!m_discard_data) {
+                        reject_message();
+                    }
+                    continue;
+                }
+                break;
+            }
+            process_frame(*frame);
+        }
+    }
+
+    /**
+     * @brief Closes the connection over the message being received. The data received from then on is ignored.
+     */
+    void discard_message(uint16_t code, std::string_view reason)
+    {
+        m_read_buffer.clear();
+        m_read_size = 0;
+        m_discard_data = true;
+        close(code);
+        dispatch(Message { .type = Opcode::BAD, .data = std::string { reason } });
+    }
+
+    /**
+     * @brief Closes the connection over a message larger than the maximum message size.
+     */
+    void reject_message() { discard_message(1009, "Received a message larger than the maximum message size."); }
+
+    /**
+     * @brief Validates the next part of the TEXT message being received, closing the connection if it is not UTF-8.
+     *
+     * @param data The part, decompressed if the message is.
+     * @param fin Whether or not it is the last part of the message, which must not end in the middle of a character.
+     * @return bool Whether or not the message is valid so far.
+     */
+    bool validate_text(std::string_view data, bool fin)
+    {
+        if (m_read_utf8.feed(data) && (!fin || m_read_utf8.finish())) {
+            return true;
+        }
+        discard_message(1007, "Received a TEXT message that is not valid UTF-8.");
+        return false;
+    }
+
+    /**
+     * @brief Decompresses a frame of the compressed message being received into the read buffer.
+     *
+     * @param payload_data The payload of the frame.
+     * @param fin Whether or not this is the final frame of the message.
+     * @param max_size Decompression stops once the read buffer grows past this size.
+     * @return bool Whether or not the payload could be decompressed.
+     */
+    bool inflate(std::string_view payload_data, bool fin, size_t max_size)
+    {
+        std::scoped_lock lk { m_deflate_mtx };
+        const auto start = std::chrono::steady_clock::now();
+        const auto size = m_read_buffer.size();
 
-        const auto header_length = static_cast<uint8_t>(frame.size());
+        if (!m_deflate->inflate(payload_data, m_read_buffer, max_size)
+            || (fin && !m_deflate->finish_inflate(m_read_buffer, max_size))) {
+            return false;
+        }
 
-        frame.insert(frame.end(), data.begin(), data.end());
+        m_compression_stats.inflate_time += std::chrono::steady_clock::now() - start;
+        m_compression_stats.inflate_bytes_in += payload_data.length();
+        m_compression_stats.inflate_bytes_out += m_read_buffer.size() - size;
+        if (fin) {
+            ++m_compression_stats.messages_inflated;
+        }
+        return true;
+    }
 
-        // We want to only mask the payload data.
-        mask_payload(frame, masking_key, header_length);
+    /**
+     * @brief Feeds the message in the read buffer to the zlib stream of the connection.
+     *
+     * @param message Receives the decompressed message, if the stream has been flushed.
+     * @return bool Whether or not there is a message to dispatch.
+     */
+    bool inflate_stream(Message& message)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const auto max_size = m_max_message_size.load();
+        const auto result = m_zlib_stream->feed(m_read_buffer, m_stream_output, max_size);
 
         {
-            std::scoped_lock lk { m_mtx };
-            m_write_buffer.emplace(std::move(frame));
+            std::scoped_lock lk { m_deflate_mtx };
+            m_compression_stats.inflate_time += std::chrono::steady_clock::now() - start;
+            m_compression_stats.inflate_bytes_in += m_read_buffer.size();
+            if (result == ZlibStream::Result::COMPLETE) {
+                ++m_compression_stats.messages_inflated;
+                m_compression_stats.inflate_bytes_out += m_stream_output.size();
+            }
         }
+        m_read_buffer.clear();
 
-        m_activity_flag.test_and_set();
-        m_activity_flag.notify_one();
-        return true;
+        switch (result) {
+        case ZlibStream::Result::PARTIAL:
+            return false;
+        case ZlibStream::Result::COMPLETE:
+            message.data = std::move(m_stream_output);
+            return true;
+        case ZlibStream::Result::CORRUPT:
+        default:
+            if (m_stream_output.size() > max_size) {
+                reject_message();
+                return false;
+            }
+            close(1007);
+            message.type = Opcode::BAD;
+            message.data = "Could not decompress the zlib stream.";
+            return true;
+        }
     }
 
     /**
-     * @brief Parses incoming frame data from the server as a WebSocket frame.
+     * @brief The round-trip time of the heartbeat a pong answers.
      *
-     * @param message The message to parse.
+     * @param payload The payload of the pong.
+     * @return std::optional The round-trip time, or std::nullopt if the pong does not answer one of our heartbeats.
      */
-    void process_data(std::string& data)
+    [[nodiscard]] std::optional<std::chrono::microseconds> heartbeat_rtt(std::string_view payload) const
     {
-        // Because of the edge case of the first frame being so big it takes most of the buffer, having an incomplete
-        // (less than 2 bytes) frame remaining, we have to check if there's a leftover byte.
-        if (m_leftover_byte) {
-            data.insert(0, 1, static_cast<char>(m_leftover_byte.value()));
-            m_leftover_byte = std::nullopt;
-        }
-        // If we've reached our base case or the message is genuinely too short to be considered a frame, then return.
-        if (data.empty() || data.length() < 2) {
-            return;
+        {
+            std::scoped_lock lk { m_mtx };
+            const auto& prefix = m_heartbeat.payload_prefix;
+            if (payload.size() != prefix.size() + sizeof(int64_t) || !payload.starts_with(prefix)) {
+                return std::nullopt;
+            }
+            payload.remove_prefix(prefix.size());
         }
 
-        // Processing the data is just the reverse of sending it.
-        WSFrame f {};
-        f.fin = (static_cast<std::byte>(data[0]) & std::byte { 0x80 }) == std::byte { 0x80 };
-// Get the opcode.
-#ifndef _WIN32
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wconversion"
-#endif
-        f.opcode = std::to_integer<uint8_t>(static_cast<std::byte>(data[0]) & std::byte { 0x0F });
-        f.masked = (static_cast<std::byte>(data[1]) & std::byte { 0x80 }) == std::byte { 0x80 };
-        f.payload_start = 2;
-        f.payload_len = std::to_integer<unsigned int>(static_cast<std::byte>(data[1]) & std::byte { 0x7F });
-#ifndef _WIN32
-#pragma GCC diagnostic pop
-#endif
-        if (f.payload_len == 126) {
-            f.payload_start += 2;
-        } else if (f.payload_len == 127) {
-            f.payload_start += 8;
-        }
-        // If we have a mask bit we must add 4 bytes to the expected header length.
-        if (f.masked) {
-            f.payload_start += 4;
-        }
-
-        // If for some reason we do not have the complete header for the frame, we must fetch it.
-        if (data.length() < f.payload_start) {
-            auto needed = f.payload_start - data.length();
-            do {
-                const auto next_message = ssl().receive(needed);
-
-                if (next_message.empty()) {
-                    continue;
-                }
+        uint64_t sent {};
+        for (const auto c : payload) {
+            sent = (sent << 8U) | static_cast<uint8_t>(c);
+        }
 
-                data += next_message;
-                needed -= next_message.length();
-            } while (needed > 0);
-        }
-
-        // If the payload length is 126, then we can get the payload length from the next 2 bytes.
-        if (f.payload_len == 126) {
-            f.ext_payload_len = static_cast<uint64_t>(static_cast<uint8_t>(data[2])) << 8U;
-            f.ext_payload_len |= static_cast<uint64_t>(static_cast<uint8_t>(data[3]));
-        }
-        // If the payload length is 127, then we need to read the next 8 bytes.
-        else if (f.payload_len == 127) {
-            // Use static_cast to prevent overflows.
-            f.ext_payload_len = static_cast<uint64_t>(static_cast<uint8_t>(data[2])) << 56U;
-            f.ext_payload_len |= static_cast<uint64_t>(static_cast<uint8_t>(data[3])) << 48U;
-            f.ext_payload_len |= static_cast<uint64_t>(static_cast<uint8_t>(data[4])) << 40U;
-            f.ext_payload_len |= static_cast<uint64_t>(static_cast<uint8_t>(data[5])) << 32U;
-            f.ext_payload_len |= static_cast<uint64_t>(static_cast<uint8_t>(data[6])) << 24U;
-            f.ext_payload_len |= static_cast<uint64_t>(static_cast<uint8_t>(data[7])) << 16U;
-            f.ext_payload_len |= static_cast<uint64_t>(static_cast<uint8_t>(data[8])) << 8U;
-            f.ext_payload_len |= static_cast<uint64_t>(static_cast<uint8_t>(data[9]));
-        }
-        // Get the masking key, if the mask bit is set.
-        if (f.masked) {
-            f.masking_key = static_cast<uint32_t>(static_cast<uint8_t>(data[f.payload_start])) << 24U;
-            f.masking_key |= static_cast<uint32_t>(static_cast<uint8_t>(data[f.payload_start + 1])) << 16U;
-            f.masking_key |= static_cast<uint32_t>(static_cast<uint8_t>(data[f.payload_start + 2])) << 8U;
-            f.masking_key |= static_cast<uint32_t>(static_cast<uint8_t>(data[f.payload_start + 3]));
-        }
-
-        // Corresponds to the length of the frame received, which can contain more than just the payload. For example,
-        // parts of another frame.
-        const size_t actual_payload_len = data.length() - f.payload_start;
-        // Our payload length can either be the extended or the normal payload length.
-        const size_t expected_payload_len = f.ext_payload_len > 0 ? f.ext_payload_len : f.payload_len;
-
-        if (actual_payload_len < expected_payload_len) {
-            auto needed = expected_payload_len - actual_payload_len;
-            do {
-                const auto next_message = ssl().receive(needed);
+        const auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch());
+        return (std::max)(now - std::chrono::microseconds { static_cast<int64_t>(sent) }, std::chrono::microseconds {});
+    }
 
-                if (next_message.empty()) {
-                    continue;
-                }
+    /**
+     * @brief Adds a round-trip time sample to the statistics, and hands them to the callback.
+     */
+    void record_rtt(std::chrono::microseconds sample)
+    {
+        RttStats stats {};
+        {
+            std::scoped_lock lk { m_mtx };
+            auto& rtt = m_rtt_stats;
+
+            // RFC 6298 section 2: the first sample is taken as is, the next ones are averaged in.
+            if (rtt.samples == 0) {
+                rtt.smoothed = sample;
+                rtt.jitter = sample / 2;
+                rtt.min = sample;
+            } else {
+                const auto deviation = rtt.smoothed > sample ? rtt.smoothed - sample : sample - rtt.smoothed;
+                rtt.jitter = (3 * rtt.jitter + deviation) / 4;
+                rtt.smoothed = (7 * rtt.smoothed + sample) / 8;
+                rtt.min = (std::min)(rtt.min, sample);
+            }
+            rtt.latest = sample;
+            ++rtt.samples;
+            stats = rtt;
+            stats.missed_heartbeats = m_missed_heartbeats.load();
+        }
 
-                data += next_message;
-                needed -= next_message.length();
-            } while (needed > 0);
+        std::scoped_lock lk { m_callback_mtx };
+        if (m_on_rtt) {
+            m_on_rtt(stats);
         }
+    }
 
-        std::string payload_data { data.substr(f.payload_start, expected_payload_len) };
+    /**
+     * @brief Handles a single complete frame received from the server.
+     *
+     * @param f The frame, pointing into the inbox.
+     */
+    void process_frame(const FrameView& f)
+    {
+        const auto payload_data = f.payload;
         // Create a Message to dispatch to the m_on_message callback.
-        Message dispatch {};
-        // We do not want to send our heartbeats.
+        Message dispatch_message { .type = static_cast<Opcode>(f.opcode) };
+        // We do not want to send our heartbeats, or incomplete messages.
         bool should_dispatch { true };
 
-        // If the opcode is a message, then we need to unmask the payload.
+        // Only the first frame of a compressed message may have RSV1 set, and only if compression was negotiated.
+        if (f.rsv1 && (m_deflate == nullptr || (f.opcode != 0x1 && f.opcode != 0x2))) {
+            close(1002);
+            dispatch(Message { .type = Opcode::BAD, .data = "Received a frame with an unexpected RSV1 bit." });
+            return;
+        }
+
         switch (Opcode { f.opcode }) {
         case Opcode::BINARY:
         case Opcode::CONTINUATION:
         case Opcode::TEXT: {
-            if (f.masked) {
-                mask_payload(payload_data, f.masking_key);
+            if (m_discard_data) {
+                should_dispatch = false;
+                break;
             }
+            if (f.opcode != 0x0) {
+                m_read_compressed = f.rsv1;
+                m_read_type = Opcode { f.opcode };
+                m_read_utf8.reset();
+            }
+            // A message is always dispatched with the type of its first frame.
+            dispatch_message.type = m_read_type;
 
-            {
-                std::unique_lock lk { m_mtx };
-                m_read_buffer += payload_data;
-                if (f.fin) {
-                    // We have to return the current read buffer.
-                    dispatch.data = std::move(m_read_buffer);
-                    m_read_buffer.clear();
+            // Frames are handed out one by one when streaming, so the read buffer only ever holds the current one.
+            const auto streaming = m_zlib_stream == nullptr && has_fragment_callback();
+            const auto remaining = m_max_message_size.load() - m_read_size;
+
+            if (streaming) {
+                m_read_buffer.clear();
+            }
+
+            const auto size = m_read_buffer.size();
+            // Text is validated as it arrives, or as it is decompressed if it is compressed frame by frame.
+            const auto text = m_read_type == Opcode::TEXT;
+
+            if (text && !m_read_compressed && m_zlib_stream == nullptr && !validate_text(payload_data, f.fin)) {
+                return;
+            }
+
+            // A whole message in a single frame needs no buffer at all if it is only looked at.
+            if (f.fin && f.opcode != 0x0 && !m_read_compressed && m_zlib_stream == nullptr && !streaming
+                && payload_data.length() <= remaining && dispatch_view(m_read_type, payload_data)) {
+                should_dispatch = false;
+                break;
+            }
+            if (m_read_compressed
+                && !inflate(payload_data, f.fin, size + (std::min)(remaining, MAX_MESSAGE_SIZE - size))) {
+                if (m_read_buffer.size() - size > remaining) {
+                    reject_message();
+                    return;
                 }
+                m_read_buffer.clear();
+                close(1007);
+                dispatch_message.type = Opcode::BAD;
+                dispatch_message.data = "Could not decompress message.";
+                break;
+            }
+            const auto added = m_read_compressed ? m_read_buffer.size() - size : payload_data.length();
+
+            if (added > remaining) {
+                reject_message();
+                return;
+            }
+            if (text && m_read_compressed && !validate_text(std::string_view { m_read_buffer }.substr(size), f.fin)) {
+                return;
+            }
+            m_read_size = f.fin ? 0 : m_read_size + added;
+            if (!m_read_compressed && !streaming) {
+                m_read_buffer += payload_data;
+            }
+
+            if (streaming) {
+                dispatch_fragment(Fragment { .type = m_read_type,
+                    .data = m_read_compressed ? std::string_view { m_read_buffer } : payload_data,
+                    .first = f.opcode != 0x0,
+                    .last = f.fin });
+                should_dispatch = false;
+            } else if (!f.fin) {
+                should_dispatch = false;
+            } else if (m_zlib_stream != nullptr) {
+                should_dispatch = inflate_stream(dispatch_message)
+                    && (dispatch_message.type != Opcode::TEXT || validate_text(dispatch_message.data, true));
+            } else {
+                // We have to return the current read buffer.
+                dispatch_message.data = std::move(m_read_buffer);
+                m_read_buffer.clear();
             }
             break;
         }
         case Opcode::PING: {
             // If the opcode is PING, then we need to send a PONG.
             // A PONG consists of us sending the data we received back ensure that we are responsive.
-            if (f.masked) {
-                // We need to unmask the payload.
-                mask_payload(payload_data, f.masking_key);
-            }
-
             // Echo the payload back to the client.
             send_data(Opcode::PONG, payload_data);
-            dispatch.data = std::move(payload_data);
+            dispatch_message.data = payload_data;
             break;
         }
         case Opcode::PONG: {
             // If we received our heartbeat message, we can reset the number of missed heartbeats.
-            if (payload_data == m_heartbeat_message) {
+            if (const auto sample = heartbeat_rtt(payload_data)) {
                 m_missed_heartbeats = 0;
+                record_rtt(*sample);
                 should_dispatch = false;
             }
             break;
         }
         case Opcode::CLOSE: {
             should_dispatch = false;
-            // If the opcode is CLOSE, then we need to close the connection.
-            m_close_flags.server = 1;
+
+            {
+                std::scoped_lock lk { m_mtx };
+                // If the opcode is CLOSE, then we need to close the connection.
+                m_close_flags.server = 1;
+            }
+
+            // A close reason has to be UTF-8 like any other text, or the connection is failed.
+            if (payload_data.length() > 2 && !Utf8Validator::validate(payload_data.substr(2))) {
+                close(1007);
+                dispatch_message.type = Opcode::BAD;
+                dispatch_message.data = "Received a close reason that is not valid UTF-8.";
+                should_dispatch = true;
+                break;
+            }
 
             // If payload data is not empty, then we received information regarding why we are closing.
-            if (!payload_data.empty()) {
+            if (payload_data.length() >= 2) {
                 m_close_message.emplace();
+                m_close_message->type = Opcode::CLOSE;
                 //* MUST contain a 2-byte unsigned integer (in network byte order) representing a status code indicating
                 // the reason for closure.
                 m_close_message->code
@@ -516,139 +1772,21 @@ private:
         }
         default: {
             close();
-            dispatch.type = Opcode::BAD;
-            dispatch.data = fmt::format("Received unknown opcode: {}", std::to_string(f.opcode));
+            dispatch_message.type = Opcode::BAD;
+            dispatch_message.data = fmt::format("Received unknown opcode: {}", std::to_string(f.opcode));
             break;
         }
         }
 
-        dispatch.type = static_cast<Opcode>(f.opcode);
-
-        // Erase the message until we have processed the entire frame.
-        data.erase(0, f.payload_start + expected_payload_len);
-
-        // If there is 1 byte leftover in the message, store it.
-        if (data.length() == 1) {
-            m_leftover_byte = data[0];
-        }
-
-        {
-            std::scoped_lock lk { m_callback_mtx };
-            if (m_on_message && should_dispatch) {
-                m_on_message(dispatch);
-            }
-        }
-
-        if (!data.empty()) {
-            return process_data(data);
-        }
-    }
-
-    /**
-     * @brief Polls the WebSocket for new data, using the timeout specified on construction.
-     */
-    void poll()
-    {
-        if (m_status.load() == Status::CLOSED) {
-            return;
-        }
-
-        ssl().set_blocking(false);
-
-        if (auto data = ssl().receive(); !data.empty()) {
-            process_data(data);
-        }
-
-        ssl().set_blocking(true);
-
-        {
-            // Check if we should close the connection.
-            std::unique_lock lk { m_mtx };
-            std::string reason {};
-
-            if ((m_close_flags.client && m_close_flags.server && !reason.append("Mutual disconnection.").empty())
-                || (m_close_flags.client && std::chrono::steady_clock::now() > m_close_timeout
-                    && !reason.append("Connection closed because server took too long to send close frame.").empty())
-                || (!ssl().connected() && !reason.append("No longer connected to the socket.").empty())) {
-                lk.unlock();
-                return disconnect(m_close_message.value_or(Message { .type = Opcode::CLOSE, .data = reason }));
-            }
-        }
-
-        {
-            std::scoped_lock lk { m_mtx };
-            while (!m_write_buffer.empty()) {
-                // Because we can have data queued ahead of our CLOSE frame in the buffer, we need to be able to cancel
-                // sending that data, since when we send the CLOSE frame, we will not be able to send any more data. We
-                // can peek at the first bytes of each of our messages in the write buffer, and look for the CLOSE
-                // frame.
-
-                const auto message = std::move(m_write_buffer.front());
-                m_write_buffer.pop();
-
-                auto sent = ssl().send(message);
-
-                while (sent < message.length()) {
-                    sent += ssl().send(std::string_view { message }.substr(sent));
-                }
-                // If that message was a close frame, empty the rest of the write buffer.
-                if ((static_cast<std::byte>(message[0]) & std::byte { 0xF }) == static_cast<std::byte>(Opcode::CLOSE)) {
-                    m_close_flags.client = 1;
-                    // Start counting the timer, although we haven't sent the CLOSE frame yet.
-                    m_close_timeout = std::chrono::steady_clock::now() + TIMEOUT_INTERVAL;
-                    m_write_buffer = {};
-                }
-                // If the message was our heartbeat, notify the thread.
-                else if ((static_cast<std::byte>(message[0]) & std::byte { 0xF })
-                    == static_cast<std::byte>(Opcode::PING)) {
-                    m_heartbeat_flag.clear();
-                    m_heartbeat_flag.notify_one();
-                }
-            }
-        }
-
-        // We have completed all work to be done.
-        m_activity_flag.clear();
-        m_activity_flag.notify_one();
-        m_read_flag.clear();
-        m_read_flag.notify_one();
-    }
-
-    /**
-     * @brief Continuously sends heartbeats to the server (PING frames), to ensure the connection is still alive.
-     */
-    void heartbeat()
-    {
-        while (m_status.load() == Status::OPEN && send_data(Opcode::PING, m_heartbeat_message)) {
-            ++m_missed_heartbeats;
-            m_heartbeat_flag.test_and_set();
-            m_heartbeat_flag.wait(true);
-
-            if (m_status.load() != Status::OPEN) {
-                break;
-            }
-
-            {
-                std::unique_lock lk { m_heartbeat_mtx };
-                m_cv.wait_for(lk, HEARTBEAT_INTERVAL, [this] { return m_status.load() != Status::OPEN; });
-            }
-
-            if (m_missed_heartbeats >= 3) {
-                return disconnect(Message { .type = Opcode::CLOSE, .data = "Too many missed heartbeats." });
-            }
+        if (should_dispatch) {
+            dispatch(dispatch_message);
         }
-    }
+        // Take the buffer of the message back, so that the next one is received or decompressed without allocating.
+        auto& buffer = m_zlib_stream != nullptr ? m_stream_output : m_read_buffer;
 
-    /**
-     * @brief Waits until there is data to be read from the WebSocket. This is a blocking operation used for polling.
-     */
-    void read()
-    {
-        while ((m_status.load() != Status::CLOSED && ssl().query(true, false)) || m_status.load() == Status::CLOSING) {
-            m_read_flag.test_and_set(); // We found data to be read.
-            m_activity_flag.test_and_set(); // Notify the main thread that we have work to do.
-            m_activity_flag.notify_one();
-            m_read_flag.wait(true); // Wait for the main thread to finish processing the data.
+        if (buffer.empty() && dispatch_message.data.capacity() > buffer.capacity()) {
+            buffer = std::move(dispatch_message.data);
+            buffer.clear();
         }
     }
 
@@ -656,22 +1794,114 @@ private:
     std::atomic<Status> m_status {};
     /// The URI of the WebSocket connection.
     http::Uri m_uri {};
+    /// The "Sec-WebSocket-Key" of the current handshake.
+    /// Writes the handshake requests, and validates the responses.
+    Handshake m_handshake {};
+    /// What to add to the handshake requests.
+    http::Headers m_handshake_headers {};
+    std::vector<std::string> m_subprotocols {};
+    /// The subprotocol the server selected, and the head of its response.
+    std::string m_subprotocol {};
+    std::string m_handshake_response {};
+    /// Why the last attempt to open the connection failed, if it did.
+    std::error_code m_open_error {};
+    /// When the handshake has to be complete by.
+    std::chrono::steady_clock::time_point m_handshake_timeout {};
     /// The callback function to be called when a message is received.
     MessageCallback m_on_message {};
-    /// Buffer containing the data read from the WebSocket.
+    /// Called whenever there is new work for whoever drives the connection.
+    std::function<void()> m_wakeup {};
+    /// The waker of the loop run by start(), if it is running.
+    Waker* m_waker {};
+    /// The callback function to be called with every frame of the data messages received, if set.
+    FragmentCallback m_on_fragment {};
+    /// The callback function to be called with views of the messages received, instead of m_on_message, if set.
+    MessageViewCallback m_on_message_view {};
+    /// The storage of the messages retained from views, recycled once they are released.
+    std::shared_ptr<BufferPool> m_message_pool {
+        std::make_shared<BufferPool>(POOLED_MESSAGES, MAX_POOLED_MESSAGE_SIZE)
+    };
+    /// Buffer containing the fragments of the message being received.
     std::string m_read_buffer {};
-    /// Leftover byte from the previous read operation.
-    std::optional<uint8_t> m_leftover_byte {};
-    /// Buffer containing data to be sent to the server.
-    std::queue<std::string> m_write_buffer {};
+    /// The type of the message being received, and its size so far.
+    Opcode m_read_type {};
+    size_t m_read_size {};
+    /// The largest message accepted.
+    std::atomic_size_t m_max_message_size { MAX_MESSAGE_SIZE };
+    /// Whether or not data is being ignored, after a message that was too large.
+    bool m_discard_data {};
+    /// Whether or not the message being received is compressed.
+    bool m_read_compressed {};
+    /// Validates the TEXT message being received as it arrives.
+    Utf8Validator m_read_utf8 {};
+    /// The permessage-deflate options to offer in the next handshake.
+    std::optional<DeflateOptions> m_compression {};
+    /// The permessage-deflate options offered in the current handshake.
+    std::optional<DeflateOptions> m_offered_compression {};
+    /// The compression contexts, if the current connection negotiated permessage-deflate.
+    std::unique_ptr<PerMessageDeflate> m_deflate {};
+    /// How the server compresses the next connections as a whole.
+    TransportCompression m_transport_compression {};
+    /// The stream the current connection is decompressed with, if the server compresses it as a whole.
+    std::unique_ptr<ZlibStream> m_zlib_stream {};
+    /// Buffer that messages of the stream are decompressed into, reused from message to message.
+    std::string m_stream_output {};
+    /// Statistics about all the messages compressed and decompressed so far.
+    CompressionStats m_compression_stats {};
+    /// Whether or not the message being sent is compressed, decided by its first frame.
+    bool m_write_compressed {};
+    /// Mutex for the compression contexts, which messages are sent and received through from different threads.
+    mutable std::mutex m_deflate_mtx {};
+    /// Data received from the transport that has not been processed yet.
+    FrameParser m_inbox {};
+    /// Frames queued by send() and friends, from any thread, that the writer has not taken yet.
+    MpscQueue<OutgoingFrame> m_outbox {};
+    /// Whether or not the writer has been woken up for the frames in the outbox.
+    std::atomic_bool m_outbox_signalled {};
+    /// Data and CLOSE frames taken from the outbox, waiting to be written in order.
+    std::deque<OutgoingFrame> m_data_frames {};
+    /// PING and PONG frames, which are written before any queued data frame.
+    std::deque<OutgoingFrame> m_control_frames {};
+    /// The frames currently being written together, their total size, and how much of them has been written.
+    std::vector<OutgoingFrame> m_batch {};
+    size_t m_batch_size {};
+    size_t m_written {};
+    /// Whether or not the batch ends with a CLOSE frame.
+    bool m_batch_closes {};
+    /// The buffers handed to the transport for the batch, reused from write to write.
+    std::vector<std::string_view> m_iov {};
+    /// Completion callbacks of frames that have been written or dropped, called once m_mtx is released.
+    Completions m_completions {};
+    /// The number of bytes queued that have not been written yet.
+    std::atomic_size_t m_buffered {};
+    /// The limits of the send buffer.
+    std::atomic_size_t m_high_watermark { SendBufferOptions {}.high_watermark };
+    std::atomic_size_t m_low_watermark { SendBufferOptions {}.low_watermark };
+    OverflowPolicy m_overflow_policy { SendBufferOptions {}.policy };
+    std::chrono::milliseconds m_block_timeout { SendBufferOptions {}.block_timeout };
+    /// Whether or not a message overflowed the send buffer since it last drained.
+    std::atomic_bool m_overflowed {};
+    /// Mutex for the overflow policy, and for waiting on the send buffer to drain.
+    std::mutex m_drain_mtx {};
+    std::condition_variable m_drain_cv {};
+    /// The callback function to be called when the send buffer has drained.
+    std::function<void()> m_on_drain {};
+    /// Whether or not a message is being streamed, which no other data message may interrupt.
+    bool m_streaming {};
+    /// Counts the connections made, so that a streamed message cannot continue on a later connection.
+    std::atomic_uint64_t m_connection {};
+    /// Mutex for starting and ending streamed messages, held shared while sending a whole message.
+    std::shared_mutex m_message_mtx {};
+    /// The payload buffers of frames that have been written, for the next frames to reuse.
+    BufferPool m_buffer_pool { POOLED_BUFFERS, MAX_POOLED_BUFFER_SIZE };
     /// The URL the client is currently connected/connecting to.
     std::string m_url {};
     /// Mutex for thread safety.
     mutable std::mutex m_mtx {};
+    /// Mutex for the waker and the wakeup callback, which is never held during I/O.
+    mutable std::mutex m_wakeup_mtx {};
     /// Mutex for callbacks, needs to be recursive.
     mutable std::recursive_mutex m_callback_mtx {};
-    /// Mutex for the heartbeat sleep.
-    mutable std::mutex m_heartbeat_mtx {};
     /// Stored message for relaying the close information when connection is closed.
     std::optional<Message> m_close_message {};
     /// Flags for indicating which side has sent over the CLOSE frame.
@@ -683,28 +1913,50 @@ private:
     CloseFlags m_close_flags { 0, 0 };
     /// Close timeout, in case the server does not response with a close frame in time.
     std::chrono::steady_clock::time_point m_close_timeout {};
-    /// Atomic Flag for indicating whether there is network activity or not.
-    std::atomic_flag m_activity_flag = ATOMIC_FLAG_INIT;
-    // Atomic Flag for the read thread to be notified when to start reading again.
-    std::atomic_flag m_read_flag = ATOMIC_FLAG_INIT;
+    /// When the next heartbeat is due.
+    std::chrono::steady_clock::time_point m_next_heartbeat {};
+    /// How long the connection may go without receiving anything before it is closed, if at all.
+    std::chrono::milliseconds m_idle_timeout {};
+    /// When data was last received.
+    std::chrono::steady_clock::time_point m_last_received {};
     /// Whether or not to reconnect to the server if the connection is lost (Defaults to true).
     std::atomic_bool m_reconnect { true };
-    /// String representing the heartbeat message to send.
-    std::string m_heartbeat_message { "--heartbeat--" };
-    /// Atomic flag for the heartbeat thread to be notified when to start sending heartbeats again.
-    std::atomic_flag m_heartbeat_flag = ATOMIC_FLAG_INIT;
-    /// Condition variable for sleeping the heartbeat thread.
-    std::condition_variable m_cv {};
+    /// Wakes start() up from waiting to reconnect.
+    std::condition_variable m_reconnect_cv {};
+    ReconnectPolicy m_reconnect_policy {};
+    /// Whether or not a connection was ever established, which is what the client reconnects after losing.
+    bool m_established {};
+    /// The attempts to reconnect made since the connection was lost.
+    uint32_t m_reconnect_attempts {};
+    /// The callback function to be called when a lost connection has been re-established.
+    ReconnectCallback m_on_reconnect {};
+    /// How often heartbeats are sent, and what they look like.
+    HeartbeatOptions m_heartbeat {};
+    /// How long the server has to complete the handshake, and to answer a CLOSE frame.
+    std::chrono::milliseconds m_handshake_time_limit { TIMEOUT_INTERVAL };
+    std::chrono::milliseconds m_close_time_limit { TIMEOUT_INTERVAL };
     /// Number of missed heartbeats.
     std::atomic_uint8_t m_missed_heartbeats {};
+    /// The round-trip times measured on the current connection.
+    RttStats m_rtt_stats {};
+    /// The callback function to be called with every round-trip time sample.
+    RttCallback m_on_rtt {};
     /// Thread used for running the WebSocket client on a seperate thread, not blocking the calling thread.
     std::jthread m_running_thread {};
 };
 
+void set_reconnect_rate(double rate, size_t burst) { TokenBucket::reconnects().configure(rate, burst); }
+
 Client::Client(std::string_view url)
     : m_impl { std::make_unique<Client::Impl>(url) }
 {
 }
+
+Client::Client(std::string_view url, TransportFactory factory)
+    : m_impl { std::make_unique<Client::Impl>(url, std::move(factory)) }
+{
+}
+
 Client::Client(Client&&) noexcept = default;
 Client& Client::operator=(Client&&) noexcept = default;
 Client::~Client() = default;
@@ -713,18 +1965,274 @@ bool Client::get_automatic_reconnect() const { return m_impl->get_automatic_reco
 
 const std::string& Client::get_url() const { return m_impl->get_url(); }
 
+Status Client::status() const { return m_impl->status(); }
+
 void Client::set_automatic_reconnect(bool reconnect) const { return m_impl->set_automatic_reconnect(reconnect); }
 
+void Client::set_reconnect_policy(const ReconnectPolicy& policy) const { m_impl->set_reconnect_policy(policy); }
+
+void Client::set_on_reconnect(ReconnectCallback cb) const { m_impl->set_on_reconnect(std::move(cb)); }
+
+std::optional<std::chrono::milliseconds> Client::next_reconnect_delay() const
+{
+    return m_impl->next_reconnect_delay();
+}
+
 void Client::set_on_message(const MessageCallback& cb) const { return m_impl->set_on_message(cb); }
 
+void Client::set_on_fragment(const FragmentCallback& cb) const { m_impl->set_on_fragment(cb); }
+
+void Client::set_max_message_size(size_t size) const { m_impl->set_max_message_size(size); }
+
+void Client::set_on_message_view(const MessageViewCallback& cb) const { m_impl->set_on_message_view(cb); }
+
+MessageBuffer Client::retain(std::string_view data) const
+{
+    const auto& pool = m_impl->message_pool();
+    auto buffer = pool->acquire();
+
+    buffer.assign(data);
+    return MessageBuffer { pool, std::move(buffer) };
+}
+
+MessageBuffer::MessageBuffer(std::shared_ptr<BufferPool> pool, std::string&& buffer)
+    : m_pool { std::move(pool) }
+    , m_buffer { std::move(buffer) }
+{
+}
+
+MessageBuffer::MessageBuffer(MessageBuffer&& other) noexcept
+    : m_pool { std::move(other.m_pool) }
+    , m_buffer { std::move(other.m_buffer) }
+{
+}
+
+MessageBuffer& MessageBuffer::operator=(MessageBuffer&& other) noexcept
+{
+    if (this != &other) {
+        if (m_pool != nullptr) {
+            m_pool->release(std::move(m_buffer));
+        }
+        m_pool = std::move(other.m_pool);
+        m_buffer = std::move(other.m_buffer);
+    }
+    return *this;
+}
+
+MessageBuffer::~MessageBuffer()
+{
+    if (m_pool != nullptr) {
+        m_pool->release(std::move(m_buffer));
+    }
+}
+
 void Client::set_url(std::string_view url) const { return m_impl->set_url(url); }
 
-bool Client::send(std::string_view message) const { return m_impl->send(message); }
+void Client::set_wakeup(std::function<void()> cb) const { m_impl->set_wakeup(std::move(cb)); }
+
+void Client::set_compression(std::optional<DeflateOptions> options) const { m_impl->set_compression(options); }
+
+void Client::set_handshake_headers(const http::Headers& headers) const { m_impl->set_handshake_headers(headers); }
+
+void Client::set_subprotocols(std::vector<std::string> protocols) const
+{
+    m_impl->set_subprotocols(std::move(protocols));
+}
+
+std::string Client::subprotocol() const { return m_impl->subprotocol(); }
+
+http::Headers Client::handshake_headers() const { return m_impl->handshake_headers(); }
+
+void Client::set_transport_compression(TransportCompression compression) const
+{
+    m_impl->set_transport_compression(compression);
+}
+
+bool Client::compression_enabled() const { return m_impl->compression_enabled(); }
+
+CompressionStats Client::compression_stats() const { return m_impl->compression_stats(); }
+
+void Client::set_send_buffer(const SendBufferOptions& options) const { m_impl->set_send_buffer(options); }
+
+void Client::set_heartbeat(const HeartbeatOptions& options) const { m_impl->set_heartbeat(options); }
+
+void Client::set_timeouts(std::chrono::milliseconds handshake, std::chrono::milliseconds close) const
+{
+    m_impl->set_timeouts(handshake, close);
+}
+
+RttStats Client::rtt_stats() const { return m_impl->rtt_stats(); }
+
+void Client::set_on_rtt(RttCallback cb) const { m_impl->set_on_rtt(std::move(cb)); }
+
+void Client::set_idle_timeout(std::chrono::milliseconds timeout) const { m_impl->set_idle_timeout(timeout); }
+
+void Client::set_on_drain(std::function<void()> cb) const { m_impl->set_on_drain(std::move(cb)); }
+
+size_t Client::buffered_amount() const { return m_impl->buffered_amount(); }
+
+bool Client::send(std::string_view message) const
+{
+    std::error_code ec {};
+    return m_impl->send(Opcode::TEXT, message, {}, ec);
+}
+
+bool Client::send(std::string_view message, std::error_code& ec) const
+{
+    return m_impl->send(Opcode::TEXT, message, {}, ec);
+}
+
+bool Client::send(std::string_view message, SendCallback on_sent, std::error_code& ec) const
+{
+    return m_impl->send(Opcode::TEXT, message, std::move(on_sent), ec);
+}
+
+bool Client::send_binary(std::string_view message) const
+{
+    std::error_code ec {};
+    return m_impl->send(Opcode::BINARY, message, {}, ec);
+}
+
+bool Client::send_binary(std::string_view message, std::error_code& ec) const
+{
+    return m_impl->send(Opcode::BINARY, message, {}, ec);
+}
+
+bool Client::send_binary(std::string_view message, SendCallback on_sent, std::error_code& ec) const
+{
+    return m_impl->send(Opcode::BINARY, message, std::move(on_sent), ec);
+}
+
+Client::MessageWriter Client::begin_message(Opcode type, std::error_code& ec) const
+{
+    uint64_t connection {};
+
+    ec = m_impl->begin_message(type, connection);
+    return ec ? MessageWriter {} : MessageWriter { m_impl.get(), type, connection };
+}
+
+Client::MessageWriter::MessageWriter(Impl* impl, Opcode type, uint64_t connection)
+    : m_impl { impl }
+    , m_type { type }
+    , m_connection { connection }
+{
+}
+
+Client::MessageWriter::MessageWriter(MessageWriter&& other) noexcept
+    : m_impl { std::exchange(other.m_impl, nullptr) }
+    , m_type { other.m_type }
+    , m_connection { other.m_connection }
+    , m_started { other.m_started }
+    , m_finished { other.m_finished }
+{
+}
+
+Client::MessageWriter& Client::MessageWriter::operator=(MessageWriter&& other) noexcept
+{
+    if (this != &other) {
+        std::error_code ec {};
+
+        (void)finish(ec);
+        m_impl = std::exchange(other.m_impl, nullptr);
+        m_type = other.m_type;
+        m_connection = other.m_connection;
+        m_started = other.m_started;
+        m_finished = other.m_finished;
+    }
+    return *this;
+}
+
+Client::MessageWriter::~MessageWriter()
+{
+    std::error_code ec {};
+    (void)finish(ec);
+}
+
+bool Client::MessageWriter::write(std::string_view chunk, std::error_code& ec)
+{
+    if (chunk.empty() && m_impl != nullptr && !m_finished) {
+        ec.clear();
+        return true;
+    }
+    return send_fragment(chunk, false, ec);
+}
+
+bool Client::MessageWriter::finish(std::string_view chunk, std::error_code& ec)
+{
+    return send_fragment(chunk, true, ec);
+}
+
+bool Client::MessageWriter::finish(std::error_code& ec) { return send_fragment({}, true, ec); }
+
+bool Client::MessageWriter::send_fragment(std::string_view chunk, bool fin, std::error_code& ec)
+{
+    if (m_impl == nullptr || m_finished) {
+        ec = errors::Error::NOT_OPEN;
+        return false;
+    }
+
+    ec = m_impl->send_fragment(m_started ? Opcode::CONTINUATION : m_type, chunk, fin, m_connection);
+    if (ec) {
+        // Nothing more can be sent on a connection that is gone.
+        m_finished = ec == errors::Error::NOT_OPEN;
+        return false;
+    }
+    m_started = true;
+    m_finished = fin;
+    return true;
+}
+
+bool Client::open() const
+{
+    std::error_code ec {};
+
+    if (m_impl->open(ec)) {
+        return true;
+    }
+    throw_start_error(ec);
+    return false;
+}
+
+bool Client::open(std::error_code& ec) const { return m_impl->open(ec); }
+
+bool Client::begin_open(std::error_code& ec) const { return m_impl->begin_open(ec); }
+
+std::error_code Client::open_error() const { return m_impl->open_error(); }
+
+void Client::start() const
+{
+    std::error_code ec {};
+    m_impl->start(ec);
+    throw_start_error(ec);
+}
 
-void Client::start() const { return m_impl->start(); }
+void Client::start(std::error_code& ec) const { m_impl->start(ec); }
 
 void Client::start_async() const { return m_impl->start_async(); }
 
 void Client::close(uint16_t code, std::string_view reason) const { return m_impl->close(code, reason); }
 
+socket_t Client::fd() const { return m_impl->fd(); }
+
+Interest Client::interest() const { return m_impl->interest(); }
+
+std::optional<std::chrono::steady_clock::time_point> Client::next_deadline() const { return m_impl->next_deadline(); }
+
+void Client::on_readable() const { m_impl->on_readable(); }
+
+void Client::on_writable() const { m_impl->on_writable(); }
+
+void Client::on_timer() const { m_impl->on_timer(); }
+
+void Client::throw_start_error(const std::error_code& ec)
+{
+    // Rejected handshakes and non-WebSocket URLs have always ended the connection silently.
+    if (!ec || ec == errors::Error::HANDSHAKE_FAILED || ec == errors::Error::INVALID_SCHEME) {
+        return;
+    }
+    if (ec == errors::Error::URL_NOT_SET) {
+        throw errors::WebSocketClientError(ec.message());
+    }
+    throw errors::SslClientError(ec.message());
+}
 } // namespace ekisocket::ws
@@ -0,0 +1,704 @@
+#include <TimerWheel.hpp>
+#include <TokenBucket.hpp>
+#include <Waker.hpp>
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <ekisocket/WebSocketPool.hpp>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+namespace {
+using ekisocket::ws::Interest;
+using Clock = std::chrono::steady_clock;
+
+/// How often reactors check clients whose transport has no descriptor to poll.
+constexpr std::chrono::milliseconds FALLBACK_POLL_INTERVAL { 1 };
+/// The most events handled per wait.
+constexpr int MAX_EVENTS { 256 };
+/// The id the waker of a reactor is registered with, clients get ids from 1 onwards.
+constexpr uint64_t WAKER_ID {};
+
+[[nodiscard]] bool wants_read(Interest interest) { return (static_cast<uint8_t>(interest) & 1U) != 0; }
+
+[[nodiscard]] bool wants_write(Interest interest) { return (static_cast<uint8_t>(interest) & 2U) != 0; }
+
+/**
+ * @brief Waits for the readiness of many descriptors at once, each registered under an id.
+ */
+class Poller {
+public:
+#ifdef __linux__
+    Poller()
+        : m_epoll { epoll_create1(EPOLL_CLOEXEC) }
+    {
+    }
+
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+    Poller(Poller&&) = delete;
+    Poller& operator=(Poller&&) = delete;
+
+    ~Poller() { ::close(m_epoll); }
+
+    void add(socket_t fd, Interest interest, uint64_t id) { control(EPOLL_CTL_ADD, fd, interest, id); }
+
+    void modify(socket_t fd, Interest interest, uint64_t id) { control(EPOLL_CTL_MOD, fd, interest, id); }
+
+    void remove(socket_t fd) { (void)epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr); }
+
+    /**
+     * @brief Waits for at most timeout milliseconds, calling cb(id, readable, writable) for every ready descriptor.
+     */
+    template <typename Callback> void wait(int timeout, Callback&& cb)
+    {
+        std::array<epoll_event, MAX_EVENTS> events {};
+        const auto count = epoll_wait(m_epoll, events.data(), MAX_EVENTS, timeout);
+
+        for (int i {}; i < count; ++i) {
+            const auto& event = events[static_cast<size_t>(i)];
+            cb(event.data.u64, (event.events & READ_EVENTS) != 0, (event.events & WRITE_EVENTS) != 0);
+        }
+    }
+
+private:
+    void control(int op, socket_t fd, Interest interest, uint64_t id) const
+    {
+        epoll_event event {};
+
+        event.events = (wants_read(interest) ? READ_EVENTS : 0U) | (wants_write(interest) ? WRITE_EVENTS : 0U);
+        event.data.u64 = id;
+        (void)epoll_ctl(m_epoll, op, fd, &event);
+    }
+
+    static constexpr uint32_t READ_EVENTS { EPOLLIN | EPOLLHUP | EPOLLERR };
+    static constexpr uint32_t WRITE_EVENTS { EPOLLOUT };
+
+    int m_epoll {};
+#else
+    void add(socket_t fd, Interest interest, uint64_t id)
+    {
+        m_index[fd] = m_fds.size();
+        m_fds.push_back(pollfd { fd, events_of(interest), 0 });
+        m_ids.push_back(id);
+    }
+
+    void modify(socket_t fd, Interest interest, uint64_t id)
+    {
+        const auto i = m_index.at(fd);
+
+        m_fds[i].events = events_of(interest);
+        m_ids[i] = id;
+    }
+
+    void remove(socket_t fd)
+    {
+        const auto it = m_index.find(fd);
+
+        if (it == m_index.end()) {
+            return;
+        }
+
+        const auto i = it->second;
+
+        m_index.erase(it);
+        if (i + 1 != m_fds.size()) {
+            m_fds[i] = m_fds.back();
+            m_ids[i] = m_ids.back();
+            m_index[m_fds[i].fd] = i;
+        }
+        m_fds.pop_back();
+        m_ids.pop_back();
+    }
+
+    template <typename Callback> void wait(int timeout, Callback&& cb)
+    {
+#ifdef _WIN32
+        const auto count = static_cast<ULONG>(m_fds.size());
+#else
+        const auto count = static_cast<nfds_t>(m_fds.size());
+#endif
+        if (::poll(m_fds.data(), count, timeout) <= 0) {
+            return;
+        }
+
+        // Callbacks may modify the set, so collect the ready descriptors first.
+        std::vector<std::tuple<uint64_t, bool, bool>> ready {};
+
+        for (size_t i {}; i < m_fds.size(); ++i) {
+            if (const auto revents = m_fds[i].revents; revents != 0) {
+                ready.emplace_back(m_ids[i], (revents & (POLLIN | POLLHUP | POLLERR)) != 0, (revents & POLLOUT) != 0);
+            }
+        }
+        for (const auto& [id, readable, writable] : ready) {
+            cb(id, readable, writable);
+        }
+    }
+
+private:
+    static short events_of(Interest interest)
+    {
+        return static_cast<short>((wants_read(interest) ? POLLIN : 0) | (wants_write(interest) ? POLLOUT : 0));
+    }
+
+    std::vector<pollfd> m_fds {};
+    std::vector<uint64_t> m_ids {};
+    std::unordered_map<socket_t, size_t> m_index {};
+#endif
+};
+
+struct Reactor;
+
+/**
+ * @brief Who is currently responsible for a client of the pool.
+ */
+enum class Owner : uint8_t { NONE, WAITING, QUEUED, CONNECTOR, REACTOR };
+
+/**
+ * @brief A client owned by the pool.
+ */
+struct Entry {
+    explicit Entry(ekisocket::ws::Client c)
+        : client { std::move(c) }
+    {
+    }
+
+    ekisocket::ws::Client client;
+    /// The reactor driving the client, if any. Read without the pool lock by the wakeup callback.
+    std::atomic<Reactor*> reactor {};
+
+    // Guarded by the lock of the pool.
+    Owner owner {};
+    bool removed {};
+    /// Whether or not the client is waiting to reconnect, or reconnecting, as opposed to connecting for the first time.
+    bool reconnecting {};
+
+    // Owned by the reactor driving the client.
+    uint64_t id {};
+    socket_t fd { ~socket_t {} };
+    Interest armed {};
+    /// Fires at the next deadline of the client.
+    ekisocket::TimerWheel::Timer timer {};
+
+    // Guarded by the lock of the reactor it was marked in.
+    bool dirty {};
+};
+
+/**
+ * @brief A thread driving many connections, waiting for all of them at once.
+ */
+struct Reactor {
+    explicit Reactor(std::function<void(Entry*)> on_closed)
+        : m_on_closed { std::move(on_closed) }
+    {
+        m_poller.add(m_waker.fd(), Interest::READ, WAKER_ID);
+        m_thread = std::jthread([this](const std::stop_token& st) { run(st); });
+    }
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+    Reactor(Reactor&&) = delete;
+    Reactor& operator=(Reactor&&) = delete;
+
+    ~Reactor()
+    {
+        m_thread.request_stop();
+        m_waker.wake();
+        m_thread.join();
+    }
+
+    /**
+     * @brief Hands a connecting client over to the reactor.
+     */
+    void post(Entry* entry)
+    {
+        ++m_load;
+        {
+            std::scoped_lock lk { m_mtx };
+            m_incoming.push_back(entry);
+        }
+        m_waker.wake();
+    }
+
+    /**
+     * @brief Makes the reactor look at the client again, e.g. because a frame was queued from another thread.
+     */
+    void mark_dirty(Entry* entry)
+    {
+        {
+            std::scoped_lock lk { m_mtx };
+            if (entry->dirty) {
+                return;
+            }
+            entry->dirty = true;
+            m_dirty.push_back(entry);
+        }
+        m_waker.wake();
+    }
+
+    /**
+     * @brief Stops driving the client, if the reactor still does.
+     *
+     * @return std::future Ready once the reactor no longer touches the client.
+     */
+    std::future<void> detach_later(Entry* entry)
+    {
+        std::promise<void> done {};
+        auto ret = done.get_future();
+        {
+            std::scoped_lock lk { m_mtx };
+            m_removals.emplace_back(entry, std::move(done));
+        }
+        m_waker.wake();
+        return ret;
+    }
+
+    [[nodiscard]] size_t load() const { return m_load.load(); }
+
+    /**
+     * @brief Lets the client handle its deadline. Called by the timer of the client, on the reactor thread.
+     */
+    void on_timer(Entry* entry)
+    {
+        entry->client.on_timer();
+        update(entry);
+    }
+
+private:
+    void run(const std::stop_token& st)
+    {
+        while (!st.stop_requested()) {
+            m_poller.wait(timeout(), [this](uint64_t id, bool readable, bool writable) {
+                if (id == WAKER_ID) {
+                    m_waker.drain();
+                    return;
+                }
+                if (const auto it = m_attached.find(id); it != m_attached.end()) {
+                    drive(it->second, readable, writable);
+                }
+            });
+
+            take_incoming();
+
+            // Transports without a descriptor have to be checked every time.
+            for (const auto id : std::vector { m_fdless }) {
+                if (const auto it = m_attached.find(id); it != m_attached.end()) {
+                    drive(it->second, true, true);
+                }
+            }
+
+            (void)m_timers.advance();
+        }
+    }
+
+    /**
+     * @brief The time until the earliest timer, in milliseconds.
+     */
+    [[nodiscard]] int timeout() const
+    {
+        int ret { -1 };
+
+        if (const auto expiry = m_timers.next_expiry()) {
+            const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(*expiry - Clock::now()).count();
+            ret = static_cast<int>((std::max)(remaining, std::chrono::milliseconds::rep {}));
+        }
+        if (!m_fdless.empty() && (ret < 0 || ret > FALLBACK_POLL_INTERVAL.count())) {
+            ret = static_cast<int>(FALLBACK_POLL_INTERVAL.count());
+        }
+        return ret;
+    }
+
+    void take_incoming()
+    {
+        std::vector<Entry*> incoming {};
+        std::vector<Entry*> dirty {};
+        std::vector<std::pair<Entry*, std::promise<void>>> removals {};
+        {
+            std::scoped_lock lk { m_mtx };
+            std::swap(incoming, m_incoming);
+            std::swap(dirty, m_dirty);
+            std::swap(removals, m_removals);
+            for (auto* entry : dirty) {
+                entry->dirty = false;
+            }
+        }
+
+        for (auto* entry : incoming) {
+            attach(entry);
+        }
+        for (auto* entry : dirty) {
+            if (is_attached(entry)) {
+                // Something was queued, most writes complete right away.
+                drive(entry, false, true);
+            }
+        }
+        for (auto& [entry, done] : removals) {
+            if (is_attached(entry)) {
+                detach(entry);
+            }
+            done.set_value();
+        }
+    }
+
+    [[nodiscard]] bool is_attached(const Entry* entry) const
+    {
+        if (entry->reactor.load() != this) {
+            return false;
+        }
+
+        const auto it = m_attached.find(entry->id);
+        return it != m_attached.end() && it->second == entry;
+    }
+
+    void attach(Entry* entry)
+    {
+        entry->id = ++m_next_id;
+        entry->fd = entry->client.fd();
+        entry->armed = entry->client.interest();
+        m_attached.emplace(entry->id, entry);
+
+        if (entry->fd == ~socket_t {}) {
+            m_fdless.push_back(entry->id);
+        } else {
+            m_poller.add(entry->fd, entry->armed, entry->id);
+        }
+        // The handshake request is already queued.
+        drive(entry, false, true);
+    }
+
+    void detach(Entry* entry)
+    {
+        {
+            std::scoped_lock lk { m_mtx };
+            // Clients may have marked themselves while being driven, and may be gone by the next round.
+            if (entry->dirty) {
+                std::erase(m_dirty, entry);
+                entry->dirty = false;
+            }
+        }
+
+        if (entry->fd == ~socket_t {}) {
+            std::erase(m_fdless, entry->id);
+        } else {
+            m_poller.remove(entry->fd);
+        }
+        m_timers.cancel(entry->timer);
+        m_attached.erase(entry->id);
+        --m_load;
+    }
+
+    /**
+     * @brief Lets the client handle the readiness of its transport, then re-registers what it waits for.
+     */
+    void drive(Entry* entry, bool readable, bool writable)
+    {
+        auto& client = entry->client;
+
+        if (readable) {
+            client.on_readable();
+        }
+        // Replies such as pongs are written right away, instead of waiting for another round.
+        if (writable || wants_write(client.interest())) {
+            client.on_writable();
+        }
+        update(entry);
+    }
+
+    void update(Entry* entry)
+    {
+        auto& client = entry->client;
+
+        if (client.status() == ekisocket::ws::Status::CLOSED) {
+            detach(entry);
+            return m_on_closed(entry);
+        }
+        if (const auto interest = client.interest(); entry->fd != ~socket_t {} && interest != entry->armed) {
+            m_poller.modify(entry->fd, interest, entry->id);
+            entry->armed = interest;
+        }
+        if (const auto deadline = client.next_deadline(); !deadline) {
+            m_timers.cancel(entry->timer);
+        } else if (!entry->timer.scheduled() || entry->timer.deadline() != *deadline) {
+            m_timers.schedule(entry->timer, *deadline);
+        }
+    }
+
+    /// Called, on the reactor thread, once a client has been detached because its connection closed.
+    std::function<void(Entry*)> m_on_closed {};
+    /// The number of clients driven by, or handed over to, the reactor.
+    std::atomic_size_t m_load {};
+
+    /// Guards the hand-over lists below.
+    std::mutex m_mtx {};
+    std::vector<Entry*> m_incoming {};
+    std::vector<Entry*> m_dirty {};
+    std::vector<std::pair<Entry*, std::promise<void>>> m_removals {};
+
+    // Only touched by the reactor thread.
+    ekisocket::Waker m_waker {};
+    Poller m_poller {};
+    uint64_t m_next_id { WAKER_ID };
+    std::unordered_map<uint64_t, Entry*> m_attached {};
+    std::vector<uint64_t> m_fdless {};
+    /// The deadlines of the clients, one timer each.
+    ekisocket::TimerWheel m_timers {};
+
+    std::jthread m_thread {};
+};
+} // namespace
+
+namespace ekisocket::ws {
+struct Pool::Impl {
+    explicit Impl(size_t threads)
+    {
+        if (threads == 0) {
+            threads = (std::max)(std::thread::hardware_concurrency(), 1U);
+        }
+
+        m_reactors.reserve(threads);
+        m_connectors.reserve(threads);
+
+        for (size_t i {}; i < threads; ++i) {
+            m_reactors.push_back(std::make_unique<Reactor>([this](Entry* entry) { closed(entry); }));
+            m_connectors.emplace_back([this](const std::stop_token& st) { connect_loop(st); });
+        }
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+    Impl(Impl&&) = delete;
+    Impl& operator=(Impl&&) = delete;
+
+    ~Impl()
+    {
+        for (auto& connector : m_connectors) {
+            connector.request_stop();
+        }
+        m_connectors.clear();
+        m_reactors.clear();
+
+        // Nobody is left to wake up.
+        for (auto& entry : m_entries) {
+            entry->client.set_wakeup({});
+        }
+    }
+
+    Client& add(Client client)
+    {
+        std::scoped_lock lk { m_mtx };
+        auto& entry = *m_entries.emplace_back(std::make_unique<Entry>(std::move(client)));
+
+        entry.client.set_wakeup([e = &entry] {
+            if (auto* reactor = e->reactor.load()) {
+                reactor->mark_dirty(e);
+            }
+        });
+        // The timer is only ever scheduled by the reactor driving the client, and fires on its thread.
+        entry.timer.set_callback([e = &entry] { e->reactor.load()->on_timer(e); });
+
+        entry.owner = Owner::QUEUED;
+        m_queue.push_back(&entry);
+        m_cv.notify_all();
+        return entry.client;
+    }
+
+    void remove(const Client& client)
+    {
+        std::unique_lock lk { m_mtx };
+        const auto it = std::ranges::find_if(m_entries, [&](const auto& entry) { return &entry->client == &client; });
+
+        if (it == m_entries.end()) {
+            return;
+        }
+
+        auto* entry = it->get();
+
+        entry->removed = true;
+        while (entry->owner != Owner::NONE) {
+            switch (entry->owner) {
+            case Owner::WAITING:
+                std::erase_if(m_waiting, [entry](const auto& waiting) { return waiting.second == entry; });
+                entry->owner = Owner::NONE;
+                break;
+            case Owner::QUEUED:
+                std::erase(m_queue, entry);
+                entry->owner = Owner::NONE;
+                break;
+            case Owner::REACTOR: {
+                auto* reactor = entry->reactor.load();
+
+                lk.unlock();
+                reactor->detach_later(entry).wait();
+                lk.lock();
+                // The reactor detached it, unless it was already on its way to a reconnect.
+                if (entry->owner == Owner::REACTOR && entry->reactor.load() == reactor) {
+                    entry->reactor = nullptr;
+                    entry->owner = Owner::NONE;
+                }
+                break;
+            }
+            default:
+                m_cv.wait(lk);
+                break;
+            }
+        }
+
+        entry->client.set_wakeup({});
+        auto owned = std::move(*it);
+        m_entries.erase(it);
+        lk.unlock();
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        std::scoped_lock lk { m_mtx };
+        return m_entries.size();
+    }
+
+    [[nodiscard]] size_t thread_count() const { return m_reactors.size(); }
+
+private:
+    void connect_loop(const std::stop_token& st)
+    {
+        while (true) {
+            Entry* entry {};
+            {
+                std::unique_lock lk { m_mtx };
+                if (!next_queued(lk, st)) {
+                    return;
+                }
+                entry = m_queue.front();
+                m_queue.pop_front();
+
+                // Reconnections wait for their turn, so that a whole pool losing its connections at once does not
+                // overwhelm the server coming back.
+                const auto wait = entry->reconnecting ? ekisocket::TokenBucket::reconnects().try_acquire()
+                                                      : Clock::duration {};
+                if (wait != Clock::duration {}) {
+                    entry->owner = Owner::WAITING;
+                    m_waiting.emplace(Clock::now() + wait, entry);
+                    continue;
+                }
+                entry->owner = Owner::CONNECTOR;
+            }
+
+            std::error_code ec {};
+            const auto connecting = entry->client.begin_open(ec);
+
+            std::scoped_lock lk { m_mtx };
+            if (entry->removed) {
+                entry->owner = Owner::NONE;
+            } else if (!connecting) {
+                retry(entry);
+            } else {
+                entry->reconnecting = false;
+                auto* reactor = std::ranges::min_element(m_reactors, {}, &Reactor::load)->get();
+
+                entry->owner = Owner::REACTOR;
+                entry->reactor = reactor;
+                reactor->post(entry);
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    /**
+     * @brief Waits for a client to connect, queueing the clients whose wait to reconnect is over as it goes.
+     *
+     * @return bool Whether or not there is one, rather than the connector being stopped.
+     */
+    bool next_queued(std::unique_lock<std::mutex>& lk, const std::stop_token& st)
+    {
+        while (!st.stop_requested()) {
+            const auto now = Clock::now();
+
+            while (!m_waiting.empty() && m_waiting.begin()->first <= now) {
+                auto* entry = m_waiting.begin()->second;
+
+                m_waiting.erase(m_waiting.begin());
+                entry->owner = Owner::QUEUED;
+                m_queue.push_back(entry);
+            }
+            if (!m_queue.empty()) {
+                return true;
+            }
+
+            // Wake up early if a client has to reconnect sooner than the one waited for.
+            if (m_waiting.empty()) {
+                m_cv.wait(lk, st, [this] { return !m_queue.empty() || !m_waiting.empty(); });
+            } else {
+                const auto next = m_waiting.begin()->first;
+                m_cv.wait_until(lk, st, next, [&] { return !m_queue.empty() || m_waiting.begin()->first < next; });
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Makes a client wait to reconnect, as its reconnection policy says, or gives up on it. Requires the lock.
+     */
+    void retry(Entry* entry)
+    {
+        // Like start(), connections are only re-established if they were established in the first place.
+        if (const auto delay = entry->removed ? std::nullopt : entry->client.next_reconnect_delay()) {
+            entry->owner = Owner::WAITING;
+            entry->reconnecting = true;
+            m_waiting.emplace(Clock::now() + *delay, entry);
+        } else {
+            entry->owner = Owner::NONE;
+        }
+    }
+
+    /**
+     * @brief Decides what happens to a client whose connection closed, reconnecting it if it should be.
+     */
+    void closed(Entry* entry)
+    {
+        std::scoped_lock lk { m_mtx };
+
+        entry->reactor = nullptr;
+        retry(entry);
+        m_cv.notify_all();
+    }
+
+    /// Guards the ownership of the entries and the connect queue.
+    mutable std::mutex m_mtx {};
+    std::condition_variable_any m_cv {};
+    /// The clients of the pool.
+    std::list<std::unique_ptr<Entry>> m_entries {};
+    /// Clients waiting to be connected.
+    std::deque<Entry*> m_queue {};
+    /// Clients waiting to reconnect, by when they may.
+    std::multimap<Clock::time_point, Entry*> m_waiting {};
+    std::vector<std::unique_ptr<Reactor>> m_reactors {};
+    std::vector<std::jthread> m_connectors {};
+};
+
+Pool::Pool(size_t threads)
+    : m_impl { std::make_unique<Pool::Impl>(threads) }
+{
+}
+
+Pool::Pool(Pool&&) noexcept = default;
+Pool& Pool::operator=(Pool&&) noexcept = default;
+Pool::~Pool() = default;
+
+Client& Pool::add(Client client) const { return m_impl->add(std::move(client)); }
+
+void Pool::remove(const Client& client) const { m_impl->remove(client); }
+
+size_t Pool::size() const { return m_impl->size(); }
+
+size_t Pool::thread_count() const { return m_impl->thread_count(); }
+} // namespace ekisocket::ws
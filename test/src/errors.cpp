@@ -0,0 +1,54 @@
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <ekisocket/HttpClient.hpp>
+#include <ekisocket/SslClient.hpp>
+
+using ekisocket::errors::Error;
+
+TEST_CASE("error_code_from_enum", "[errors]")
+{
+    const std::error_code ec = Error::NOT_CONNECTED;
+
+    REQUIRE(ec.category() == ekisocket::errors::category());
+    REQUIRE(ec == Error::NOT_CONNECTED);
+    REQUIRE(ec != Error::CONNECT_FAILED);
+    REQUIRE(ec.message() == "Not connected");
+}
+
+TEST_CASE("connect_refused_does_not_throw", "[errors]")
+{
+    ekisocket::ssl::Client client("127.0.0.1", 1, false);
+    std::error_code ec {};
+
+    REQUIRE_NOTHROW(client.connect(ec));
+    REQUIRE(ec);
+    REQUIRE_FALSE(client.connected());
+    REQUIRE_THROWS_AS(client.connect(), ekisocket::errors::SslClientError);
+}
+
+TEST_CASE("send_when_not_connected", "[errors]")
+{
+    ekisocket::ssl::Client client("127.0.0.1", 1, false);
+    std::error_code ec {};
+
+    REQUIRE(client.send("data", ec) == 0);
+    REQUIRE(ec == Error::NOT_CONNECTED);
+    REQUIRE(client.receive(16, ec).empty());
+    REQUIRE(ec == Error::NOT_CONNECTED);
+}
+
+TEST_CASE("http_invalid_scheme", "[errors]")
+{
+    ekisocket::http::Client client {};
+    std::error_code ec {};
+
+    const auto res = client.request(ekisocket::http::Method::GET, "ftp://localhost/", {}, {}, ec);
+
+    REQUIRE(ec == Error::INVALID_SCHEME);
+    REQUIRE(res.status_code == 0);
+    REQUIRE_THROWS_AS(client.request(ekisocket::http::Method::GET, "ftp://localhost/", {}, {}),
+        ekisocket::errors::HttpClientError);
+}
+
+int main(int argc, char* argv[]) { return Catch::Session().run(argc, argv); }
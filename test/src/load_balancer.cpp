@@ -0,0 +1,66 @@
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <ekisocket/LoadBalancer.hpp>
+
+using ekisocket::http::Endpoint;
+using ekisocket::http::LoadBalancer;
+using ekisocket::http::Method;
+using ekisocket::http::Policy;
+
+// Nothing listens on these ports, so every connection attempt is refused right away.
+const std::vector<Endpoint> UNREACHABLE { { "http://127.0.0.1:1" }, { "http://127.0.0.1:2" } };
+
+TEST_CASE("idempotent_requests_fail_over", "[load_balancer]")
+{
+    const LoadBalancer lb { UNREACHABLE };
+    std::error_code ec {};
+
+    (void)lb.request(Method::GET, "/", {}, {}, {}, ec);
+
+    REQUIRE(ec);
+
+    // Both endpoints should have been tried.
+    for (const auto& stats : lb.stats()) {
+        REQUIRE(stats.consecutive_failures == 1);
+        REQUIRE(stats.outstanding == 0);
+        REQUIRE_FALSE(stats.ejected);
+    }
+}
+
+TEST_CASE("non_idempotent_requests_are_not_retried", "[load_balancer]")
+{
+    const LoadBalancer lb { UNREACHABLE };
+    std::error_code ec {};
+
+    (void)lb.request(Method::POST, "/", {}, "body", {}, ec);
+
+    REQUIRE(ec);
+
+    const auto stats = lb.stats();
+    REQUIRE(stats[0].consecutive_failures + stats[1].consecutive_failures == 1);
+}
+
+TEST_CASE("failing_endpoints_are_ejected", "[load_balancer]")
+{
+    const LoadBalancer lb { UNREACHABLE, Policy::CONSISTENT_HASH };
+    lb.set_ejection(1, std::chrono::minutes { 1 });
+
+    std::error_code ec {};
+    (void)lb.request(Method::GET, "/", {}, {}, "key", ec);
+
+    REQUIRE(ec);
+
+    for (const auto& stats : lb.stats()) {
+        REQUIRE(stats.ejected);
+    }
+
+    REQUIRE_THROWS_AS(lb.request(Method::GET, "/"), ekisocket::errors::HttpClientError);
+}
+
+TEST_CASE("empty_endpoints_throw", "[load_balancer]")
+{
+    REQUIRE_THROWS_AS(LoadBalancer({}), ekisocket::errors::HttpClientError);
+}
+
+int main(int argc, char* argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,58 @@
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <ekisocket/Util.hpp>
+
+namespace {
+/**
+ * @brief The straightforward definition of masking, from RFC 6455 section 5.3.
+ */
+std::string reference_mask(std::string_view data, uint32_t masking_key, size_t offset)
+{
+    std::string ret {};
+
+    for (size_t i {}; i < data.size(); ++i) {
+        ret += static_cast<char>(data[i] ^ static_cast<char>(masking_key >> (24 - (((offset + i) % 4) * 8))));
+    }
+    return ret;
+}
+} // namespace
+
+TEST_CASE("mask_matches_reference", "[mask]")
+{
+    constexpr uint32_t MASKING_KEY { 0x37FA213D };
+    std::string data(1100, '\0');
+
+    for (size_t i {}; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i * 31 + 7);
+    }
+
+    // Every combination of length, input/output misalignment and phase, so heads, bodies and tails are all covered.
+    for (const size_t len : { 0UL, 1UL, 3UL, 4UL, 7UL, 15UL, 16UL, 31UL, 33UL, 63UL, 64UL, 65UL, 127UL, 1000UL }) {
+        for (size_t misalignment {}; misalignment < 8; ++misalignment) {
+            for (size_t offset {}; offset < 4; ++offset) {
+                const std::string_view in { data.data() + misalignment, len };
+                std::string out(len + 8, '\0');
+
+                ekisocket::util::mask(in, out.data() + (8 - misalignment) % 8, MASKING_KEY, offset);
+                REQUIRE(out.substr((8 - misalignment) % 8, len) == reference_mask(in, MASKING_KEY, offset));
+            }
+        }
+    }
+}
+
+TEST_CASE("mask_in_place_roundtrip", "[mask]")
+{
+    const std::string original(4096 + 5, 'x');
+    auto data = original;
+
+    ekisocket::util::mask(data, data.data(), 0xDEADBEEF);
+    REQUIRE(data == reference_mask(original, 0xDEADBEEF, 0));
+
+    // Unmasking in two pieces gives the original back.
+    ekisocket::util::mask(std::string_view { data }.substr(0, 1001), data.data(), 0xDEADBEEF);
+    ekisocket::util::mask(std::string_view { data }.substr(1001), data.data() + 1001, 0xDEADBEEF, 1001);
+    REQUIRE(data == original);
+}
+
+int main(int argc, char* argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,71 @@
+#define CATCH_CONFIG_RUNNER
+#include <array>
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <ekisocket/Util.hpp>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+TEST_CASE("fill_random_bytes", "[random]")
+{
+    // Enough to cross several batches of blocks and a reseed.
+    std::string data(3 * 1024 * 1024, '\0');
+    std::array<size_t, 256> counts {};
+
+    ekisocket::util::fill_random(data.data(), data.size());
+    for (const auto c : data) {
+        ++counts[static_cast<uint8_t>(c)];
+    }
+
+    // Every byte value shows up about as often, 12288 times on average.
+    for (const auto count : counts) {
+        REQUIRE(count > 11000);
+        REQUIRE(count < 13600);
+    }
+}
+
+TEST_CASE("threads_have_their_own_streams", "[random]")
+{
+    std::string here(64, '\0');
+    std::string there(64, '\0');
+
+    ekisocket::util::fill_random(here.data(), here.size());
+    std::jthread([&there] { ekisocket::util::fill_random(there.data(), there.size()); }).join();
+    REQUIRE(here != there);
+}
+
+#ifndef _WIN32
+TEST_CASE("fork_reseeds", "[random]")
+{
+    std::string parent(32, '\0');
+    std::string child(32, '\0');
+    std::array<int, 2> fds {};
+
+    // Make sure the generator is seeded before forking.
+    ekisocket::util::fill_random(parent.data(), 1);
+    REQUIRE(pipe(fds.data()) == 0);
+
+    const auto pid = fork();
+    if (pid == 0) {
+        ekisocket::util::fill_random(child.data(), child.size());
+        (void)write(fds[1], child.data(), child.size());
+        _exit(0);
+    }
+
+    ekisocket::util::fill_random(parent.data(), parent.size());
+    REQUIRE(read(fds[0], child.data(), child.size()) == static_cast<ssize_t>(child.size()));
+    waitpid(pid, nullptr, 0);
+    close(fds[0]);
+    close(fds[1]);
+
+    // Without reseeding, the child would hand out the same bytes as its parent.
+    REQUIRE(parent != child);
+}
+#endif
+
+int main(int argc, char* argv[]) { return Catch::Session().run(argc, argv); }
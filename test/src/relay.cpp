@@ -0,0 +1,126 @@
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <ekisocket/HttpClient.hpp>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+/**
+ * @brief Serves a single connection on a local port, answering the first request with the given response.
+ */
+struct OneShotServer {
+    explicit OneShotServer(std::string response)
+    {
+        m_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len { sizeof(addr) };
+
+        (void)bind(m_listener, reinterpret_cast<sockaddr*>(&addr), len);
+        (void)listen(m_listener, 1);
+        (void)getsockname(m_listener, reinterpret_cast<sockaddr*>(&addr), &len);
+        port = ntohs(addr.sin_port);
+
+        m_thread = std::jthread([this, response = std::move(response)] {
+            const auto conn = accept(m_listener, nullptr, nullptr);
+            std::string request(4096, '\0');
+
+            (void)read(conn, request.data(), request.size());
+            // Send the headers and the body separately, so the body does not all arrive with the headers.
+            const auto end_of_headers = response.find("\r\n\r\n") + 4;
+            (void)write(conn, response.data(), end_of_headers);
+            std::this_thread::sleep_for(std::chrono::milliseconds { 10 });
+            (void)write(conn, response.data() + end_of_headers, response.size() - end_of_headers);
+            close(conn);
+        });
+    }
+
+    OneShotServer(const OneShotServer&) = delete;
+    OneShotServer& operator=(const OneShotServer&) = delete;
+    OneShotServer(OneShotServer&&) = delete;
+    OneShotServer& operator=(OneShotServer&&) = delete;
+
+    ~OneShotServer()
+    {
+        m_thread.join();
+        close(m_listener);
+    }
+
+    uint16_t port {};
+
+private:
+    int m_listener {};
+    std::jthread m_thread {};
+};
+
+std::string read_all(int fd)
+{
+    std::string ret {};
+    std::string buf(4096, '\0');
+
+    for (auto len = read(fd, buf.data(), buf.size()); len > 0; len = read(fd, buf.data(), buf.size())) {
+        ret.append(buf.data(), static_cast<size_t>(len));
+    }
+    return ret;
+}
+} // namespace
+
+TEST_CASE("relay_content_length", "[relay]")
+{
+    const std::string payload(20000, 'x');
+    OneShotServer server { "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(payload.size()) + "\r\n\r\n"
+        + payload };
+    std::array<int, 2> out {};
+    std::array<int, 2> mirror {};
+
+    REQUIRE(pipe(out.data()) == 0);
+    REQUIRE(pipe(mirror.data()) == 0);
+
+    ekisocket::http::Client client {};
+    std::error_code ec {};
+    const auto url = "http://127.0.0.1:" + std::to_string(server.port) + "/";
+    const auto res = client.relay(ekisocket::http::Method::GET, url, {}, {}, out[1], ec, mirror[1]);
+
+    REQUIRE_FALSE(ec);
+    REQUIRE(res.status_code == 200);
+    REQUIRE(res.body.empty());
+
+    close(out[1]);
+    close(mirror[1]);
+    REQUIRE(read_all(out[0]) == payload);
+    REQUIRE(read_all(mirror[0]) == payload);
+    close(out[0]);
+    close(mirror[0]);
+}
+
+TEST_CASE("relay_chunked", "[relay]")
+{
+    OneShotServer server {
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n"
+    };
+    std::array<int, 2> out {};
+
+    REQUIRE(pipe(out.data()) == 0);
+
+    ekisocket::http::Client client {};
+    const auto url = "http://127.0.0.1:" + std::to_string(server.port) + "/";
+    const auto res = client.relay(ekisocket::http::Method::GET, url, {}, {}, out[1]);
+
+    REQUIRE(res.status_code == 200);
+
+    close(out[1]);
+    REQUIRE(read_all(out[0]) == "hello world");
+    close(out[0]);
+}
+#endif
+
+int main(int argc, char* argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,42 @@
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <ekisocket/ShardedClient.hpp>
+#include <array>
+
+using ekisocket::http::Method;
+using ekisocket::http::ShardedClient;
+
+TEST_CASE("workers_get_every_shard", "[sharded_client]")
+{
+    const ShardedClient client { 4 };
+    std::array<std::error_code, 4> errors {};
+    std::array<size_t, 4> seen {};
+
+    client.run([&](size_t shard) {
+        seen.at(shard) = shard + 1;
+        // Nothing listens on this port, so the request fails right away.
+        (void)client.request(Method::GET, "http://127.0.0.1:1/", {}, {}, errors.at(shard));
+    });
+    client.join();
+
+    REQUIRE(client.shard_count() == 4);
+    REQUIRE(seen == std::array<size_t, 4> { 1, 2, 3, 4 });
+
+    for (const auto& ec : errors) {
+        REQUIRE(ec);
+    }
+}
+
+TEST_CASE("foreign_threads_use_their_own_shard", "[sharded_client]")
+{
+    const ShardedClient client { 1 };
+    std::error_code ec {};
+
+    (void)client.request(Method::GET, "http://127.0.0.1:1/", {}, {}, ec);
+
+    REQUIRE(ec);
+    REQUIRE_THROWS_AS(client.request(Method::GET, "http://127.0.0.1:1/"), ekisocket::errors::HttpClientError);
+}
+
+int main(int argc, char* argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,124 @@
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <ekisocket/HttpClient.hpp>
+#include <ekisocket/Transport.hpp>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using ekisocket::MemoryTransport;
+
+namespace {
+/**
+ * @brief Receives from the transport until the data ends with the given marker.
+ */
+std::string receive_until(ekisocket::Transport& transport, std::string_view marker)
+{
+    std::string ret {};
+    std::error_code ec {};
+
+    while (!ret.ends_with(marker) && transport.connected() && !ec) {
+        ret += transport.receive(4096, ec);
+    }
+    return ret;
+}
+} // namespace
+
+TEST_CASE("memory_transport_roundtrip", "[transport]")
+{
+    auto [client, server] = MemoryTransport::pair();
+    std::error_code ec {};
+
+    REQUIRE(client->connect(ec));
+    REQUIRE(server->connect(ec));
+
+    REQUIRE(client->send("hello", ec) == 5);
+    const std::array<std::string_view, 2> bufs { " wor", "ld" };
+    REQUIRE(client->sendv(bufs, ec) == 6);
+    REQUIRE(receive_until(*server, "world") == "hello world");
+
+    std::array<char, 2> buf {};
+    REQUIRE(server->send("abc", ec) == 3);
+    REQUIRE(client->receive_into(buf, ec) == 2);
+    REQUIRE(client->receive_into(buf, ec) == 1);
+    REQUIRE(buf[0] == 'c');
+
+    // Nothing to read, so a non-blocking receive returns immediately.
+    client->set_blocking(false);
+    REQUIRE(client->receive_into(buf, ec) == 0);
+    REQUIRE(client->connected());
+
+    server->close();
+    REQUIRE(client->receive_into(buf, ec) == 0);
+    REQUIRE_FALSE(ec);
+    REQUIRE_FALSE(client->connected());
+    REQUIRE(client->send("late", ec) == 0);
+    REQUIRE(ec == ekisocket::errors::Error::NOT_CONNECTED);
+}
+
+TEST_CASE("http_over_memory_transport", "[transport]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    std::string requested_host {};
+
+    std::jthread server([&server_end = server_end] {
+        std::error_code ec {};
+
+        (void)server_end->connect(ec);
+        (void)receive_until(*server_end, "\r\n\r\n");
+        (void)server_end->send("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello", ec);
+    });
+
+    ekisocket::http::Client client { [&](std::string_view host, uint16_t, bool) {
+        requested_host = host;
+        return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+    } };
+    const auto res = client.get("http://example.com/");
+
+    REQUIRE(requested_host == "example.com");
+    REQUIRE(res.status_code == 200);
+    REQUIRE(res.body == "hello");
+}
+
+#ifndef _WIN32
+TEST_CASE("unix_transport_echo", "[transport]")
+{
+    const std::string path = "/tmp/ekisocket_transport_test_" + std::to_string(getpid()) + ".sock";
+    const auto listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr {};
+
+    addr.sun_family = AF_UNIX;
+    std::ranges::copy(path, std::begin(addr.sun_path));
+    (void)unlink(path.c_str());
+    REQUIRE(bind(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0);
+    REQUIRE(listen(listener, 1) == 0);
+
+    std::jthread server([listener] {
+        const auto conn = accept(listener, nullptr, nullptr);
+        std::string buf(64, '\0');
+        const auto len = read(conn, buf.data(), buf.size());
+
+        (void)write(conn, buf.data(), static_cast<size_t>(len));
+        close(conn);
+    });
+
+    ekisocket::UnixTransport transport { path };
+    std::error_code ec {};
+
+    REQUIRE(transport.connect(ec));
+    const std::array<std::string_view, 2> bufs { "ping", "-pong" };
+    REQUIRE(transport.sendv(bufs, ec) == 9);
+    REQUIRE(receive_until(transport, "ping-pong") == "ping-pong");
+
+    server.join();
+    close(listener);
+    (void)unlink(path.c_str());
+}
+#endif
+
+int main(int argc, char* argv[]) { return Catch::Session().run(argc, argv); }
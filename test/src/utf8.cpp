@@ -0,0 +1,55 @@
+#define CATCH_CONFIG_RUNNER
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <ekisocket/Util.hpp>
+#include <string>
+
+TEST_CASE("valid_utf8", "[utf8]")
+{
+    REQUIRE(ekisocket::util::is_valid_utf8(""));
+    REQUIRE(ekisocket::util::is_valid_utf8("Hello World!"));
+    // The smallest and largest characters of every length, and the ones right around the surrogates.
+    REQUIRE(ekisocket::util::is_valid_utf8("\x7F\xC2\x80\xDF\xBF\xE0\xA0\x80\xEF\xBF\xBF"));
+    REQUIRE(ekisocket::util::is_valid_utf8("\xF0\x90\x80\x80\xF4\x8F\xBF\xBF"));
+    REQUIRE(ekisocket::util::is_valid_utf8("\xED\x9F\xBF\xEE\x80\x80"));
+    REQUIRE(ekisocket::util::is_valid_utf8("κόσμε, 世界, 😀"));
+}
+
+TEST_CASE("invalid_utf8", "[utf8]")
+{
+    // Overlong encodings, surrogates, code points above U+10FFFF, stray and missing continuation bytes.
+    const std::string_view invalid[] { "\xC0\xAF", "\xC1\xBF", "\xE0\x9F\xBF", "\xF0\x8F\xBF\xBF", "\xED\xA0\x80",
+        "\xED\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF", "\x80", "\xBF\xBF", "\xC2", "\xE2\x82",
+        "\xF0\x9F\x98", "\xC2\x41", "\xE2\x28\xA1" };
+    const std::string text(70, 'x');
+
+    for (const auto sequence : invalid) {
+        REQUIRE(!ekisocket::util::is_valid_utf8(sequence));
+
+        // At every position of a longer text, so that sequences on either side of a block boundary are covered.
+        for (size_t i {}; i <= text.size(); ++i) {
+            auto data = text;
+            data.insert(i, sequence);
+            REQUIRE(!ekisocket::util::is_valid_utf8(data));
+        }
+    }
+}
+
+TEST_CASE("multibyte_across_blocks", "[utf8]")
+{
+    const std::string_view characters[] { "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80" };
+
+    for (const auto character : characters) {
+        for (size_t i {}; i < 70; ++i) {
+            auto data = std::string(i, 'x');
+            data += character;
+            data += std::string(70 - i, 'y');
+            REQUIRE(ekisocket::util::is_valid_utf8(data));
+
+            // The same character, cut off by the end of the text.
+            REQUIRE(!ekisocket::util::is_valid_utf8(std::string_view { data }.substr(0, i + character.size() - 1)));
+        }
+    }
+}
+
+int main(int argc, char* argv[]) { return Catch::Session().run(argc, argv); }
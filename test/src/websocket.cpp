@@ -0,0 +1,1163 @@
+#define CATCH_CONFIG_RUNNER
+#include <algorithm>
+#include <atomic>
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <ekisocket/Errors.hpp>
+#include <ekisocket/Transport.hpp>
+#include <ekisocket/Util.hpp>
+#include <ekisocket/WebSocketClient.hpp>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using ekisocket::MemoryTransport;
+using ekisocket::ws::Opcode;
+
+namespace {
+/**
+ * @brief Builds an unmasked frame, as sent by a server, with a payload shorter than 126 bytes.
+ */
+std::string server_frame(Opcode opcode, std::string_view payload)
+{
+    std::string ret {};
+
+    ret.push_back(static_cast<char>(0x80 | static_cast<uint8_t>(opcode)));
+    ret.push_back(static_cast<char>(payload.size()));
+    ret += payload;
+    return ret;
+}
+
+/**
+ * @brief Receives exactly len bytes, unless the stream ends first.
+ */
+std::string receive_exact(ekisocket::Transport& transport, size_t len)
+{
+    std::string ret(len, '\0');
+    std::error_code ec {};
+    size_t received {};
+
+    while (received < len && transport.connected() && !ec) {
+        received += transport.receive_into(std::span { ret }.subspan(received), ec);
+    }
+    ret.resize(received);
+    return ret;
+}
+
+/**
+ * @brief Receives a single masked frame, as sent by a client.
+ */
+std::pair<Opcode, std::string> receive_client_frame(ekisocket::Transport& transport)
+{
+    const auto header = receive_exact(transport, 2);
+
+    if (header.size() < 2) {
+        return { Opcode::BAD, {} };
+    }
+
+    size_t length = static_cast<uint8_t>(header[1]) & 0x7FU;
+
+    if (length >= 126) {
+        const auto extended = receive_exact(transport, length == 126 ? 2 : 8);
+
+        length = 0;
+        for (const auto c : extended) {
+            length = (length << 8U) | static_cast<uint8_t>(c);
+        }
+    }
+
+    const auto key = receive_exact(transport, 4);
+    auto payload = receive_exact(transport, length);
+
+    for (size_t i {}; i < payload.size(); ++i) {
+        payload[i] = static_cast<char>(payload[i] ^ key[i % 4]);
+    }
+    return { static_cast<Opcode>(static_cast<uint8_t>(header[0]) & 0x0FU), payload };
+}
+
+/**
+ * @brief Wraps the client end of a memory pipe, counting the writes made to it.
+ */
+class CountingTransport : public ekisocket::Transport {
+public:
+    CountingTransport(std::unique_ptr<MemoryTransport> inner, size_t& writes)
+        : m_inner { std::move(inner) }
+        , m_writes { writes }
+    {
+    }
+
+    [[nodiscard]] bool connected() const override { return m_inner->connected(); }
+    bool connect(std::error_code& ec) override { return m_inner->connect(ec); }
+
+    size_t send(std::string_view data, std::error_code& ec) override
+    {
+        ++m_writes;
+        return m_inner->send(data, ec);
+    }
+
+    size_t sendv(std::span<const std::string_view> bufs, std::error_code& ec) override
+    {
+        ++m_writes;
+        return m_inner->sendv(bufs, ec);
+    }
+
+    size_t receive_into(std::span<char> buf, std::error_code& ec) override { return m_inner->receive_into(buf, ec); }
+    [[nodiscard]] bool wait(bool want_read, bool want_write) const override
+    {
+        return m_inner->wait(want_read, want_write);
+    }
+    void set_timeout(int milliseconds) override { m_inner->set_timeout(milliseconds); }
+    [[nodiscard]] int timeout() const override { return m_inner->timeout(); }
+    void close() override { m_inner->close(); }
+
+private:
+    std::unique_ptr<MemoryTransport> m_inner {};
+    size_t& m_writes;
+};
+
+/**
+ * @brief Accepts the handshake on the server end of the pipe, sending the extra data right behind the response.
+ *
+ * @return std::string The handshake request.
+ */
+std::string accept_handshake(MemoryTransport& server, std::string_view extra, std::string_view headers = {})
+{
+    std::error_code ec {};
+    std::string request {};
+
+    (void)server.connect(ec);
+    while (!request.ends_with("\r\n\r\n") && !ec) {
+        request += server.receive(4096, ec);
+    }
+
+    const auto key_start = request.find("Sec-WebSocket-Key: ") + 19;
+    const auto key = request.substr(key_start, request.find("\r\n", key_start) - key_start);
+
+    (void)server.send("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                      "Sec-WebSocket-Accept: "
+            + ekisocket::util::compute_accept(key) + "\r\n" + std::string { headers } + "\r\n" + std::string { extra },
+        ec);
+    return request;
+}
+} // namespace
+
+TEST_CASE("event_loop_driven_client", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    std::vector<ekisocket::ws::Message> messages {};
+    size_t wakeups {};
+
+    client.set_automatic_reconnect(false);
+    client.set_on_message([&](const ekisocket::ws::Message& message) { messages.push_back(message); });
+    client.set_wakeup([&] { ++wakeups; });
+
+    {
+        std::jthread server([&server_end = server_end] {
+            accept_handshake(*server_end, server_frame(Opcode::TEXT, "hello"));
+        });
+        REQUIRE(client.open());
+    }
+
+    // The frame that arrived together with the handshake response is dispatched right away.
+    REQUIRE(client.status() == ekisocket::ws::Status::OPEN);
+    REQUIRE(messages.size() == 2);
+    REQUIRE(messages[0].type == Opcode::OPEN);
+    REQUIRE(messages[1].type == Opcode::TEXT);
+    REQUIRE(messages[1].data == "hello");
+
+    // The first heartbeat is due immediately.
+    REQUIRE(client.next_deadline().has_value());
+    client.on_timer();
+    REQUIRE(client.interest() == ekisocket::ws::Interest::READ_WRITE);
+    client.on_writable();
+    REQUIRE(client.interest() == ekisocket::ws::Interest::READ);
+    const auto [ping_type, ping] = receive_client_frame(*server_end);
+    REQUIRE(ping_type == Opcode::PING);
+
+    // A fragmented message is only dispatched once it is complete, even if it arrives a byte at a time.
+    std::error_code ec {};
+    auto first_fragment = server_frame(Opcode::TEXT, "wor");
+    first_fragment[0] = static_cast<char>(static_cast<uint8_t>(first_fragment[0]) & 0x7FU);
+    const auto fragments = server_frame(Opcode::PONG, ping) + first_fragment + server_frame(Opcode::CONTINUATION, "ld");
+
+    for (const auto c : fragments) {
+        (void)server_end->send(std::string_view { &c, 1 }, ec);
+        client.on_readable();
+    }
+    REQUIRE(messages.size() == 3);
+    REQUIRE(messages[2].data == "world");
+
+    const auto before = wakeups;
+    REQUIRE(client.send("echo"));
+    REQUIRE(wakeups > before);
+    client.on_writable();
+    REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::TEXT, std::string { "echo" } });
+
+    // The server initiates the close, the client answers and disconnects.
+    (void)server_end->send(server_frame(Opcode::CLOSE, std::string { "\x03\xE8" "bye", 5 }), ec);
+    client.on_readable();
+    client.on_writable();
+    REQUIRE(receive_client_frame(*server_end).first == Opcode::CLOSE);
+    REQUIRE(client.status() == ekisocket::ws::Status::CLOSED);
+    REQUIRE(client.interest() == ekisocket::ws::Interest::NONE);
+    REQUIRE(messages.back().type == Opcode::CLOSE);
+    REQUIRE(messages.back().code == 1000);
+    REQUIRE(messages.back().data == "bye");
+}
+
+TEST_CASE("start_async_client", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    std::mutex mtx {};
+    std::vector<ekisocket::ws::Message> messages {};
+
+    client.set_automatic_reconnect(false);
+    client.set_on_message([&](const ekisocket::ws::Message& message) {
+        std::scoped_lock lk { mtx };
+        messages.push_back(message);
+    });
+
+    std::jthread server([&server_end = server_end] {
+        std::error_code ec {};
+
+        accept_handshake(*server_end, {});
+        // Echo everything until the client closes.
+        while (true) {
+            const auto [type, payload] = receive_client_frame(*server_end);
+
+            if (type == Opcode::CLOSE || type == Opcode::BAD) {
+                (void)server_end->send(server_frame(Opcode::CLOSE, payload), ec);
+                break;
+            }
+            (void)server_end->send(server_frame(type == Opcode::PING ? Opcode::PONG : type, payload), ec);
+        }
+    });
+
+    client.start_async();
+    while (client.status() != ekisocket::ws::Status::OPEN) {
+        std::this_thread::yield();
+    }
+    REQUIRE(client.send("echo"));
+
+    const auto has_echo = [&] {
+        std::scoped_lock lk { mtx };
+        return std::ranges::any_of(messages, [](const auto& message) { return message.data == "echo"; });
+    };
+    while (!has_echo()) {
+        std::this_thread::yield();
+    }
+
+    client.close();
+    server.join();
+    while (client.status() != ekisocket::ws::Status::CLOSED) {
+        std::this_thread::yield();
+    }
+
+    std::scoped_lock lk { mtx };
+    REQUIRE(messages.front().type == Opcode::OPEN);
+    REQUIRE(messages.back().type == Opcode::CLOSE);
+    REQUIRE(messages.back().code == 1000);
+}
+
+TEST_CASE("large_frames", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+
+    client.set_automatic_reconnect(false);
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    client.on_writable();
+    REQUIRE(receive_client_frame(*server_end).first == Opcode::PING);
+
+    // Payloads needing 2 and 8 byte lengths, each sent and reused from the buffer pool a few times.
+    for (const size_t size : { 300UL, 70000UL, 300UL, 70000UL }) {
+        std::string message(size, '\0');
+        for (size_t i {}; i < size; ++i) {
+            message[i] = static_cast<char>('a' + i % 26);
+        }
+
+        REQUIRE(client.send(message));
+        client.on_writable();
+        REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::TEXT, message });
+    }
+}
+
+TEST_CASE("coalesced_writes", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    size_t writes {};
+    ekisocket::ws::Client client { "ws://example.com/",
+        [&client_end = client_end, &writes](std::string_view, uint16_t, bool) {
+            return std::make_unique<CountingTransport>(std::move(client_end), writes);
+        } };
+
+    client.set_automatic_reconnect(false);
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    constexpr size_t MESSAGES { 500 };
+    for (size_t i {}; i < MESSAGES; ++i) {
+        REQUIRE(client.send(std::to_string(i)));
+    }
+
+    // A PING from the server is answered ahead of the queued messages.
+    std::error_code ec {};
+    (void)server_end->send(server_frame(Opcode::PING, "ping"), ec);
+    client.on_readable();
+    client.close();
+    REQUIRE(client.send("after close"));
+
+    writes = 0;
+    client.on_writable();
+    REQUIRE(writes == 1);
+
+    REQUIRE(receive_client_frame(*server_end).first == Opcode::PING);
+    REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::PONG, std::string { "ping" } });
+    for (size_t i {}; i < MESSAGES; ++i) {
+        REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::TEXT, std::to_string(i) });
+    }
+
+    // Nothing queued behind the CLOSE frame is sent.
+    REQUIRE(receive_client_frame(*server_end).first == Opcode::CLOSE);
+    REQUIRE(client.interest() == ekisocket::ws::Interest::READ);
+}
+
+TEST_CASE("concurrent_senders", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+
+    client.set_automatic_reconnect(false);
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    constexpr size_t THREADS { 8 };
+    constexpr size_t MESSAGES { 1000 };
+    std::atomic_size_t done {};
+
+    {
+        // Threads keep sending while the frames are being written, without waiting on the writer.
+        std::vector<std::jthread> senders {};
+        for (size_t t {}; t < THREADS; ++t) {
+            senders.emplace_back([&client, &done, t] {
+                for (size_t i {}; i < MESSAGES; ++i) {
+                    (void)client.send(std::to_string(t) + ":" + std::to_string(i));
+                }
+                ++done;
+            });
+        }
+        while (done < THREADS) {
+            client.on_writable();
+        }
+    }
+    client.on_writable();
+    REQUIRE(client.interest() == ekisocket::ws::Interest::READ);
+
+    // Every message arrives, and the messages of each thread stay in the order they were sent.
+    std::vector<size_t> next(THREADS);
+    REQUIRE(receive_client_frame(*server_end).first == Opcode::PING);
+    for (size_t i {}; i < THREADS * MESSAGES; ++i) {
+        const auto [type, data] = receive_client_frame(*server_end);
+        const auto separator = data.find(':');
+
+        REQUIRE(type == Opcode::TEXT);
+        const auto thread = std::stoul(data.substr(0, separator));
+        REQUIRE(std::stoul(data.substr(separator + 1)) == next[thread]++);
+    }
+}
+
+TEST_CASE("send_buffer", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    using ekisocket::errors::Error;
+    using ekisocket::ws::OverflowPolicy;
+
+    client.set_automatic_reconnect(false);
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    // The first heartbeat, its prefix followed by a timestamp, is buffered until it is written.
+    REQUIRE(client.buffered_amount() == 27);
+    client.on_writable();
+    REQUIRE(client.buffered_amount() == 0);
+    REQUIRE(receive_client_frame(*server_end).first == Opcode::PING);
+
+    std::vector<std::error_code> results {};
+    const auto on_sent = [&results](const std::error_code& ec) { results.push_back(ec); };
+    bool drained {};
+    std::error_code ec {};
+
+    client.set_on_drain([&drained] { drained = true; });
+
+    // Frames of 50 bytes, two of which fit.
+    const std::string first(44, '1');
+    const std::string second(44, '2');
+    const std::string third(44, '3');
+
+    client.set_send_buffer({ .high_watermark = 100, .low_watermark = 0, .policy = OverflowPolicy::FAIL });
+    REQUIRE(client.send(first, on_sent, ec));
+    REQUIRE(client.send(second, on_sent, ec));
+    REQUIRE(client.buffered_amount() == 100);
+    REQUIRE(!client.send(third, on_sent, ec));
+    REQUIRE(ec == Error::BUFFER_FULL);
+    REQUIRE(results.empty());
+
+    client.on_writable();
+    REQUIRE(results == std::vector<std::error_code>(2));
+    REQUIRE(drained);
+    REQUIRE(client.buffered_amount() == 0);
+    REQUIRE(receive_client_frame(*server_end).second == first);
+    REQUIRE(receive_client_frame(*server_end).second == second);
+
+    // The oldest message makes room for the new one.
+    results.clear();
+    client.set_send_buffer({ .high_watermark = 100, .low_watermark = 0, .policy = OverflowPolicy::DROP_OLDEST });
+    REQUIRE(client.send(first, on_sent, ec));
+    REQUIRE(client.send(second, on_sent, ec));
+    REQUIRE(client.send(third, on_sent, ec));
+    REQUIRE(results == std::vector<std::error_code> { Error::BUFFER_FULL });
+    client.on_writable();
+    REQUIRE(receive_client_frame(*server_end).second == second);
+    REQUIRE(receive_client_frame(*server_end).second == third);
+
+    // A blocked sender gives up at its deadline, or goes through once the buffer drains.
+    client.set_send_buffer({ .high_watermark = 100,
+        .low_watermark = 0,
+        .policy = OverflowPolicy::BLOCK,
+        .block_timeout = std::chrono::milliseconds { 10 } });
+    REQUIRE(client.send(first));
+    REQUIRE(client.send(second));
+    REQUIRE(!client.send(third, ec));
+    REQUIRE(ec == std::errc::timed_out);
+
+    client.set_send_buffer({ .high_watermark = 100, .low_watermark = 0, .policy = OverflowPolicy::BLOCK });
+
+    std::atomic_bool done {};
+    bool sent {};
+    {
+        std::jthread sender([&client, &third, &done, &sent] {
+            sent = client.send(third);
+            done = true;
+        });
+        while (!done) {
+            client.on_writable();
+        }
+    }
+    REQUIRE(sent);
+    client.on_writable();
+    REQUIRE(receive_client_frame(*server_end).second == first);
+    REQUIRE(receive_client_frame(*server_end).second == second);
+    REQUIRE(receive_client_frame(*server_end).second == third);
+}
+
+TEST_CASE("streamed_message", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    using ekisocket::errors::Error;
+
+    client.set_automatic_reconnect(false);
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    std::error_code ec {};
+
+    REQUIRE(client.send_binary(std::string { "\x00\xFF", 2 }));
+    client.on_writable();
+    REQUIRE(receive_client_frame(*server_end).first == Opcode::PING);
+    REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::BINARY, std::string { "\x00\xFF", 2 } });
+
+    {
+        auto writer = client.begin_message(Opcode::BINARY, ec);
+        REQUIRE(!ec);
+
+        // Nothing else may be sent until the message is finished.
+        (void)client.begin_message(Opcode::TEXT, ec);
+        REQUIRE(ec == Error::MESSAGE_IN_PROGRESS);
+        REQUIRE(!client.send("text", ec));
+        REQUIRE(ec == Error::MESSAGE_IN_PROGRESS);
+
+        REQUIRE(writer.write("ab", ec));
+        REQUIRE(writer.write({}, ec));
+        client.on_writable();
+
+        // A PING arriving in the middle of the message is answered between its frames.
+        (void)server_end->send(server_frame(Opcode::PING, "ping"), ec);
+        client.on_readable();
+        REQUIRE(writer.write("cd", ec));
+        // The rest of the message is sent when the writer goes away.
+    }
+    client.on_writable();
+
+    REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::BINARY, std::string { "ab" } });
+    REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::PONG, std::string { "ping" } });
+    REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::CONTINUATION, std::string { "cd" } });
+    REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::CONTINUATION, std::string {} });
+
+    REQUIRE(client.send("after", ec));
+    client.on_writable();
+    REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::TEXT, std::string { "after" } });
+}
+
+TEST_CASE("fragmented_receive", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    std::vector<ekisocket::ws::Message> messages {};
+    std::vector<std::tuple<Opcode, std::string, bool, bool>> fragments {};
+
+    client.set_automatic_reconnect(false);
+    client.set_on_message([&](const ekisocket::ws::Message& message) { messages.push_back(message); });
+    client.set_on_fragment([&](const ekisocket::ws::Fragment& fragment) {
+        fragments.emplace_back(fragment.type, fragment.data, fragment.first, fragment.last);
+    });
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    auto first = server_frame(Opcode::TEXT, "ab");
+    auto middle = server_frame(Opcode::CONTINUATION, "cd");
+    const auto last = server_frame(Opcode::CONTINUATION, "ef");
+    first[0] = static_cast<char>(Opcode::TEXT);
+    middle[0] = static_cast<char>(Opcode::CONTINUATION);
+
+    // Every frame is delivered as soon as it arrives.
+    std::error_code ec {};
+    (void)server_end->send(first, ec);
+    client.on_readable();
+    REQUIRE(fragments.size() == 1);
+    (void)server_end->send(middle + last, ec);
+    client.on_readable();
+    REQUIRE(fragments
+        == std::vector<std::tuple<Opcode, std::string, bool, bool>> {
+            { Opcode::TEXT, "ab", true, false },
+            { Opcode::TEXT, "cd", false, false },
+            { Opcode::TEXT, "ef", false, true },
+        });
+
+    // Without the callback, the message is delivered whole, with the type of its first frame.
+    client.set_on_fragment({});
+    (void)server_end->send(first + middle + last, ec);
+    client.on_readable();
+    REQUIRE(messages.back().type == Opcode::TEXT);
+    REQUIRE(messages.back().data == "abcdef");
+
+    // A message that grows past the maximum size closes the connection.
+    client.set_max_message_size(5);
+    (void)server_end->send(first + middle + last, ec);
+    client.on_readable();
+    REQUIRE(messages.back().type == Opcode::BAD);
+    REQUIRE(client.status() == ekisocket::ws::Status::CLOSING);
+
+    client.on_writable();
+    REQUIRE(receive_client_frame(*server_end).first == Opcode::PING);
+    REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::CLOSE, std::string { "\x03\xF1", 2 } });
+}
+
+TEST_CASE("max_message_size", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    std::vector<ekisocket::ws::Message> messages {};
+
+    client.set_automatic_reconnect(false);
+    client.set_on_message([&](const ekisocket::ws::Message& message) { messages.push_back(message); });
+    client.set_max_message_size(100);
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    // A frame announcing 300 bytes is rejected as soon as its header arrives, and the rest of it is skipped.
+    std::error_code ec {};
+    (void)server_end->send(std::string { "\x82\x7E\x01\x2C", 4 } + std::string(50, 'x'), ec);
+    client.on_readable();
+    REQUIRE(messages.back().type == Opcode::BAD);
+    REQUIRE(client.status() == ekisocket::ws::Status::CLOSING);
+
+    (void)server_end->send(std::string(250, 'x') + server_frame(Opcode::CLOSE, "\x03\xF1"), ec);
+    client.on_readable();
+    client.on_writable();
+    REQUIRE(client.status() == ekisocket::ws::Status::CLOSED);
+    REQUIRE(messages.back().type == Opcode::CLOSE);
+    REQUIRE(messages.back().code == 1009);
+}
+
+TEST_CASE("idle_timeout", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+
+    client.set_automatic_reconnect(false);
+    client.set_idle_timeout(std::chrono::milliseconds { 50 });
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    client.on_writable();
+    REQUIRE(receive_client_frame(*server_end).first == Opcode::PING);
+
+    // The idle timeout comes long before the next heartbeat.
+    const auto deadline = client.next_deadline();
+    REQUIRE(deadline.has_value());
+    REQUIRE(*deadline <= std::chrono::steady_clock::now() + std::chrono::milliseconds { 50 });
+
+    // Receiving anything pushes it back.
+    std::error_code ec {};
+    std::this_thread::sleep_for(std::chrono::milliseconds { 10 });
+    (void)server_end->send(server_frame(Opcode::TEXT, "hi"), ec);
+    client.on_readable();
+    REQUIRE(client.next_deadline() > deadline);
+
+    std::this_thread::sleep_until(*client.next_deadline());
+    client.on_timer();
+    REQUIRE(client.status() == ekisocket::ws::Status::CLOSING);
+    client.on_writable();
+    REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::CLOSE, std::string { "\x03\xE8Idle timeout." } });
+}
+
+TEST_CASE("heartbeat_rtt", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    std::vector<ekisocket::ws::RttStats> samples {};
+
+    client.set_automatic_reconnect(false);
+    client.set_heartbeat({ .interval = std::chrono::milliseconds { 20 }, .max_missed = 2, .payload_prefix = "hb" });
+    client.set_on_rtt([&](const ekisocket::ws::RttStats& stats) { samples.push_back(stats); });
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    // The ping carries the time it was sent, which the pong echoes.
+    client.on_writable();
+    const auto [opcode, payload] = receive_client_frame(*server_end);
+    REQUIRE(opcode == Opcode::PING);
+    REQUIRE(payload.size() == 10);
+    REQUIRE(payload.starts_with("hb"));
+    REQUIRE(client.rtt_stats().missed_heartbeats == 1);
+
+    std::error_code ec {};
+    std::this_thread::sleep_for(std::chrono::milliseconds { 5 });
+    (void)server_end->send(server_frame(Opcode::PONG, payload), ec);
+    client.on_readable();
+
+    const auto stats = client.rtt_stats();
+    REQUIRE(stats.samples == 1);
+    REQUIRE(stats.latest >= std::chrono::milliseconds { 5 });
+    REQUIRE(stats.smoothed == stats.latest);
+    REQUIRE(stats.min == stats.latest);
+    REQUIRE(stats.missed_heartbeats == 0);
+    REQUIRE(samples.size() == 1);
+    REQUIRE(samples.back().latest == stats.latest);
+
+    // Two unanswered pings are tolerated, the third heartbeat drops the connection.
+    for (int i {}; i < 2; ++i) {
+        std::this_thread::sleep_until(*client.next_deadline());
+        client.on_timer();
+        client.on_writable();
+        REQUIRE(receive_client_frame(*server_end).first == Opcode::PING);
+    }
+    REQUIRE(client.rtt_stats().missed_heartbeats == 2);
+
+    std::this_thread::sleep_until(*client.next_deadline());
+    client.on_timer();
+    REQUIRE(client.status() != ekisocket::ws::Status::OPEN);
+    REQUIRE(samples.size() == 1);
+}
+
+TEST_CASE("reconnect_backoff", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+
+    client.set_reconnect_policy({ .initial_delay = std::chrono::milliseconds { 100 },
+        .max_delay = std::chrono::milliseconds { 400 },
+        .multiplier = 2,
+        .max_attempts = 4 });
+
+    // There is nothing to reconnect to before a connection has been established.
+    REQUIRE(!client.next_reconnect_delay());
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    // The ceiling doubles with every attempt, up to the cap, and the attempts run out.
+    for (const auto ceiling : { 100, 200, 400, 400 }) {
+        const auto delay = client.next_reconnect_delay();
+        REQUIRE(delay.has_value());
+        REQUIRE(delay->count() >= 0);
+        REQUIRE(delay->count() <= ceiling);
+    }
+    REQUIRE(!client.next_reconnect_delay());
+
+    client.set_reconnect_policy({});
+    client.set_automatic_reconnect(false);
+    REQUIRE(!client.next_reconnect_delay());
+}
+
+TEST_CASE("handshake_response", "[websocket]")
+{
+    // The example of RFC 6455 section 1.3.
+    REQUIRE(ekisocket::util::compute_accept("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+
+    // Header names and values are case-insensitive, and Connection is a list of tokens.
+    const std::tuple<std::string_view, std::string_view, bool> responses[] {
+        { "HTTP/1.1 101 Switching Protocols", "upgrade: WebSocket\r\nconnection: keep-alive, upgrade\r\n", true },
+        { "HTTP/1.1 101 Switching Protocols", "Upgrade: websocket\r\n", false },
+        { "HTTP/1.1 101 Switching Protocols", "Connection: Upgrade\r\n", false },
+        { "HTTP/1.1 200 OK", "Upgrade: websocket\r\nConnection: Upgrade\r\n", false },
+        { "HTTP/1.1 1010 Switching Protocols", "Upgrade: websocket\r\nConnection: Upgrade\r\n", false },
+    };
+
+    for (const auto& [status_line, headers, valid] : responses) {
+        auto [client_end, server_end] = MemoryTransport::pair();
+        ekisocket::ws::Client client { "ws://example.com:8080/chat?room=1",
+            [&client_end = client_end](std::string_view, uint16_t, bool) {
+                return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+            } };
+        std::string request {};
+
+        client.set_automatic_reconnect(false);
+
+        std::jthread server([&, &server_end = server_end, status_line = status_line, headers = headers] {
+            std::error_code ec {};
+
+            (void)server_end->connect(ec);
+            while (!request.ends_with("\r\n\r\n") && !ec) {
+                request += server_end->receive(4096, ec);
+            }
+
+            const auto key_start = request.find("Sec-WebSocket-Key: ") + 19;
+            const auto key = request.substr(key_start, request.find("\r\n", key_start) - key_start);
+
+            (void)server_end->send(std::string { status_line } + "\r\n" + std::string { headers }
+                    + "Sec-WebSocket-Accept: " + ekisocket::util::compute_accept(key) + "\r\n\r\n",
+                ec);
+        });
+
+        std::error_code ec {};
+        REQUIRE(client.open(ec) == valid);
+        REQUIRE(ec == (valid ? std::error_code {} : ekisocket::errors::Error::HANDSHAKE_FAILED));
+        server.join();
+
+        REQUIRE(request.starts_with("GET /chat?room=1 HTTP/1.1\r\nHost: example.com:8080\r\n"));
+        REQUIRE(request.find("Sec-WebSocket-Key: ") != std::string::npos);
+    }
+}
+
+TEST_CASE("handshake_headers_and_subprotocols", "[websocket]")
+{
+    for (const auto selected : { "v1.chat", "v3.chat" }) {
+        auto [client_end, server_end] = MemoryTransport::pair();
+        ekisocket::ws::Client client { "ws://example.com/",
+            [&client_end = client_end](std::string_view, uint16_t, bool) {
+                return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+            } };
+        std::string request {};
+
+        client.set_automatic_reconnect(false);
+        client.set_handshake_headers({ { "Authorization", "Bearer token" }, { "Host", "elsewhere.com" } });
+        client.set_subprotocols({ "v2.chat", "v1.chat" });
+
+        std::error_code ec {};
+        {
+            std::jthread server([&, &server_end = server_end] {
+                request = accept_handshake(*server_end, {},
+                    "Sec-WebSocket-Protocol: " + std::string { selected } + "\r\nX-Session: 42\r\n");
+            });
+            (void)client.open(ec);
+        }
+
+        // The handshake headers cannot be overridden.
+        REQUIRE(request.find("Authorization: Bearer token\r\n") != std::string::npos);
+        REQUIRE(request.find("Sec-WebSocket-Protocol: v2.chat, v1.chat\r\n") != std::string::npos);
+        REQUIRE(request.find("Host: example.com\r\n") != std::string::npos);
+        REQUIRE(request.find("elsewhere.com") == std::string::npos);
+
+        // Only a subprotocol that was offered can be selected.
+        if (std::string_view { selected } == "v1.chat") {
+            REQUIRE(!ec);
+            REQUIRE(client.subprotocol() == "v1.chat");
+            REQUIRE(client.handshake_headers().at("x-session") == "42");
+            REQUIRE(client.handshake_headers().at("Upgrade") == "websocket");
+        } else {
+            REQUIRE(ec == ekisocket::errors::Error::HANDSHAKE_FAILED);
+        }
+    }
+}
+
+TEST_CASE("invalid_utf8", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    std::vector<ekisocket::ws::Message> messages {};
+
+    client.set_automatic_reconnect(false);
+    client.set_on_message([&](const ekisocket::ws::Message& message) { messages.push_back(message); });
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    // A character split between two frames is fine.
+    auto first = server_frame(Opcode::TEXT, "h\xC3");
+    first[0] = static_cast<char>(Opcode::TEXT);
+
+    std::error_code ec {};
+    (void)server_end->send(first + server_frame(Opcode::CONTINUATION, "\xA9llo"), ec);
+    client.on_readable();
+    REQUIRE(messages.back().type == Opcode::TEXT);
+    REQUIRE(messages.back().data == "h\xC3\xA9llo");
+
+    // A surrogate is not, and is caught in the first frame, without waiting for the rest of the message.
+    first = server_frame(Opcode::TEXT, "ok \xED\xA0\x80");
+    first[0] = static_cast<char>(Opcode::TEXT);
+
+    (void)server_end->send(first, ec);
+    client.on_readable();
+    REQUIRE(messages.back().type == Opcode::BAD);
+    REQUIRE(client.status() == ekisocket::ws::Status::CLOSING);
+
+    // The rest of the message is ignored, and the server echoes the close code.
+    (void)server_end->send(server_frame(Opcode::CONTINUATION, "!") + server_frame(Opcode::CLOSE, "\x03\xEF"), ec);
+    client.on_readable();
+    client.on_writable();
+    REQUIRE(client.status() == ekisocket::ws::Status::CLOSED);
+    REQUIRE(messages.back().type == Opcode::CLOSE);
+    REQUIRE(messages.back().code == 1007);
+}
+
+TEST_CASE("invalid_close_reason", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    std::vector<ekisocket::ws::Message> messages {};
+
+    client.set_automatic_reconnect(false);
+    client.set_on_message([&](const ekisocket::ws::Message& message) { messages.push_back(message); });
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    std::error_code ec {};
+    (void)server_end->send(server_frame(Opcode::CLOSE, "\x03\xE8 bye \xC0\xAF"), ec);
+    client.on_readable();
+    REQUIRE(messages.back().type == Opcode::BAD);
+
+    // The client answers with 1007 rather than echoing the server.
+    client.on_writable();
+    REQUIRE(receive_client_frame(*server_end).first == Opcode::PING);
+
+    const auto [opcode, payload] = receive_client_frame(*server_end);
+    REQUIRE(opcode == Opcode::CLOSE);
+    REQUIRE(payload == "\x03\xEF");
+}
+
+TEST_CASE("message_view", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    std::vector<std::pair<Opcode, ekisocket::ws::MessageBuffer>> messages {};
+    bool called {};
+
+    client.set_automatic_reconnect(false);
+    client.set_on_message([&called](const ekisocket::ws::Message&) { called = true; });
+    client.set_on_message_view([&](const ekisocket::ws::MessageView& message) {
+        messages.emplace_back(message.type, client.retain(message.data));
+    });
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    const std::string large(100, 'x');
+    auto first = server_frame(Opcode::TEXT, "ab");
+    first[0] = static_cast<char>(Opcode::TEXT);
+
+    std::error_code ec {};
+    (void)server_end->send(server_frame(Opcode::BINARY, large) + first + server_frame(Opcode::CONTINUATION, "cd"), ec);
+    client.on_readable();
+
+    REQUIRE(!called);
+    REQUIRE(messages.size() == 3);
+    REQUIRE(messages[0].first == Opcode::OPEN);
+    REQUIRE(messages[1].first == Opcode::BINARY);
+    REQUIRE(messages[1].second.data() == large);
+    REQUIRE(messages[2].first == Opcode::TEXT);
+    REQUIRE(messages[2].second.data() == "abcd");
+
+    // Retained data outlives the callback, and its storage is reused once it is released.
+    const auto* storage = messages[1].second.data().data();
+    messages[1].second = {};
+    REQUIRE(client.retain(large).data().data() == storage);
+}
+
+TEST_CASE("frame_burst", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    constexpr size_t FRAMES { 100000 };
+    size_t received {};
+    std::string large {};
+
+    client.set_automatic_reconnect(false);
+    client.set_on_message([&](const ekisocket::ws::Message& message) {
+        if (message.type == Opcode::TEXT && message.data == "x") {
+            ++received;
+        } else if (message.type == Opcode::BINARY) {
+            large = message.data;
+        }
+    });
+
+    {
+        std::jthread server([&server_end = server_end] { accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    // Many tiny frames arriving at once are all processed in a single pass, without recursing per frame.
+    std::string burst {};
+    for (size_t i {}; i < FRAMES; ++i) {
+        burst += server_frame(Opcode::TEXT, "x");
+    }
+
+    std::error_code ec {};
+    (void)server_end->send(burst, ec);
+    client.on_readable();
+    REQUIRE(received == FRAMES);
+
+    // A frame with an extended length, split in the middle of its header and of its payload.
+    const std::string payload(300, 'y');
+    std::string frame { "\x82\x7E\x01\x2C", 4 };
+    frame += payload;
+
+    for (const size_t split : { 3UL, 100UL }) {
+        (void)server_end->send(std::string_view { frame }.substr(0, split), ec);
+        client.on_readable();
+        REQUIRE(large.empty());
+        (void)server_end->send(std::string_view { frame }.substr(split), ec);
+        client.on_readable();
+        REQUIRE(large == payload);
+        large.clear();
+    }
+}
+
+TEST_CASE("permessage_deflate", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    std::vector<ekisocket::ws::Message> messages {};
+
+    client.set_automatic_reconnect(false);
+    client.set_on_message([&](const ekisocket::ws::Message& message) { messages.push_back(message); });
+    client.set_compression(ekisocket::ws::DeflateOptions {
+        .server_no_context_takeover = true, .client_no_context_takeover = true, .min_message_size = 16 });
+
+    std::string request {};
+
+    {
+        // "Hello" compressed, as in section 7.2.3.1 of RFC 7692.
+        std::jthread server([&server_end = server_end, &request] {
+            request = accept_handshake(*server_end, std::string { "\xC1\x07\xF2\x48\xCD\xC9\xC9\x07\x00", 9 },
+                "Sec-WebSocket-Extensions: permessage-deflate; server_no_context_takeover; "
+                "client_no_context_takeover\r\n");
+        });
+        REQUIRE(client.open());
+    }
+
+    REQUIRE(request.find("Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits; "
+                         "server_no_context_takeover; client_no_context_takeover\r\n")
+        != std::string::npos);
+
+    REQUIRE(client.compression_enabled());
+    REQUIRE(messages.size() == 2);
+    REQUIRE(messages[1].data == "Hello");
+
+    // A large message is compressed, a small one is not.
+    std::string json {};
+    for (size_t i {}; i < 50; ++i) {
+        json += R"({"op":0,"d":{"content":"hello"}})";
+    }
+    REQUIRE(client.send(json));
+    REQUIRE(client.send("tiny"));
+    client.on_writable();
+
+    // The first heartbeat was queued as soon as the connection opened.
+    REQUIRE(receive_client_frame(*server_end).first == Opcode::PING);
+    const auto [type, deflated] = receive_client_frame(*server_end);
+    REQUIRE(type == Opcode::TEXT);
+    REQUIRE(deflated.size() < json.size());
+    REQUIRE(receive_client_frame(*server_end) == std::pair { Opcode::TEXT, std::string { "tiny" } });
+
+    // Without context takeover, the compressed message can be echoed back as is, here in two fragments.
+    std::error_code ec {};
+    auto first = server_frame(Opcode::TEXT, std::string_view { deflated }.substr(0, 5));
+    first[0] = static_cast<char>(0x40 | static_cast<uint8_t>(Opcode::TEXT));
+    (void)server_end->send(first + server_frame(Opcode::CONTINUATION, std::string_view { deflated }.substr(5)), ec);
+    client.on_readable();
+    REQUIRE(messages.size() == 3);
+    REQUIRE(messages[2].data == json);
+
+    const auto stats = client.compression_stats();
+    REQUIRE(stats.messages_deflated == 1);
+    REQUIRE(stats.deflate_bytes_in == json.size());
+    REQUIRE(stats.deflate_bytes_out == deflated.size());
+    REQUIRE(stats.messages_inflated == 2);
+    REQUIRE(stats.inflate_bytes_out == json.size() + 5);
+
+    // A streamed message is compressed across its frames, and only the last one leaves out the flush.
+    auto writer = client.begin_message(Opcode::TEXT, ec);
+    REQUIRE(writer.write(std::string_view { json }.substr(0, 100), ec));
+    REQUIRE(writer.finish(std::string_view { json }.substr(100), ec));
+    client.on_writable();
+
+    const auto [first_type, first_part] = receive_client_frame(*server_end);
+    const auto [last_type, last_part] = receive_client_frame(*server_end);
+    REQUIRE(first_type == Opcode::TEXT);
+    REQUIRE(last_type == Opcode::CONTINUATION);
+
+    auto echoed = server_frame(Opcode::TEXT, first_part + last_part);
+    echoed[0] = static_cast<char>(0xC0 | static_cast<uint8_t>(Opcode::TEXT));
+    (void)server_end->send(echoed, ec);
+    client.on_readable();
+    REQUIRE(messages.size() == 4);
+    REQUIRE(messages[3].data == json);
+}
+
+TEST_CASE("unoffered_extension", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/", [&client_end = client_end](std::string_view, uint16_t, bool) {
+                                      return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+                                  } };
+    std::error_code ec {};
+
+    client.set_automatic_reconnect(false);
+
+    {
+        std::jthread server([&server_end = server_end] {
+            (void)accept_handshake(*server_end, {}, "Sec-WebSocket-Extensions: permessage-deflate\r\n");
+        });
+        REQUIRE(!client.open(ec));
+    }
+    REQUIRE(ec == ekisocket::errors::Error::HANDSHAKE_FAILED);
+    REQUIRE(!client.compression_enabled());
+}
+
+TEST_CASE("zlib_stream", "[websocket]")
+{
+    auto [client_end, server_end] = MemoryTransport::pair();
+    ekisocket::ws::Client client { "ws://example.com/?compress=zlib-stream",
+        [&client_end = client_end](std::string_view, uint16_t, bool) {
+            return std::unique_ptr<ekisocket::Transport> { std::move(client_end) };
+        } };
+    std::vector<ekisocket::ws::Message> messages {};
+
+    client.set_automatic_reconnect(false);
+    client.set_on_message([&](const ekisocket::ws::Message& message) { messages.push_back(message); });
+    client.set_transport_compression(ekisocket::ws::TransportCompression::ZLIB_STREAM);
+
+    {
+        std::jthread server([&server_end = server_end] { (void)accept_handshake(*server_end, {}); });
+        REQUIRE(client.open());
+    }
+
+    // Two messages of one zlib stream, the second one referring back to the first.
+    const std::string first { "\x78\x9C\xAA\x56\xCA\x2F\x50\xB2\x32\x34\xA8\x05\x00\x00\x00\xFF\xFF", 17 };
+    const std::string second { "\xAA\x86\x30\x0C\x6B\x01\x00\x00\x00\xFF\xFF", 11 };
+    std::error_code ec {};
+
+    (void)server_end->send(server_frame(Opcode::BINARY, first), ec);
+    client.on_readable();
+    REQUIRE(messages.size() == 2);
+    REQUIRE(messages[1].type == Opcode::BINARY);
+    REQUIRE(messages[1].data == R"({"op":10})");
+
+    // A message is only delivered once the flush that ends it has arrived, even across WebSocket messages.
+    (void)server_end->send(server_frame(Opcode::BINARY, second.substr(0, 4)), ec);
+    client.on_readable();
+    REQUIRE(messages.size() == 2);
+    (void)server_end->send(server_frame(Opcode::BINARY, second.substr(4)), ec);
+    client.on_readable();
+    REQUIRE(messages.size() == 3);
+    REQUIRE(messages[2].data == R"({"op":11})");
+
+    const auto stats = client.compression_stats();
+    REQUIRE(stats.messages_inflated == 2);
+    REQUIRE(stats.inflate_bytes_in == first.size() + second.size());
+    REQUIRE(stats.inflate_bytes_out == 18);
+
+    // Garbage breaks the stream, which closes the connection.
+    (void)server_end->send(server_frame(Opcode::BINARY, std::string { "\xFF\xFF\x00\x00\xFF\xFF", 6 }), ec);
+    client.on_readable();
+    REQUIRE(messages.back().type == Opcode::BAD);
+    REQUIRE(client.status() == ekisocket::ws::Status::CLOSING);
+}
+
+int main(int argc, char* argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,270 @@
+#define CATCH_CONFIG_RUNNER
+#include <atomic>
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <ekisocket/Util.hpp>
+#include <ekisocket/WebSocketPool.hpp>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using ekisocket::ws::Opcode;
+
+namespace {
+bool read_exact(int fd, char* data, size_t len)
+{
+    while (len > 0) {
+        const auto received = read(fd, data, len);
+
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        len -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+/**
+ * @brief Echoes the frames of a single WebSocket connection, until the client closes it.
+ */
+void echo_connection(int conn)
+{
+    std::string request {};
+    char c {};
+
+    while (!request.ends_with("\r\n\r\n") && read_exact(conn, &c, 1)) {
+        request += c;
+    }
+
+    const auto key_start = request.find("Sec-WebSocket-Key: ") + 19;
+    const auto key = request.substr(key_start, request.find("\r\n", key_start) - key_start);
+    const auto response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Accept: "
+        + ekisocket::util::compute_accept(key) + "\r\n\r\n";
+
+    (void)write(conn, response.data(), response.size());
+
+    std::array<char, 6> header {};
+
+    // The clients only send short frames, so the header is always 2 bytes followed by the masking key.
+    while (read_exact(conn, header.data(), header.size())) {
+        const auto opcode = static_cast<Opcode>(static_cast<uint8_t>(header[0]) & 0x0FU);
+        std::string frame(2 + (static_cast<uint8_t>(header[1]) & 0x7FU), '\0');
+
+        if (!read_exact(conn, frame.data() + 2, frame.size() - 2)) {
+            break;
+        }
+        for (size_t i { 2 }; i < frame.size(); ++i) {
+            frame[i] = static_cast<char>(frame[i] ^ header[2 + ((i - 2) % 4)]);
+        }
+
+        frame[0] = static_cast<char>(0x80 | static_cast<uint8_t>(opcode == Opcode::PING ? Opcode::PONG : opcode));
+        frame[1] = static_cast<char>(frame.size() - 2);
+        (void)write(conn, frame.data(), frame.size());
+
+        if (opcode == Opcode::CLOSE) {
+            break;
+        }
+    }
+    close(conn);
+}
+
+/**
+ * @brief Accepts WebSocket connections on a local port, echoing each one on its own thread.
+ */
+struct EchoServer {
+    EchoServer()
+    {
+        m_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len { sizeof(addr) };
+
+        (void)bind(m_listener, reinterpret_cast<sockaddr*>(&addr), len);
+        (void)listen(m_listener, SOMAXCONN);
+        (void)getsockname(m_listener, reinterpret_cast<sockaddr*>(&addr), &len);
+        port = ntohs(addr.sin_port);
+
+        m_thread = std::jthread([this] {
+            for (auto conn = accept(m_listener, nullptr, nullptr); conn >= 0;
+                 conn = accept(m_listener, nullptr, nullptr)) {
+                m_connections.emplace_back(echo_connection, conn);
+            }
+        });
+    }
+
+    EchoServer(const EchoServer&) = delete;
+    EchoServer& operator=(const EchoServer&) = delete;
+    EchoServer(EchoServer&&) = delete;
+    EchoServer& operator=(EchoServer&&) = delete;
+
+    ~EchoServer()
+    {
+        shutdown(m_listener, SHUT_RDWR);
+        m_thread.join();
+        close(m_listener);
+    }
+
+    uint16_t port {};
+
+private:
+    int m_listener {};
+    std::vector<std::jthread> m_connections {};
+    std::jthread m_thread {};
+};
+
+template <typename Predicate> bool wait_until(Predicate&& predicate)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds { 10 };
+
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+    }
+    return true;
+}
+} // namespace
+
+TEST_CASE("pool_echo", "[websocket_pool]")
+{
+    constexpr size_t CLIENTS { 32 };
+    EchoServer server {};
+    ekisocket::ws::Pool pool { 2 };
+    std::mutex mtx {};
+    std::set<std::string> echoes {};
+    std::atomic_size_t opened {};
+    std::atomic_size_t closed {};
+    std::vector<ekisocket::ws::Client*> clients {};
+
+    REQUIRE(pool.thread_count() == 2);
+
+    for (size_t i {}; i < CLIENTS; ++i) {
+        ekisocket::ws::Client client { "ws://127.0.0.1:" + std::to_string(server.port) + "/" };
+
+        client.set_automatic_reconnect(false);
+        client.set_on_message([&](const ekisocket::ws::Message& message) {
+            if (message.type == Opcode::OPEN) {
+                ++opened;
+            } else if (message.type == Opcode::CLOSE) {
+                ++closed;
+            } else if (message.type == Opcode::TEXT) {
+                std::scoped_lock lk { mtx };
+                echoes.insert(message.data);
+            }
+        });
+        clients.push_back(&pool.add(std::move(client)));
+    }
+
+    REQUIRE(pool.size() == CLIENTS);
+    REQUIRE(wait_until([&] { return opened.load() == CLIENTS; }));
+
+    for (size_t i {}; i < CLIENTS; ++i) {
+        REQUIRE(clients[i]->send("message " + std::to_string(i)));
+    }
+    REQUIRE(wait_until([&] {
+        std::scoped_lock lk { mtx };
+        return echoes.size() == CLIENTS;
+    }));
+
+    // Half of the clients close gracefully, the other half is dropped.
+    for (size_t i {}; i < CLIENTS / 2; ++i) {
+        clients[i]->close();
+    }
+    REQUIRE(wait_until([&] { return closed.load() == CLIENTS / 2; }));
+    for (auto* client : clients) {
+        pool.remove(*client);
+    }
+    REQUIRE(pool.size() == 0);
+}
+
+TEST_CASE("pool_idle_timeout", "[websocket_pool]")
+{
+    constexpr size_t CLIENTS { 64 };
+    EchoServer server {};
+    ekisocket::ws::Pool pool { 2 };
+    std::atomic_size_t opened {};
+    std::atomic_size_t closed {};
+    std::vector<ekisocket::ws::Client*> clients {};
+
+    for (size_t i {}; i < CLIENTS; ++i) {
+        ekisocket::ws::Client client { "ws://127.0.0.1:" + std::to_string(server.port) + "/" };
+
+        client.set_automatic_reconnect(false);
+        // Spread the timeouts out, so that they land in different slots of the timer wheels.
+        client.set_idle_timeout(std::chrono::milliseconds { 50 + 5 * i });
+        client.set_on_message([&](const ekisocket::ws::Message& message) {
+            if (message.type == Opcode::OPEN) {
+                ++opened;
+            } else if (message.type == Opcode::CLOSE) {
+                ++closed;
+            }
+        });
+        clients.push_back(&pool.add(std::move(client)));
+    }
+
+    // Once the pongs of the first heartbeats are in, nothing else is received and every client times out.
+    REQUIRE(wait_until([&] { return closed.load() == CLIENTS; }));
+    REQUIRE(opened.load() == CLIENTS);
+    for (auto* client : clients) {
+        REQUIRE(client->status() == ekisocket::ws::Status::CLOSED);
+        pool.remove(*client);
+    }
+}
+TEST_CASE("pool_reconnect", "[websocket_pool]")
+{
+    constexpr size_t CLIENTS { 16 };
+    EchoServer server {};
+    ekisocket::ws::Pool pool { 2 };
+    std::atomic_size_t opened {};
+    std::atomic_size_t reconnected {};
+    std::vector<ekisocket::ws::Client*> clients {};
+
+    // A burst of 4 reconnections, then one every 10ms.
+    ekisocket::ws::set_reconnect_rate(100, 4);
+
+    for (size_t i {}; i < CLIENTS; ++i) {
+        ekisocket::ws::Client client { "ws://127.0.0.1:" + std::to_string(server.port) + "/" };
+
+        client.set_reconnect_policy({ .initial_delay = std::chrono::milliseconds { 20 } });
+        // The first attempt of every client succeeds.
+        client.set_on_reconnect([&](uint32_t attempts) { reconnected += attempts == 1 ? 1 : CLIENTS + 1; });
+        client.set_on_message([&](const ekisocket::ws::Message& message) {
+            if (message.type == Opcode::OPEN) {
+                ++opened;
+            }
+        });
+        clients.push_back(&pool.add(std::move(client)));
+    }
+    REQUIRE(wait_until([&] { return opened.load() == CLIENTS; }));
+
+    // The server echoes the close frames, after which every client reconnects, a few at a time.
+    const auto start = std::chrono::steady_clock::now();
+    for (auto* client : clients) {
+        client->close();
+    }
+    REQUIRE(wait_until([&] { return reconnected.load() >= CLIENTS; }));
+    REQUIRE(reconnected.load() == CLIENTS);
+    REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds { (CLIENTS - 4) * 10 - 10 });
+    REQUIRE(wait_until([&] { return opened.load() == 2 * CLIENTS; }));
+
+    for (auto* client : clients) {
+        client->set_automatic_reconnect(false);
+        pool.remove(*client);
+    }
+    ekisocket::ws::set_reconnect_rate(100, 100);
+}
+#endif
+
+int main(int argc, char* argv[]) { return Catch::Session().run(argc, argv); }